@@ -0,0 +1,16 @@
+#pragma once
+
+#define LOG_LEVEL LOG_LEVEL_TRACE
+#define LOG_LEVEL_TEXT_FORMAT LOG_LEVEL_TEXT_FORMAT_SHORT
+#define LOG_TIME LOG_TIME_MILLIS
+#define LOG_FILENAME LOG_FILENAME_LINENUMBER_ENABLE
+#define LOG_COLOR LOG_COLOR_DISABLE
+#define LOG_STREAM Serial
+
+// Async settings
+#define LOG_ASYNC_ENABLE 1                        // Queue messages for a background drain task
+#define LOG_ASYNC_QUEUE_SIZE 64                   // Number of queued messages (power of 2)
+#define LOG_ASYNC_RECORD_SIZE 128                 // Max bytes per message
+#define LOG_ASYNC_FULL_POLICY LOG_ASYNC_FULL_DROP // Never stall the caller, count drops instead
+
+#include <FormatLog.h>
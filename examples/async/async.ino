@@ -0,0 +1,51 @@
+#include <Arduino.h>
+#include "FmtLog.h" // Check FmtLog.h for async settings
+
+// Compares the caller-side cost of LOG_INFO with direct (sync) and queued (async) output.
+// The drain task runs as a FreeRTOS task on ESP32 and as a std::thread elsewhere.
+
+const int MESSAGES = 50;
+
+void measure(const char *label)
+{
+    uint32_t total = 0;
+    uint32_t worst = 0;
+
+    for (int i = 0; i < MESSAGES; i++)
+    {
+        fmtlog::MicroStopwatch sw;
+        LOG_INFO("Sensor {} reading {:.2f} status 0x{:02X}", i, i * 1.25f, i);
+        uint32_t us = sw.elapsedUs();
+
+        total += us;
+        if (us > worst)
+            worst = us;
+
+        delay(2); // Let the drain task keep up, like a real control loop would
+    }
+
+    fmtlog::MicroStopwatch flushSw;
+    LOG_FLUSH(); // Waits until the queue is empty
+    uint32_t flushUs = flushSw.elapsedUs();
+
+    LOG_INFO("[{}] avg {} us, max {} us per call, flush {} us", label, total / MESSAGES, worst, flushUs);
+    LOG_FLUSH();
+}
+
+void setup()
+{
+    LOG_BEGIN(115200);
+    delay(3000);
+
+    LOG_SET_ASYNC(false);
+    measure("sync");
+
+    LOG_SET_ASYNC(true);
+    measure("async");
+
+    LOG_INFO("Dropped messages: {}", LOG_GET_ASYNC_DROPPED());
+}
+
+void loop()
+{
+}
@@ -95,6 +95,63 @@ void precisionTiming()
     LOG_INFO("Elapsed: {}", usw.elapsedTime()); // HH:MM:SS:mmm:uuu
 }
 
+// Filtered calls: the runtime level is checked before the arguments are evaluated,
+// so slowConversion() never runs and each call costs a load and a compare
+int slowConversion()
+{
+    delayMicroseconds(100); // Simulate an expensive conversion
+    return analogRead(5);
+}
+
+void filteredCalls()
+{
+    const int calls = 1000;
+    LOG_SET_LOG_LEVEL(fmtlog::LogLevel::INFO);
+
+    fmtlog::MicroStopwatch sw;
+    for (int i = 0; i < calls; i++)
+    {
+        LOG_DEBUG("Converted {}", slowConversion());
+    }
+    uint32_t elapsedUs = sw.elapsedUs();
+
+    LOG_SET_LOG_LEVEL(fmtlog::LogLevel::TRACE);
+    LOG_INFO("{} filtered LOG_DEBUG calls: {} us total, {} ns per call", calls, elapsedUs, elapsedUs * 1000 / calls);
+}
+
+// Passing checks: the failure path is out of line, so a passing CHECK_OR_RETURN
+// costs a compare and a branch predicted not taken
+void accumulate(const int *values, int count, long &sum)
+{
+    for (int i = 0; i < count; i++)
+    {
+        CHECK_OR_RETURN(values[i] >= 0, "negative value");
+        CHECK_OR_RETURN(values[i] < 4096, "value out of range");
+        sum += values[i];
+    }
+}
+
+void checkedCalls()
+{
+    static int values[256];
+    for (int i = 0; i < 256; i++)
+    {
+        values[i] = (i * 37) % 4096;
+    }
+
+    const int rounds = 100;
+    long sum = 0;
+    fmtlog::MicroStopwatch sw;
+    for (int r = 0; r < rounds; r++)
+    {
+        accumulate(values, 256, sum);
+    }
+    uint32_t elapsedUs = sw.elapsedUs();
+
+    LOG_INFO("{} passing CHECK_OR_RETURN loop iterations: {} us total, {} ns per iteration (sum {})",
+             rounds * 256, elapsedUs, elapsedUs * 1000 / (rounds * 256), sum);
+}
+
 void setup()
 {
     LOG_BEGIN(115200);
@@ -109,6 +166,8 @@ void setup()
     calibrate();
     fastOperation();
     precisionTiming();
+    filteredCalls();
+    checkedCalls();
 }
 
 void loop()
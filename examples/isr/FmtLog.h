@@ -0,0 +1,16 @@
+#pragma once
+
+#define LOG_LEVEL LOG_LEVEL_TRACE
+#define LOG_LEVEL_TEXT_FORMAT LOG_LEVEL_TEXT_FORMAT_SHORT
+#define LOG_TIME LOG_TIME_MICROS
+#define LOG_FILENAME LOG_FILENAME_LINENUMBER_ENABLE
+#define LOG_COLOR LOG_COLOR_DISABLE
+#define LOG_STREAM Serial
+
+// LOG_ISR_* macros: interrupt handlers store a fixed-size record, the loop formats it later.
+// Each interrupt context (core) owns a ring of LOG_ISR_QUEUE_SIZE records.
+#define LOG_ISR_ENABLE 1
+#define LOG_ISR_QUEUE_SIZE 32
+#define LOG_ISR_MAX_ARGS 4
+
+#include <FormatLog.h>
@@ -0,0 +1,56 @@
+#include <Arduino.h>
+#include "FmtLog.h" // Check FmtLog.h for LOG_ISR_ENABLE
+
+// Logs from a 1 kHz hardware timer interrupt and measures the worst-case cost of LOG_ISR_INFO
+// in CPU cycles, inside the handler. The loop drains and prints the records once a second,
+// so the ring overflows on purpose and the dropped path is measured too.
+
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+#define TIMER_BEGIN() timerBegin(1000000)
+#define TIMER_START(timer, handler, periodUs)  \
+    timerAttachInterrupt(timer, handler);       \
+    timerAlarm(timer, periodUs, true, 0)
+#else
+#define TIMER_BEGIN() timerBegin(0, 80, true)
+#define TIMER_START(timer, handler, periodUs)  \
+    timerAttachInterrupt(timer, handler, true); \
+    timerAlarmWrite(timer, periodUs, true);     \
+    timerAlarmEnable(timer)
+#endif
+
+hw_timer_t *timer = nullptr;
+volatile uint32_t ticks = 0;
+volatile uint32_t worstCycles = 0;
+volatile uint32_t bestCycles = UINT32_MAX;
+
+void IRAM_ATTR onTimer()
+{
+    uint32_t tick = ticks++;
+
+    uint32_t start = ESP.getCycleCount();
+    LOG_ISR_INFO("Tick {} adc {} flags 0x{:02X}", tick, 1234, 0x5A);
+    uint32_t cycles = ESP.getCycleCount() - start;
+
+    if (cycles > worstCycles)
+        worstCycles = cycles;
+    if (cycles < bestCycles)
+        bestCycles = cycles;
+}
+
+void setup()
+{
+    LOG_BEGIN(115200);
+    delay(3000);
+
+    timer = TIMER_BEGIN();
+    TIMER_START(timer, &onTimer, 1000);
+}
+
+void loop()
+{
+    delay(1000);
+
+    LOG_ISR_DRAIN();
+    LOG_INFO("LOG_ISR_INFO: best {} cycles, worst {} cycles ({} MHz), {} dropped",
+             bestCycles, worstCycles, getCpuFrequencyMhz(), LOG_ISR_DROPPED_COUNT());
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#define LOG_LEVEL LOG_LEVEL_TRACE
+#define LOG_LEVEL_TEXT_FORMAT LOG_LEVEL_TEXT_FORMAT_SHORT
+#define LOG_TIME LOG_TIME_MILLIS
+#define LOG_FILENAME LOG_FILENAME_LINENUMBER_ENABLE
+#define LOG_COLOR LOG_COLOR_DISABLE
+#define LOG_STREAM Serial
+
+// Cooperative settings, for boards without an RTOS task to drain an async queue
+#define LOG_POLL_ENABLE 1          // LOG_* only queue, LOG_POLL() writes what the Stream can take
+#define LOG_POLL_BUFFER_SIZE 4096  // Bytes of queued output
+#define LOG_POLL_FILE_BUDGET_MS 2  // Time per LOG_POLL() for file sinks
+
+#include <FormatLog.h>
@@ -0,0 +1,39 @@
+#include <Arduino.h>
+#include "FmtLog.h" // Check FmtLog.h for LOG_POLL_ENABLE
+
+// A 1 kHz control loop that logs every iteration. LOG_* calls only queue the line, and LOG_POLL()
+// writes as many bytes as the UART transmit buffer has room for, so the loop never waits for the
+// Stream. The longest iteration is reported with the number of lines dropped when the queue was full.
+
+const uint32_t PERIOD_US = 1000;
+
+uint32_t nextUs = 0;
+uint32_t iteration = 0;
+uint32_t worstUs = 0;
+
+void setup()
+{
+    LOG_BEGIN(115200);
+    delay(3000);
+    nextUs = micros();
+}
+
+void loop()
+{
+    if ((int32_t)(micros() - nextUs) < 0)
+        return;
+    nextUs += PERIOD_US;
+
+    uint32_t start = micros();
+    float error = sinf(iteration * 0.01f);
+    LOG_DEBUG("Step {} error {:.3f}", iteration, error);
+    LOG_POLL();
+    uint32_t us = micros() - start;
+    worstUs = us > worstUs ? us : worstUs;
+
+    if (++iteration % 1000 == 0)
+    {
+        LOG_INFO("Worst iteration {} us, {} bytes queued, {} lines dropped", worstUs, LOG_POLL_PENDING(), LOG_POLL_DROPPED_COUNT());
+        worstUs = 0;
+    }
+}
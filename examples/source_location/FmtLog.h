@@ -0,0 +1,10 @@
+#pragma once
+
+#define LOG_LEVEL LOG_LEVEL_TRACE
+#define LOG_LEVEL_TEXT_FORMAT LOG_LEVEL_TEXT_FORMAT_SHORT
+#define LOG_TIME LOG_TIME_DISABLE
+#define LOG_FILENAME LOG_FILENAME_LINENUMBER_FUNCTION_ENABLE // Preamble shows "source_location:12 setup()"
+#define LOG_COLOR LOG_COLOR_DISABLE
+#define LOG_STREAM Serial
+
+#include <FormatLog.h>
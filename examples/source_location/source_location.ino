@@ -0,0 +1,50 @@
+#include <Arduino.h>
+#include "FmtLog.h" // Check FmtLog.h for the filename setting
+
+// Compares the per-call cost of the filename preamble for each LOG_FILENAME option:
+//   per call  –  fmtlog::formatFilename() strips the path and extension and runs snprintf every time
+//   per site  –  LOG_SOURCE_LOCATION() renders once into a static buffer sized at compile time,
+//                later calls only return the pointer (what LOG_* uses with the default preamble)
+
+const int CALLS = 1000;
+
+volatile size_t sink; // Keeps the compiler from optimizing the loops away
+
+template <int Format>
+void measure(const char *label)
+{
+    fmtlog::MicroStopwatch perCallSw;
+    for (int i = 0; i < CALLS; i++)
+    {
+        fmtlog::FilenameText text = fmtlog::formatFilename(__FILE__, __LINE__, __FUNCTION__, static_cast<fmtlog::LogFilename>(Format));
+        sink = sink + text.c_str()[0];
+    }
+    uint32_t perCallUs = perCallSw.elapsedUs();
+
+    const char *fragment = nullptr;
+    fmtlog::MicroStopwatch perSiteSw;
+    for (int i = 0; i < CALLS; i++)
+    {
+        fragment = LOG_SOURCE_LOCATION(Format).fragment;
+        sink = sink + fragment[0];
+    }
+    uint32_t perSiteUs = perSiteSw.elapsedUs();
+
+    LOG_INFO("{:<40} per call {:>6} ns, per site {:>6} ns  \"{}\"", label,
+             perCallUs * 1000 / CALLS, perSiteUs * 1000 / CALLS, fragment);
+}
+
+void setup()
+{
+    LOG_BEGIN(115200);
+    delay(3000);
+
+    measure<LOG_FILENAME_DISABLE>("LOG_FILENAME_DISABLE");
+    measure<LOG_FILENAME_ENABLE>("LOG_FILENAME_ENABLE");
+    measure<LOG_FILENAME_LINENUMBER_ENABLE>("LOG_FILENAME_LINENUMBER_ENABLE");
+    measure<LOG_FILENAME_LINENUMBER_FUNCTION_ENABLE>("LOG_FILENAME_LINENUMBER_FUNCTION_ENABLE");
+}
+
+void loop()
+{
+}
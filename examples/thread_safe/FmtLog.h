@@ -0,0 +1,14 @@
+#pragma once
+
+#define LOG_LEVEL LOG_LEVEL_TRACE
+#define LOG_LEVEL_TEXT_FORMAT LOG_LEVEL_TEXT_FORMAT_SHORT
+#define LOG_TIME LOG_TIME_MILLIS
+#define LOG_FILENAME LOG_FILENAME_LINENUMBER_ENABLE
+#define LOG_COLOR LOG_COLOR_DISABLE
+#define LOG_STREAM Serial
+
+// Serialize the writes of LOG_* calls made from several tasks / cores.
+// Messages are still formatted in each caller's own stack buffer, without holding the lock.
+#define LOG_THREAD_SAFE 1
+
+#include <FormatLog.h>
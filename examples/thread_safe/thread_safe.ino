@@ -0,0 +1,72 @@
+#include <Arduino.h>
+#include <thread>
+#include "FmtLog.h" // Check FmtLog.h for LOG_THREAD_SAFE
+
+// Measures LOG_INFO cost under contention with 1, 2, 4 and 8 producer threads.
+// The messages go to a stream that discards them, so the numbers show formatting and
+// lock contention rather than UART speed. std::thread maps to FreeRTOS tasks on ESP32.
+
+const int MESSAGES_PER_THREAD = 500;
+
+class NullStream : public Stream
+{
+public:
+    size_t write(uint8_t) override { return 1; }
+    size_t write(const uint8_t *, size_t size) override { return size; }
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    void flush() override {}
+};
+
+NullStream nullStream;
+
+void producer(int id, uint32_t *worstUs)
+{
+    for (int i = 0; i < MESSAGES_PER_THREAD; i++)
+    {
+        fmtlog::MicroStopwatch sw;
+        LOG_INFO("Producer {} reading {:.2f} status 0x{:02X}", id, i * 1.25f, i);
+        uint32_t us = sw.elapsedUs();
+        if (us > *worstUs)
+            *worstUs = us;
+    }
+}
+
+void measure(int threadCount)
+{
+    std::thread threads[8];
+    uint32_t worst[8] = {};
+
+    FmtLog.setSerial(nullStream);
+    fmtlog::MicroStopwatch sw;
+    for (int t = 0; t < threadCount; t++)
+        threads[t] = std::thread(producer, t, &worst[t]);
+    for (int t = 0; t < threadCount; t++)
+        threads[t].join();
+    uint32_t elapsedUs = sw.elapsedUs();
+    FmtLog.setSerial(Serial);
+
+    uint32_t worstUs = 0;
+    for (int t = 0; t < threadCount; t++)
+        worstUs = worst[t] > worstUs ? worst[t] : worstUs;
+
+    uint32_t messages = threadCount * MESSAGES_PER_THREAD;
+    LOG_INFO("[{} threads] {} msgs in {} us, {} msgs/s, max {} us per call",
+             threadCount, messages, elapsedUs, messages * 1000000ULL / (elapsedUs ? elapsedUs : 1), worstUs);
+}
+
+void setup()
+{
+    LOG_BEGIN(115200);
+    delay(3000);
+
+    measure(1);
+    measure(2);
+    measure(4);
+    measure(8);
+}
+
+void loop()
+{
+}
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+#if !defined(ESP32)
+#include <thread>
+#endif
+
+namespace fmtlog
+{
+
+    /**
+     * Lets callers sleep until another task has made progress, e.g. drained a queue.
+     *
+     * notify() only takes the mutex while someone waits, so the task making progress can call it
+     * after every step.
+     */
+    class AsyncSignal
+    {
+    private:
+        std::mutex _mutex;
+        std::condition_variable _changed;
+        std::atomic<uint32_t> _waiters{0};
+
+    public:
+        /**
+         * Wakes every waiter to check its condition again. Call after publishing the change.
+         */
+        void notify()
+        {
+            // Pairs with the fence in waitUntil(): either the waiter sees the change, or it is counted here
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (_waiters.load(std::memory_order_relaxed) == 0)
+                return;
+
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+            }
+            _changed.notify_all();
+        }
+
+        /**
+         * Sleeps until ready() returns true, checking it again after each notify().
+         */
+        template <typename Ready>
+        void waitUntil(Ready ready)
+        {
+            _waiters.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                while (!ready())
+                    _changed.wait(lock);
+            }
+            _waiters.fetch_sub(1, std::memory_order_relaxed);
+        }
+    };
+
+    /**
+     * Minimal background task wrapper.
+     *
+     * ESP32  –  FreeRTOS task (stack size, priority and core configurable), woken by task notifications
+     * Other  –  std::thread (host builds and cores that provide <thread>), woken by a condition variable
+     */
+    class AsyncTask
+    {
+    public:
+        using Function = void (*)(void *arg);
+
+    private:
+#if defined(ESP32)
+        std::atomic<bool> _alive{false};
+        TaskHandle_t _handle = nullptr;
+#else
+        std::thread _thread;
+        std::mutex _wakeMutex;
+        std::condition_variable _wake;
+        bool _woken = false;
+#endif
+
+    public:
+        AsyncTask() = default;
+        AsyncTask(const AsyncTask &) = delete;
+        AsyncTask &operator=(const AsyncTask &) = delete;
+
+        bool start(Function function, void *arg, const char *name, uint32_t stackSize, uint8_t priority, int core)
+        {
+#if defined(ESP32)
+            _alive = true;
+            BaseType_t created = core < 0
+                                     ? xTaskCreate(function, name, stackSize, arg, priority, &_handle)
+                                     : xTaskCreatePinnedToCore(function, name, stackSize, arg, priority, &_handle, core);
+            _alive = created == pdPASS;
+            return _alive;
+#else
+            (void)name;
+            (void)stackSize;
+            (void)priority;
+            (void)core;
+            _woken = false;
+            _thread = std::thread(function, arg);
+            return true;
+#endif
+        }
+
+        /**
+         * Wakes the task from wait(), or makes its next wait() return at once. Call from any task,
+         * after publishing the work.
+         */
+        void notify()
+        {
+#if defined(ESP32)
+            if (_handle != nullptr)
+                xTaskNotifyGive(_handle);
+#else
+            {
+                std::lock_guard<std::mutex> lock(_wakeMutex);
+                _woken = true;
+            }
+            _wake.notify_one();
+#endif
+        }
+
+        /**
+         * Called by the task function to sleep until notify().
+         */
+        void wait()
+        {
+#if defined(ESP32)
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+#else
+            std::unique_lock<std::mutex> lock(_wakeMutex);
+            _wake.wait(lock, [this]
+                       { return _woken; });
+            _woken = false;
+#endif
+        }
+
+        /**
+         * Waits for the task function to return. The function must observe its own stop flag: set it,
+         * then notify() the task before joining.
+         */
+        void join()
+        {
+#if defined(ESP32)
+            // FreeRTOS tasks delete themselves via finish() when their function returns
+            while (_alive)
+                delay(1);
+            _handle = nullptr;
+#else
+            if (_thread.joinable())
+                _thread.join();
+#endif
+        }
+
+        /**
+         * Must be the last call of the task function.
+         */
+        void finish()
+        {
+#if defined(ESP32)
+            _alive = false;
+            vTaskDelete(nullptr);
+#endif
+        }
+    };
+
+} // namespace fmtlog
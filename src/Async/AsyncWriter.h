@@ -0,0 +1,282 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include "Config/Settings.h"
+#include "Async/MpscRing.h"
+#include "Async/AsyncTask.h"
+
+namespace fmtlog
+{
+
+    enum class AsyncTarget : uint8_t
+    {
+        STREAM,
+        FILE_STORAGE,
+        LINE,    // Formatted message body, preambles added on drain, see FormatLog::writeQueuedLine()
+        DEFERRED // Unformatted message, see FormatLog::writeDeferred()
+    };
+
+    /**
+     * @tparam HeaderSize Room for the largest header written in front of a message body
+     */
+    template <size_t HeaderSize>
+    struct AsyncRecord
+    {
+        AsyncTarget target;
+        size_t size;
+        char data[HeaderSize + LOG_ASYNC_RECORD_SIZE];
+    };
+
+    /**
+     * Hands formatted messages from any number of producer tasks to one background drain task.
+     *
+     * Producers copy their message into a pre-allocated ring slot and return immediately.
+     * The drain task pops slots in order and passes them to the drain callback, which does
+     * the actual (blocking) Stream / IFileSink writes.
+     *
+     * @tparam HeaderSize Room for the largest header written in front of a message body, so every
+     *                    record holds LOG_ASYNC_RECORD_SIZE bytes of body on top of its header
+     */
+    template <size_t HeaderSize>
+    class AsyncWriter
+    {
+    public:
+        using DrainCallback = void (*)(void *context, AsyncTarget target, const char *data, size_t size);
+        using Record = AsyncRecord<HeaderSize>;
+
+    private:
+        MpscRing<Record, LOG_ASYNC_QUEUE_SIZE> _ring;
+        AsyncTask _task;
+        AsyncSignal _drained; // Notified each time a record is written and its slot freed
+        DrainCallback _callback;
+        void *_context;
+        std::atomic<bool> _started{false};
+        std::atomic<bool> _stopping{false};
+        std::atomic<uint32_t> _dropped{0};
+        std::atomic<uint32_t> _truncated{0};
+
+        static void taskMain(void *arg)
+        {
+            AsyncWriter *self = static_cast<AsyncWriter *>(arg);
+            while (!self->_stopping.load(std::memory_order_acquire))
+            {
+                if (self->drain() == 0)
+                    self->_task.wait();
+            }
+            self->drain();
+            self->_task.finish();
+        }
+
+        // Hands a header and message to the drain callback on the caller's task, if the drain task can't be started
+        __attribute__((cold, noinline)) void writeDirect(AsyncTarget target, const void *header, size_t headerSize, const char *data, size_t size)
+        {
+            Record record;
+            if (size > sizeof(record.data) - headerSize)
+            {
+                size = sizeof(record.data) - headerSize;
+                _truncated.fetch_add(1, std::memory_order_relaxed);
+            }
+            memcpy(record.data, header, headerSize);
+            memcpy(record.data + headerSize, data, size);
+            _callback(_context, target, record.data, headerSize + size);
+        }
+
+    public:
+        AsyncWriter(DrainCallback callback, void *context) : _callback(callback), _context(context) {}
+
+        ~AsyncWriter()
+        {
+            stop();
+        }
+
+        /**
+         * Starts the drain task unless it is running.
+         *
+         * @return false if the task can't be started, write on the caller's task instead
+         */
+        bool ensureStarted()
+        {
+            if (_started.load(std::memory_order_acquire))
+                return true;
+
+            bool expected = false;
+            if (_started.compare_exchange_strong(expected, true))
+            {
+                if (!_task.start(taskMain, this, "fmtlog", LOG_ASYNC_TASK_STACK_SIZE, LOG_ASYNC_TASK_PRIORITY, LOG_ASYNC_TASK_CORE))
+                {
+                    _started = false;
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /**
+         * Reserves a record to be filled in place and published with commit(). Call ensureStarted()
+         * first. Waits for a free record unless LOG_ASYNC_FULL_DROP is set.
+         *
+         * @return The record, or nullptr if the message must be dropped
+         */
+        Record *reserve(size_t &ticket)
+        {
+            Record *record;
+            while ((record = _ring.reserve(ticket)) == nullptr)
+            {
+#if LOG_ASYNC_FULL_POLICY == LOG_ASYNC_FULL_DROP
+                _dropped.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+#else
+                _drained.waitUntil([this]
+                                   { return _ring.headPosition() - _ring.tailPosition() < _ring.capacity(); });
+#endif
+            }
+            return record;
+        }
+
+        /**
+         * Publishes a record returned by reserve() and wakes the drain task.
+         */
+        void commit(size_t ticket)
+        {
+            _ring.commit(ticket);
+            _task.notify();
+        }
+
+        /**
+         * Queues a copy of the message for the drain task. Messages larger than a record
+         * (header room plus LOG_ASYNC_RECORD_SIZE) are truncated, keeping the trailing LOG_EOL.
+         *
+         * @return false if the message was dropped because the queue was full (LOG_ASYNC_FULL_DROP)
+         */
+        bool write(AsyncTarget target, const char *data, size_t size)
+        {
+            if (!ensureStarted())
+            {
+                _callback(_context, target, data, size);
+                return true;
+            }
+
+            size_t ticket;
+            Record *record = reserve(ticket);
+            if (record == nullptr)
+                return false;
+
+            record->target = target;
+            if (size <= sizeof(record->data))
+            {
+                memcpy(record->data, data, size);
+                record->size = size;
+            }
+            else
+            {
+                const size_t eolLen = sizeof(LOG_EOL) - 1;
+                bool hasEol = size >= eolLen && memcmp(data + size - eolLen, LOG_EOL, eolLen) == 0;
+                size_t keep = hasEol ? sizeof(record->data) - eolLen : sizeof(record->data);
+                memcpy(record->data, data, keep);
+                if (hasEol)
+                    memcpy(record->data + keep, LOG_EOL, eolLen);
+                record->size = sizeof(record->data);
+                _truncated.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            commit(ticket);
+            return true;
+        }
+
+        /**
+         * Queues a fixed-size header followed by a message. A message longer than
+         * LOG_ASYNC_RECORD_SIZE is truncated.
+         *
+         * @return false if the message was dropped because the queue was full (LOG_ASYNC_FULL_DROP)
+         */
+        template <typename Header>
+        bool write(AsyncTarget target, const Header &header, const char *data, size_t size)
+        {
+            static_assert(sizeof(Header) <= HeaderSize, "AsyncWriter HeaderSize must fit every record header");
+
+            if (!ensureStarted())
+            {
+                writeDirect(target, &header, sizeof(header), data, size);
+                return true;
+            }
+
+            size_t ticket;
+            Record *record = reserve(ticket);
+            if (record == nullptr)
+                return false;
+
+            size_t space = sizeof(record->data) - sizeof(header);
+            if (size > space)
+            {
+                size = space;
+                _truncated.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            record->target = target;
+            memcpy(record->data, &header, sizeof(header));
+            memcpy(record->data + sizeof(header), data, size);
+            record->size = sizeof(header) + size;
+            commit(ticket);
+            return true;
+        }
+
+        /**
+         * Writes out every committed record. Called by the drain task.
+         *
+         * @return Number of records written
+         */
+        size_t drain()
+        {
+            size_t count = 0;
+            Record *record;
+            while ((record = _ring.front()) != nullptr)
+            {
+                _callback(_context, record->target, record->data, record->size);
+                _ring.pop();
+                _drained.notify();
+                ++count;
+            }
+            return count;
+        }
+
+        /**
+         * Blocks until every message queued before this call has been written by the drain task.
+         */
+        void flush()
+        {
+            if (!_started.load(std::memory_order_acquire))
+                return;
+
+            size_t target = _ring.headPosition();
+            _drained.waitUntil([this, target]
+                               { return static_cast<intptr_t>(_ring.tailPosition() - target) >= 0; });
+        }
+
+        /**
+         * Drains the queue and stops the drain task. The next write() restarts it.
+         */
+        void stop()
+        {
+            if (!_started.load(std::memory_order_acquire))
+                return;
+
+            _stopping = true;
+            _task.notify();
+            _task.join();
+            _stopping = false;
+            _started = false;
+        }
+
+        /**
+         * @return Number of messages dropped because the queue was full
+         */
+        uint32_t droppedCount() const { return _dropped.load(std::memory_order_relaxed); }
+
+        /**
+         * @return Number of messages truncated to LOG_ASYNC_RECORD_SIZE
+         */
+        uint32_t truncatedCount() const { return _truncated.load(std::memory_order_relaxed); }
+    };
+
+} // namespace fmtlog
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <Arduino.h>
+#include <string.h>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include "fmt.h"
+
+namespace fmtlog
+{
+
+    template <size_t... I>
+    struct IndexSequence
+    {
+    };
+
+    template <size_t N, size_t... I>
+    struct MakeIndexSequence : MakeIndexSequence<N - 1, N - 1, I...>
+    {
+    };
+
+    template <size_t... I>
+    struct MakeIndexSequence<0, I...>
+    {
+        using type = IndexSequence<I...>;
+    };
+
+    template <bool...>
+    struct BoolPack
+    {
+    };
+
+    template <bool... B>
+    struct AllOf : std::is_same<BoolPack<true, B...>, BoolPack<B..., true>>
+    {
+    };
+
+    /**
+     * Strings are deep-copied into the record as a length followed by the bytes,
+     * and handed to fmt as a string_view into the record when formatted.
+     */
+    template <typename Derived, typename T>
+    struct DeferredStringArg
+    {
+        static const bool value = true;
+        using Stored = fmt::string_view;
+
+        static size_t size(const T &arg)
+        {
+            return sizeof(size_t) + Derived::view(arg).size();
+        }
+
+        static char *write(char *out, const T &arg)
+        {
+            fmt::string_view view = Derived::view(arg);
+            size_t length = view.size();
+            memcpy(out, &length, sizeof(length));
+            memcpy(out + sizeof(length), view.data(), length);
+            return out + sizeof(length) + length;
+        }
+
+        static Stored read(const char *&in)
+        {
+            size_t length;
+            memcpy(&length, in, sizeof(length));
+            Stored view(in + sizeof(length), length);
+            in += sizeof(length) + length;
+            return view;
+        }
+    };
+
+    /**--------------------------------------------------------------------------------------
+     * Argument serialization policy for deferred formatting.
+     *
+     *   Strings (const char *, std::string, String, fmt::string_view)  –  deep-copied
+     *   Integers, floats, bool, char, enums and void pointers          –  copied byte for byte
+     *   Anything else (structs, other pointers, containers)             –  not deferrable,
+     *                                                                       the whole message is formatted at the call site
+     *
+     * Structs are not copied even when trivially copyable, they may point at memory that is gone by the drain.
+     *-------------------------------------------------------------------------------------*/
+
+    template <typename T>
+    struct IsDeferredScalar : std::integral_constant<bool, std::is_arithmetic<T>::value ||
+                                                               std::is_enum<T>::value ||
+                                                               std::is_same<T, void *>::value ||
+                                                               std::is_same<T, const void *>::value>
+    {
+    };
+
+    template <typename T, typename Enable = void>
+    struct DeferredArg
+    {
+        static const bool value = false;
+    };
+
+    template <typename T>
+    struct DeferredArg<T, typename std::enable_if<IsDeferredScalar<T>::value>::type>
+    {
+        static const bool value = true;
+        using Stored = T;
+
+        static size_t size(const T &) { return sizeof(T); }
+
+        static char *write(char *out, const T &arg)
+        {
+            memcpy(out, &arg, sizeof(T));
+            return out + sizeof(T);
+        }
+
+        static Stored read(const char *&in)
+        {
+            T arg;
+            memcpy(&arg, in, sizeof(T));
+            in += sizeof(T);
+            return arg;
+        }
+    };
+
+    template <>
+    struct DeferredArg<const char *> : DeferredStringArg<DeferredArg<const char *>, const char *>
+    {
+        static fmt::string_view view(const char *arg) { return arg ? fmt::string_view(arg) : fmt::string_view(); }
+    };
+
+    template <>
+    struct DeferredArg<char *> : DeferredStringArg<DeferredArg<char *>, const char *>
+    {
+        static fmt::string_view view(const char *arg) { return arg ? fmt::string_view(arg) : fmt::string_view(); }
+    };
+
+    template <>
+    struct DeferredArg<std::string> : DeferredStringArg<DeferredArg<std::string>, std::string>
+    {
+        static fmt::string_view view(const std::string &arg) { return fmt::string_view(arg.data(), arg.size()); }
+    };
+
+    template <>
+    struct DeferredArg<String> : DeferredStringArg<DeferredArg<String>, String>
+    {
+        static fmt::string_view view(const String &arg) { return fmt::string_view(arg.c_str(), arg.length()); }
+    };
+
+    template <>
+    struct DeferredArg<fmt::string_view> : DeferredStringArg<DeferredArg<fmt::string_view>, fmt::string_view>
+    {
+        static fmt::string_view view(fmt::string_view arg) { return arg; }
+    };
+
+    // Type returned by fmt::runtime(), its string may be gone before the drain task formats the record
+    using RuntimeFormat = decltype(fmt::runtime(fmt::string_view()));
+
+    /**
+     * Serializes a whole argument pack and formats it back from the record on the drain side.
+     *
+     * @tparam Args Argument types as passed to the log call
+     */
+    template <typename... Args>
+    struct DeferredFormat
+    {
+        static const bool value = AllOf<DeferredArg<typename std::decay<Args>::type>::value...>::value;
+
+        static size_t size(const Args &...args)
+        {
+            size_t total = 0;
+            int expand[] = {0, (total += DeferredArg<typename std::decay<Args>::type>::size(args), 0)...};
+            (void)expand;
+            return total;
+        }
+
+        static char *write(char *out, const Args &...args)
+        {
+            int expand[] = {0, (out = DeferredArg<typename std::decay<Args>::type>::write(out, args), 0)...};
+            (void)expand;
+            return out;
+        }
+
+        static void format(const char *in, fmt::string_view format, fmt::appender out)
+        {
+            formatImpl(in, format, out, typename MakeIndexSequence<sizeof...(Args)>::type());
+        }
+
+    private:
+        template <size_t... I>
+        static void formatImpl(const char *in, fmt::string_view format, fmt::appender out, IndexSequence<I...>)
+        {
+            // Braced initialization reads the arguments back in order
+            std::tuple<typename DeferredArg<typename std::decay<Args>::type>::Stored...> values{
+                DeferredArg<typename std::decay<Args>::type>::read(in)...};
+            (void)in;
+            fmt::vformat_to(out, format, fmt::make_format_args(std::get<I>(values)...));
+        }
+    };
+
+} // namespace fmtlog
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+namespace fmtlog
+{
+
+    /**
+     * Bounded lock-free multi-producer / single-consumer ring of pre-allocated slots.
+     *
+     * Producers reserve a slot, fill it in place and commit it. Each slot carries a
+     * sequence number so a producer never waits on another producer, and the consumer
+     * only sees slots once they have been committed (Vyukov bounded queue).
+     *
+     * @tparam T Slot type (stored by value, never allocated)
+     * @tparam Capacity Number of slots, must be a power of 2
+     */
+    template <typename T, size_t Capacity>
+    class MpscRing
+    {
+        static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "MpscRing capacity must be a power of 2");
+
+    private:
+        struct Cell
+        {
+            std::atomic<size_t> sequence;
+            T value;
+        };
+
+        static const size_t MASK = Capacity - 1;
+
+        Cell _cells[Capacity];
+        std::atomic<size_t> _head; // Next position to reserve (producers)
+        std::atomic<size_t> _tail; // Next position to consume (consumer)
+
+    public:
+        MpscRing() : _head(0), _tail(0)
+        {
+            for (size_t i = 0; i < Capacity; ++i)
+                _cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        MpscRing(const MpscRing &) = delete;
+        MpscRing &operator=(const MpscRing &) = delete;
+
+        /**
+         * Reserves a slot for writing. Never blocks.
+         *
+         * @param ticket Set to the position to pass to commit()
+         * @return Pointer to the slot, or nullptr if the ring is full
+         */
+        T *reserve(size_t &ticket)
+        {
+            size_t pos = _head.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                Cell &cell = _cells[pos & MASK];
+                size_t seq = cell.sequence.load(std::memory_order_acquire);
+                intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+
+                if (diff == 0)
+                {
+                    if (_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        ticket = pos;
+                        return &cell.value;
+                    }
+                }
+                else if (diff < 0)
+                {
+                    return nullptr;
+                }
+                else
+                {
+                    pos = _head.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        /**
+         * Publishes a slot previously returned by reserve() to the consumer.
+         */
+        void commit(size_t ticket)
+        {
+            _cells[ticket & MASK].sequence.store(ticket + 1, std::memory_order_release);
+        }
+
+        /**
+         * Consumer only. Returns the oldest committed slot without removing it.
+         *
+         * @return Pointer to the slot, or nullptr if nothing is ready
+         */
+        T *front()
+        {
+            size_t pos = _tail.load(std::memory_order_relaxed);
+            Cell &cell = _cells[pos & MASK];
+            if (cell.sequence.load(std::memory_order_acquire) != pos + 1)
+                return nullptr;
+            return &cell.value;
+        }
+
+        /**
+         * Consumer only. Releases the slot returned by front() back to producers.
+         */
+        void pop()
+        {
+            size_t pos = _tail.load(std::memory_order_relaxed);
+            _cells[pos & MASK].sequence.store(pos + Capacity, std::memory_order_release);
+            _tail.store(pos + 1, std::memory_order_release);
+        }
+
+        /**
+         * @return Position that will be assigned to the next reserved slot
+         */
+        size_t headPosition() const { return _head.load(std::memory_order_acquire); }
+
+        /**
+         * @return Number of slots the consumer has released so far
+         */
+        size_t tailPosition() const { return _tail.load(std::memory_order_acquire); }
+
+        bool empty() const { return tailPosition() == headPosition(); }
+
+        static constexpr size_t capacity() { return Capacity; }
+    };
+
+} // namespace fmtlog
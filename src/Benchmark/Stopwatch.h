@@ -1,6 +1,7 @@
 #pragma once
 
 #include <Arduino.h>
+#include "Config/Preamble.h"
 
 namespace fmtlog
 {
@@ -17,16 +18,18 @@ namespace fmtlog
 
         uint32_t elapsedMs() const { return millis() - _startMs; }
 
-        const char *elapsedTime() const
+        // Returned by value so stopwatches on different tasks never share a buffer
+        TimeText elapsedTime() const
         {
-            static char buf[16];
+            TimeText time;
             uint32_t ms = elapsedMs();
             uint32_t seconds = ms / 1000;
             uint32_t minutes = seconds / 60;
             uint32_t hours = minutes / 60;
-            snprintf(buf, sizeof(buf), "%02lu:%02lu:%02lu:%03lu",
-                     hours, minutes % 60, seconds % 60, ms % 1000);
-            return buf;
+            int length = snprintf(time.text, sizeof(time.text), "%02lu:%02lu:%02lu:%03lu",
+                                  (unsigned long)hours, (unsigned long)(minutes % 60), (unsigned long)(seconds % 60), (unsigned long)(ms % 1000));
+            time.length = length < 0 ? 0 : static_cast<uint8_t>(length);
+            return time;
         }
     };
 
@@ -44,17 +47,19 @@ namespace fmtlog
 
         uint32_t elapsedMs() const { return elapsedUs() / 1000; }
 
-        const char *elapsedTime() const
+        TimeText elapsedTime() const
         {
-            static char buf[20];
+            TimeText time;
             uint32_t us = elapsedUs();
             uint32_t ms = us / 1000;
             uint32_t seconds = ms / 1000;
             uint32_t minutes = seconds / 60;
             uint32_t hours = minutes / 60;
-            snprintf(buf, sizeof(buf), "%02lu:%02lu:%02lu:%03lu:%03lu",
-                     hours, minutes % 60, seconds % 60, ms % 1000, us % 1000);
-            return buf;
+            int length = snprintf(time.text, sizeof(time.text), "%02lu:%02lu:%02lu:%03lu:%03lu",
+                                  (unsigned long)hours, (unsigned long)(minutes % 60), (unsigned long)(seconds % 60),
+                                  (unsigned long)(ms % 1000), (unsigned long)(us % 1000));
+            time.length = length < 0 ? 0 : static_cast<uint8_t>(length);
+            return time;
         }
     };
 
@@ -31,6 +31,20 @@
 #define LOG_FILENAME_LINENUMBER_ENABLE 2
 #define LOG_FILENAME_LINENUMBER_FUNCTION_ENABLE 3
 
+#define LOG_ASYNC_FULL_BLOCK 0 // Wait for the drain task to free a slot
+#define LOG_ASYNC_FULL_DROP 1  // Drop the message and count it
+
+#define LOG_STREAM_FULL_BLOCK 0    // Wait until the Stream takes the whole line
+#define LOG_STREAM_FULL_DROP 1     // Drop the line and count it
+#define LOG_STREAM_FULL_DROP_LOW 2 // Drop lines less severe than LOG_STREAM_KEEP_LEVEL, wait for the others
+#define LOG_STREAM_FULL_TRUNCATE 3 // Write what fits, ending the line with LOG_STREAM_TRUNCATED_MARKER
+
+#define LOG_POOL_EXHAUSTED_HEAP 0 // Take the buffer from the heap and count it
+#define LOG_POOL_EXHAUSTED_FAIL 1 // Call LOG_POOL_EXHAUSTED_HANDLER
+
+#define LOG_FILE_ROTATION_RENAME 0   // log.txt, log.1.txt, log.2.txt ... renamed one step on every rotation
+#define LOG_FILE_ROTATION_SEGMENTS 1 // log.000001.txt, log.000002.txt ... numbered once, only the oldest is removed
+
 /**--------------------------------------------------------------------------------------
  * ANSI Colors
  *-------------------------------------------------------------------------------------*/
@@ -85,4 +99,10 @@ namespace fmtlog
         LINENUMBER_FUNCTION_ENABLE = LOG_FILENAME_LINENUMBER_FUNCTION_ENABLE
     };
 
+    enum class FileRotation
+    {
+        RENAME = LOG_FILE_ROTATION_RENAME,
+        SEGMENTS = LOG_FILE_ROTATION_SEGMENTS
+    };
+
 } // namespace fmtlog
@@ -1,5 +1,8 @@
 #include "Preamble.h"
 #include <sys/time.h>
+#include <string.h>
+#include <strings.h>
+#include <atomic>
 #include <Arduino.h>
 
 namespace fmtlog
@@ -15,114 +18,241 @@ namespace fmtlog
         return logLevelTexts[(static_cast<int>(format))][static_cast<int>(level)];
     }
 
-    const char *formatTime(LogTime format)
+    bool parseLogLevel(const char *text, size_t length, LogLevel &level)
     {
-        static char timeFormat[64] = {0};
+        if (length == 1 && text[0] >= '0' && text[0] <= '0' + LOG_LEVEL_TRACE)
+        {
+            level = static_cast<LogLevel>(text[0] - '0');
+            return true;
+        }
 
-        if (format == LogTime::DISABLE)
+        if ((length == 7 && strncasecmp(text, "DISABLE", length) == 0) || (length == 3 && strncasecmp(text, "OFF", length) == 0))
         {
-            timeFormat[0] = '\0'; // No time format
-            return timeFormat;
+            level = LogLevel::DISABLE;
+            return true;
         }
 
-        if (format == LogTime::LOCALTIME)
+        for (int format = LOG_LEVEL_TEXT_FORMAT_LETTER; format <= LOG_LEVEL_TEXT_FORMAT_FULL; ++format)
         {
-            struct tm timeinfo;
-            time_t now;
-            time(&now);
-            localtime_r(&now, &timeinfo);
-            if (timeinfo.tm_year > (2016 - 1900)) // Check if time has been initialized
+            for (int value = LOG_LEVEL_ERROR; value <= LOG_LEVEL_TRACE; ++value)
             {
-                timeval tv;
-                gettimeofday(&tv, NULL);
-                sprintf(timeFormat, "%04d-%02d-%02d %02d:%02d:%02d.%03ld",
-                        timeinfo.tm_year + 1900, timeinfo.tm_mon + 1, timeinfo.tm_mday,
-                        timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec, tv.tv_usec / 1000);
-            }
-            else
-            {
-                timeFormat[0] = '\0';
+                const char *name = logLevelText(static_cast<LogLevel>(value), static_cast<LogLevelTextFormat>(format));
+                if (strlen(name) == length && strncasecmp(text, name, length) == 0)
+                {
+                    level = static_cast<LogLevel>(value);
+                    return true;
+                }
             }
         }
-        else if (format == LogTime::HHHHMMSSMS)
+        return false;
+    }
+
+    LogTimestamp captureTimestamp(LogTime format)
+    {
+        LogTimestamp timestamp;
+        if (format == LogTime::LOCALTIME)
+            gettimeofday(&timestamp.wall, NULL);
+        else if (format == LogTime::MICROS)
+            timestamp.micros = micros();
+        else
+            timestamp.millis = millis();
+        return timestamp;
+    }
+
+    namespace
+    {
+        /**
+         * Integer to ASCII, right-aligned to at least width characters with fill.
+         *
+         * @return Pointer past the last character written
+         */
+        char *writeUnsigned(char *out, unsigned long value, int width, char fill)
         {
-            unsigned long ms = millis();
-            unsigned long seconds = ms / 1000;
-            unsigned long minutes = seconds / 60;
-            unsigned long hours = minutes / 60;
-            sprintf(timeFormat, "%04lu:%02lu:%02lu:%03lu", hours, minutes % 60, seconds % 60, ms % 1000);
+            char digits[20];
+            int count = 0;
+            do
+            {
+                digits[count++] = static_cast<char>('0' + value % 10);
+                value /= 10;
+            } while (value);
+
+            for (; width > count; --width)
+                *out++ = fill;
+            while (count)
+                *out++ = digits[--count];
+            return out;
         }
-        else if (format == LogTime::HHMMSSMS)
+
+        /**
+         * Last rendered "YYYY-MM-DD HH:MM:SS." / "HH:MM:SS:" prefix, shared by all callers.
+         * The sequence is odd while a caller updates it, so readers can copy it without a lock
+         * and retry on their own copy if it changed underneath them.
+         */
+        struct TimePrefixCache
         {
-            unsigned long ms = millis();
-            unsigned long seconds = ms / 1000;
-            unsigned long minutes = seconds / 60;
-            unsigned long hours = minutes / 60;
-            sprintf(timeFormat, "%02lu:%02lu:%02lu:%03lu", hours % 24, minutes % 60, seconds % 60, ms % 1000);
+            std::atomic<uint32_t> sequence{0};
+            LogTime format = LogTime::DISABLE;
+            unsigned long second = 0;
+            uint8_t length = 0;
+            char text[24];
+        };
+
+        TimePrefixCache timePrefixCache;
+
+        bool readTimePrefix(LogTime format, unsigned long second, char *out, uint8_t &length)
+        {
+            TimePrefixCache &cache = timePrefixCache;
+            uint32_t sequence = cache.sequence.load(std::memory_order_acquire);
+            if ((sequence & 1) || cache.format != format || cache.second != second)
+                return false;
+
+            length = cache.length;
+            memcpy(out, cache.text, length);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return cache.sequence.load(std::memory_order_relaxed) == sequence;
         }
-        else if (format == LogTime::MICROS)
+
+        void writeTimePrefix(LogTime format, unsigned long second, const char *text, uint8_t length)
         {
-            sprintf(timeFormat, "%10lu", micros());
+            TimePrefixCache &cache = timePrefixCache;
+            uint32_t sequence = cache.sequence.load(std::memory_order_relaxed);
+            if ((sequence & 1) || !cache.sequence.compare_exchange_strong(sequence, sequence + 1, std::memory_order_acquire))
+                return; // Another caller is updating it
+
+            cache.format = format;
+            cache.second = second;
+            cache.length = length;
+            memcpy(cache.text, text, length);
+            cache.sequence.store(sequence + 2, std::memory_order_release);
         }
-        else if (format == LogTime::MILLIS || format == LogTime::ENABLE)
+
+        /**
+         * Renders the part of the time that only changes once per second.
+         *
+         * @return Prefix length, 0 if the local time has not been set yet
+         */
+        uint8_t renderTimePrefix(LogTime format, const LogTimestamp &timestamp, char *out)
         {
-            sprintf(timeFormat, "%7lu", millis());
+            char *end = out;
+            if (format == LogTime::LOCALTIME)
+            {
+                struct tm timeinfo;
+                time_t now = timestamp.wall.tv_sec;
+                localtime_r(&now, &timeinfo);
+                if (timeinfo.tm_year <= (2016 - 1900)) // Check if time has been initialized
+                    return 0;
+
+                end = writeUnsigned(end, timeinfo.tm_year + 1900, 4, '0');
+                *end++ = '-';
+                end = writeUnsigned(end, timeinfo.tm_mon + 1, 2, '0');
+                *end++ = '-';
+                end = writeUnsigned(end, timeinfo.tm_mday, 2, '0');
+                *end++ = ' ';
+                end = writeUnsigned(end, timeinfo.tm_hour, 2, '0');
+                *end++ = ':';
+                end = writeUnsigned(end, timeinfo.tm_min, 2, '0');
+                *end++ = ':';
+                end = writeUnsigned(end, timeinfo.tm_sec, 2, '0');
+                *end++ = '.';
+            }
+            else
+            {
+                unsigned long seconds = timestamp.millis / 1000;
+                unsigned long minutes = seconds / 60;
+                unsigned long hours = minutes / 60;
+                if (format == LogTime::HHMMSSMS)
+                    end = writeUnsigned(end, hours % 24, 2, '0');
+                else
+                    end = writeUnsigned(end, hours, 4, '0');
+                *end++ = ':';
+                end = writeUnsigned(end, minutes % 60, 2, '0');
+                *end++ = ':';
+                end = writeUnsigned(end, seconds % 60, 2, '0');
+                *end++ = ':';
+            }
+            return static_cast<uint8_t>(end - out);
         }
+    }
+
+    TimeText formatTime(LogTime format)
+    {
+        if (format == LogTime::DISABLE)
+            return TimeText(); // No time format
 
-        return timeFormat;
+        return formatTime(format, captureTimestamp(format));
     }
 
-    const char *formatFilename(const char *file, int line, const char *func, LogFilename format)
+    TimeText formatTime(LogTime format, const LogTimestamp &timestamp)
     {
-        static char result[64] = {0};
+        TimeText result;
 
-        if (format == LogFilename::DISABLE)
-        {
-            result[0] = '\0';
-            return result;
-        }
+        if (format == LogTime::DISABLE)
+            return result; // No time format
 
-        const char *filename = strrchr(file, '/') ? strrchr(file, '/') + 1 : strrchr(file, '\\') ? strrchr(file, '\\') + 1
-                                                                                                 : file;
+        char *end = result.text;
 
-        // Strip extension from filename
-        char nameOnly[64];
-        const char *dot = strrchr(filename, '.');
-        if (dot)
+        if (format == LogTime::MICROS)
         {
-            size_t len = dot - filename;
-            if (len >= sizeof(nameOnly))
-                len = sizeof(nameOnly) - 1;
-            strncpy(nameOnly, filename, len);
-            nameOnly[len] = '\0';
+            end = writeUnsigned(end, timestamp.micros, 10, ' ');
         }
-        else
+        else if (format == LogTime::MILLIS || format == LogTime::ENABLE)
         {
-            strncpy(nameOnly, filename, sizeof(nameOnly) - 1);
-            nameOnly[sizeof(nameOnly) - 1] = '\0';
+            end = writeUnsigned(end, timestamp.millis, 7, ' ');
         }
-
-        if (format == LogFilename::LINENUMBER_FUNCTION_ENABLE)
+        else
         {
-            if (func)
-            {
-                snprintf(result, sizeof(result), "%s:%d %s()", nameOnly, line, func);
-            }
-            else
+            // Date and clock are re-rendered once per second, only the milliseconds are written per call
+            bool local = format == LogTime::LOCALTIME;
+            unsigned long second = local ? static_cast<unsigned long>(timestamp.wall.tv_sec) : timestamp.millis / 1000;
+            unsigned long ms = local ? static_cast<unsigned long>(timestamp.wall.tv_usec / 1000) : timestamp.millis % 1000;
+
+            uint8_t length;
+            if (!readTimePrefix(format, second, end, length))
             {
-                snprintf(result, sizeof(result), "%s:%d", nameOnly, line);
+                length = renderTimePrefix(format, timestamp, end);
+                writeTimePrefix(format, second, end, length);
             }
+            if (length == 0)
+                return result;
+            end = writeUnsigned(end + length, ms, 3, '0');
         }
-        else if (format == LogFilename::LINENUMBER_ENABLE)
+
+        *end = '\0';
+        result.length = static_cast<uint8_t>(end - result.text);
+        return result;
+    }
+
+    const char *renderSourceFragment(char *out, size_t size, const char *file, int line, const char *func, LogFilename format)
+    {
+        if (format == LogFilename::DISABLE)
+        {
+            out[0] = '\0';
+            return out;
+        }
+
+        const char *name = sourceBasename(file);
+        int stem = static_cast<int>(sourceStemLength(name));
+
+        if (format == LogFilename::LINENUMBER_FUNCTION_ENABLE && func)
+        {
+            snprintf(out, size, "%.*s:%d %s()", stem, name, line, func);
+        }
+        else if (format == LogFilename::LINENUMBER_FUNCTION_ENABLE || format == LogFilename::LINENUMBER_ENABLE)
         {
-            snprintf(result, sizeof(result), "%s:%d", nameOnly, line);
+            snprintf(out, size, "%.*s:%d", stem, name, line);
         }
-        else if (format == LogFilename::ENABLE)
+        else
         {
-            strncpy(result, nameOnly, sizeof(result) - 1);
-            result[sizeof(result) - 1] = '\0';
+            snprintf(out, size, "%.*s", stem, name);
         }
 
+        return out;
+    }
+
+    FilenameText formatFilename(const char *file, int line, const char *func, LogFilename format)
+    {
+        FilenameText result;
+        renderSourceFragment(result.text, sizeof(result.text), file, line, func, format);
         return result;
     }
 
@@ -1,11 +1,139 @@
 #pragma once
 
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/time.h>
 #include "Config/Options.h"
+#include "fmt.h"
 
 namespace fmtlog
 {
+    /**
+     * Clock readings taken when a message is logged, so its preamble can be rendered later.
+     */
+    struct LogTimestamp
+    {
+        unsigned long millis = 0;
+        unsigned long micros = 0;
+        timeval wall = {0, 0};
+    };
+
+    /**
+     * Rendered time preamble. Returned by value so concurrent callers never share a buffer.
+     * Formattable with fmt directly, or use c_str().
+     */
+    struct TimeText
+    {
+        char text[32];
+        uint8_t length = 0;
+
+        TimeText() { text[0] = '\0'; }
+        const char *c_str() const { return text; }
+    };
+
+    /**
+     * Rendered filename preamble, returned by value like TimeText. Holds the text, or points at a
+     * fragment rendered once per call site. Formattable with fmt directly, or use c_str().
+     */
+    struct FilenameText
+    {
+        const char *fragment = nullptr;
+        char text[64];
+
+        FilenameText() { text[0] = '\0'; }
+        explicit FilenameText(const char *fragment) : fragment(fragment) { text[0] = '\0'; }
+        const char *c_str() const { return fragment ? fragment : text; }
+    };
+
     const char *logLevelText(LogLevel level, LogLevelTextFormat format = LogLevelTextFormat::FULL);
-    const char *formatTime(LogTime format = LogTime::MILLIS);
-    const char *formatFilename(const char *file, int line = 0, const char *func = nullptr, LogFilename format = LogFilename::ENABLE);
+
+    /**
+     * Parses a level name in any LogLevelTextFormat ("DEBUG", "DBUG", "D"), case-insensitive,
+     * "DISABLE" / "OFF", or its number ("4").
+     *
+     * @return false if the text is not a level
+     */
+    bool parseLogLevel(const char *text, size_t length, LogLevel &level);
+    TimeText formatTime(LogTime format = LogTime::MILLIS);
+
+    /**
+     * Renders the time preamble of a timestamp captured earlier with captureTimestamp().
+     */
+    TimeText formatTime(LogTime format, const LogTimestamp &timestamp);
+    FilenameText formatFilename(const char *file, int line = 0, const char *func = nullptr, LogFilename format = LogFilename::ENABLE);
     const char *colorText(LogLevel level);
+
+    /**
+     * Renders the filename preamble ("name", "name:12" or "name:12 func()") into a caller-provided buffer.
+     *
+     * @return out
+     */
+    const char *renderSourceFragment(char *out, size_t size, const char *file, int line, const char *func, LogFilename format);
+
+    /**
+     * Reads the clocks needed to render the given time format.
+     */
+    LogTimestamp captureTimestamp(LogTime format);
+
+    /**--------------------------------------------------------------------------------------
+     * Compile-time filename helpers, evaluated on __FILE__ / __LINE__ at each call site
+     *-------------------------------------------------------------------------------------*/
+
+    constexpr const char *sourceBasename(const char *path, const char *name)
+    {
+        return *path == '\0' ? name : sourceBasename(path + 1, (*path == '/' || *path == '\\') ? path + 1 : name);
+    }
+
+    /**
+     * @return Pointer past the last '/' or '\\' of path
+     */
+    constexpr const char *sourceBasename(const char *path)
+    {
+        return sourceBasename(path, path);
+    }
+
+    /**
+     * @return Length of name up to its last '.', or the whole length if it has no extension
+     */
+    constexpr size_t sourceStemLength(const char *name, size_t index = 0, size_t dot = static_cast<size_t>(-1))
+    {
+        return name[index] == '\0' ? (dot == static_cast<size_t>(-1) ? index : dot)
+                                   : sourceStemLength(name, index + 1, name[index] == '.' ? index : dot);
+    }
+
+    constexpr size_t decimalDigits(int value)
+    {
+        return value < 10 ? 1 : 1 + decimalDigits(value / 10);
+    }
+
+    /**
+     * @return Buffer size needed by renderSourceFragment(), including the terminating null
+     */
+    constexpr size_t sourceFragmentSize(const char *file, int line, size_t funcSize, LogFilename format)
+    {
+        return format == LogFilename::DISABLE             ? 1
+               : format == LogFilename::ENABLE            ? sourceStemLength(sourceBasename(file)) + 1
+               : format == LogFilename::LINENUMBER_ENABLE ? sourceStemLength(sourceBasename(file)) + 1 + decimalDigits(line) + 1
+                                                          : sourceStemLength(sourceBasename(file)) + 1 + decimalDigits(line) + 1 + funcSize + 2;
+    }
 }
+
+template <>
+struct fmt::formatter<fmtlog::TimeText> : fmt::formatter<fmt::string_view>
+{
+    template <typename FormatContext>
+    auto format(const fmtlog::TimeText &time, FormatContext &ctx) const -> decltype(ctx.out())
+    {
+        return fmt::formatter<fmt::string_view>::format(fmt::string_view(time.text, time.length), ctx);
+    }
+};
+
+template <>
+struct fmt::formatter<fmtlog::FilenameText> : fmt::formatter<fmt::string_view>
+{
+    template <typename FormatContext>
+    auto format(const fmtlog::FilenameText &filename, FormatContext &ctx) const -> decltype(ctx.out())
+    {
+        return fmt::formatter<fmt::string_view>::format(fmt::string_view(filename.c_str()), ctx);
+    }
+};
@@ -12,10 +12,90 @@
 #define LOG_STATIC_BUFFER_SIZE 128
 #endif
 
+#ifndef LOG_CHUNKED_ENABLE
+#define LOG_CHUNKED_ENABLE 0 // Messages longer than LOG_STATIC_BUFFER_SIZE are written to the outputs in chunks while they are formatted, instead of growing a buffer. Set to 1 to enable.
+#endif
+
+#ifndef LOG_MESSAGE_MAX_SIZE
+#define LOG_MESSAGE_MAX_SIZE 0 // Longest message body in bytes, the rest is cut and replaced by LOG_MESSAGE_TRUNCATED_FORMAT (0 = no limit)
+#endif
+
+#ifndef LOG_MESSAGE_TRUNCATED_FORMAT
+#define LOG_MESSAGE_TRUNCATED_FORMAT "...[truncated {} bytes]" // {bytes}
+#endif
+
+#ifndef LOG_STACK_LIGHT_ENABLE
+#define LOG_STACK_LIGHT_ENABLE 0 // Format in buffers owned by the logger instead of on the caller's stack, for tasks with small stacks. Set to 1 to enable.
+#endif
+
+#if LOG_STACK_LIGHT_ENABLE && !defined(LOG_SHARED_BUFFER_COUNT)
+#define LOG_SHARED_BUFFER_COUNT 2 // Message bodies formatted at the same time, a call that finds all taken uses its own stack
+#endif
+
+#ifndef LOG_POOL_ENABLE
+#define LOG_POOL_ENABLE 0 // Lines longer than LOG_STATIC_BUFFER_SIZE take a block from a pool reserved at startup instead of the heap. Set to 1 to enable.
+#endif
+
+#if LOG_POOL_ENABLE
+
+#ifndef LOG_POOL_BLOCK_SIZE
+#define LOG_POOL_BLOCK_SIZE 512 // Bytes per block, the longest line the pool serves
+#endif
+
+#ifndef LOG_POOL_BLOCK_COUNT
+#define LOG_POOL_BLOCK_COUNT 4 // Blocks reserved, a long line being built needs up to three (message, line, and a copy while growing)
+#endif
+
+#ifndef LOG_POOL_EXHAUSTED_POLICY
+#define LOG_POOL_EXHAUSTED_POLICY LOG_POOL_EXHAUSTED_HEAP // What a line does when no block is free or it doesn't fit in one
+#endif
+
+#ifndef LOG_POOL_EXHAUSTED_HANDLER
+#define LOG_POOL_EXHAUSTED_HANDLER LOG_PANIC_HANDLER // LOG_POOL_EXHAUSTED_FAIL: called instead of using the heap
+#endif
+
+#endif // LOG_POOL_ENABLE
+
+#ifndef LOG_BUFFER_ALLOCATOR
+#if LOG_POOL_ENABLE
+#define LOG_BUFFER_ALLOCATOR fmtlog::PoolAllocator<char> // Allocator for lines longer than LOG_STATIC_BUFFER_SIZE
+#else
+#define LOG_BUFFER_ALLOCATOR std::allocator<char>
+#endif
+#endif
+
 #ifndef LOG_STREAM
 #define LOG_STREAM Serial
 #endif
 
+#ifndef LOG_STREAM_FULL_POLICY
+#define LOG_STREAM_FULL_POLICY LOG_STREAM_FULL_BLOCK // What a line does when availableForWrite() is less than its size
+#endif
+
+#ifndef LOG_STREAM_KEEP_LEVEL
+#define LOG_STREAM_KEEP_LEVEL LOG_LEVEL_WARN // LOG_STREAM_FULL_DROP_LOW: this level and more severe ones wait instead of being dropped
+#endif
+
+#ifndef LOG_STREAM_TRUNCATED_MARKER
+#define LOG_STREAM_TRUNCATED_MARKER "~" LOG_EOL // LOG_STREAM_FULL_TRUNCATE: ends a truncated line
+#endif
+
+#ifndef LOG_MAX_OUTPUTS
+#define LOG_MAX_OUTPUTS 2 // Extra outputs added with LOG_ADD_STREAM / LOG_ADD_FILE_STORAGE
+#endif
+
+#ifndef LOG_TAG_LIST
+#define LOG_TAG_LIST(TAG) // Module tags, e.g. TAG(wifi) TAG(sensor), see Config/Tags.h
+#endif
+
+#ifndef LOG_TAG_LEVEL_LIST
+#define LOG_TAG_LEVEL_LIST(TAG_LEVEL) // Most verbose level compiled in per tag, e.g. TAG_LEVEL(wifi, LOG_LEVEL_WARN)
+#endif
+
+#ifndef LOG_TAG
+#define LOG_TAG UNTAGGED // Tag of the translation unit, define before including the logger
+#endif
+
 #ifndef LOG_LEVEL
 #define LOG_LEVEL LOG_LEVEL_TRACE
 #endif
@@ -42,6 +122,11 @@
 
 #ifndef LOG_PREAMBLE_ARGS
 #define LOG_PREAMBLE_ARGS(level, filename, linenumber, function) DEFAULT_PREAMBLE_ARGS(level, filename, linenumber, function)
+#define LOG_PREAMBLE_LOCATION_ARGS(level, loc, timestamp) DEFAULT_PREAMBLE_LOCATION_ARGS(level, loc, timestamp)
+#define LOG_SOURCE_FRAGMENT (LOG_FILENAME != LOG_FILENAME_DISABLE) // Render the filename preamble once per call site
+#else
+#define LOG_PREAMBLE_LOCATION_ARGS(level, loc, timestamp) LOG_PREAMBLE_ARGS(level, (loc).filename, (loc).line, (loc).funcname)
+#define LOG_SOURCE_FRAGMENT 0
 #endif
 
 #ifndef LOG_PRINT_ENABLE
@@ -60,6 +145,10 @@
 #define LOG_CHECK_FORMAT "[CHECK] ({}) {}" // [CHECK] ({expr}) {message}
 #endif
 
+#ifndef LOG_SUPPRESSED_FORMAT
+#define LOG_SUPPRESSED_FORMAT " ({} suppressed)" // Appended by throttled macros, {count} calls suppressed since the last message
+#endif
+
 #ifndef LOG_BENCHMARK_FORMAT
 #define LOG_BENCHMARK_FORMAT "[{}] elapsed {} ms" // [BENCH] {tag} elapsed {ms}ms
 #endif
@@ -89,6 +178,26 @@ inline void _logPanic()
 #define LOG_FORMATTER "[{}]"
 #endif
 
+#ifndef LOG_DEDUP_ENABLE
+#define LOG_DEDUP_ENABLE 0 // Hold back consecutive identical messages per output and write a summary instead
+#endif
+
+#if LOG_DEDUP_ENABLE
+
+#ifndef LOG_DEDUP_TIMEOUT_MS
+#define LOG_DEDUP_TIMEOUT_MS 10000 // Longest span one summary covers, a later repeat is written again. Summaries go out with the next message or flush
+#endif
+
+#ifndef LOG_DEDUP_FORMAT
+#define LOG_DEDUP_FORMAT "Last message repeated {} times in {} ms" // {count} {span}
+#endif
+
+#ifndef LOG_DEDUP_COMPARE_SIZE
+#define LOG_DEDUP_COMPARE_SIZE 32 // Leading bytes of the last message kept per output, compared with a new one whose hash and length match
+#endif
+
+#endif // LOG_DEDUP_ENABLE
+
 #ifndef LOG_FILE_ENABLE
 #define LOG_FILE_ENABLE 0
 #endif
@@ -119,16 +228,209 @@ inline void _logPanic()
 #define LOG_FILE_NEW_ON_BOOT 0 // Rotate on first write to preserve old log file. Set to 1 to enable.
 #endif
 
+#ifndef LOG_FILE_FLUSH_ON_WRITE
+#define LOG_FILE_FLUSH_ON_WRITE 1 // Flush every time a sink writes to the file. Set to 0 and use the settings below to flush less often.
+#endif
+
+#ifndef LOG_FILE_FLUSH_BYTES
+#define LOG_FILE_FLUSH_BYTES 0 // Flush once this many bytes were logged since the last flush, 0 = off
+#endif
+
+#ifndef LOG_FILE_FLUSH_INTERVAL_MS
+#define LOG_FILE_FLUSH_INTERVAL_MS 0 // Flush on the first line this long after the last flush, 0 = off
+#endif
+
+#ifndef LOG_FILE_FLUSH_LEVEL
+#define LOG_FILE_FLUSH_LEVEL LOG_LEVEL_DISABLE // Flush right after lines at this level or more severe, e.g. LOG_LEVEL_ERROR
+#endif
+
+#ifndef LOG_FILE_ROTATION
+#define LOG_FILE_ROTATION LOG_FILE_ROTATION_RENAME // LOG_FILE_ROTATION_SEGMENTS rotates in constant time, whatever LOG_FILE_MAX_FILES
+#endif
+
+#ifndef LOG_FILE_PREALLOCATE
+#define LOG_FILE_PREALLOCATE 0 // Reserve LOG_FILE_MAX_SIZE of contiguous space for each new log file (SdFat), so appends never allocate clusters. Set to 1 to enable.
+#endif
+
+#ifndef LOG_FILE_ALIGN_WRITES
+#define LOG_FILE_ALIGN_WRITES 0 // Write the buffer in whole sectors (see FileSystemSectorSize) and carry the rest over, only flushes write a partial sector. Set to 1 to enable.
+#endif
+
+#ifndef LOG_FILE_BACKGROUND
+#define LOG_FILE_BACKGROUND 0 // Write, flush and rotate the log file on a background task, callers only fill buffers. Set to 1 to enable.
+#endif
+
+#if LOG_FILE_BACKGROUND
+
+#ifndef LOG_FILE_BACKGROUND_BUFFERS
+#define LOG_FILE_BACKGROUND_BUFFERS 2 // Number of LOG_FILE_MAX_BUFFER_SIZE buffers: one being filled, the others written by the task
+#endif
+
+#ifndef LOG_FILE_TASK_STACK_SIZE
+#define LOG_FILE_TASK_STACK_SIZE 4096
+#endif
+
+#ifndef LOG_FILE_TASK_PRIORITY
+#define LOG_FILE_TASK_PRIORITY 1
+#endif
+
+#ifndef LOG_FILE_TASK_CORE
+#define LOG_FILE_TASK_CORE -1 // -1 = no core affinity
+#endif
+
+#endif // LOG_FILE_BACKGROUND
+
 #ifndef LOG_FILE_PREAMBLE_FORMAT
 #define LOG_FILE_PREAMBLE_FORMAT DEFAULT_FILE_PREAMBLE_FORMAT
 #endif
 
 #ifndef LOG_FILE_PREAMBLE_ARGS
 #define LOG_FILE_PREAMBLE_ARGS(level, filename, linenumber, function) DEFAULT_FILE_PREAMBLE_ARGS(level, filename, linenumber, function)
+#define LOG_FILE_PREAMBLE_LOCATION_ARGS(level, loc, timestamp) DEFAULT_FILE_PREAMBLE_LOCATION_ARGS(level, loc, timestamp)
+#else
+#define LOG_FILE_PREAMBLE_LOCATION_ARGS(level, loc, timestamp) LOG_FILE_PREAMBLE_ARGS(level, (loc).filename, (loc).line, (loc).funcname)
 #endif
 
 #endif // LOG_FILE_ENABLE
 
+#ifndef LOG_THREAD_SAFE
+#define LOG_THREAD_SAFE 0 // Serialize writes of concurrent log calls from several tasks / cores. Set to 1 to enable.
+#endif
+
+#ifndef LOG_ISR_ENABLE
+#define LOG_ISR_ENABLE 0 // LOG_ISR_* macros for interrupt handlers, formatted later by task-level code. Set to 1 to enable.
+#endif
+
+#if LOG_ISR_ENABLE
+
+#ifndef LOG_ISR_QUEUE_SIZE
+#define LOG_ISR_QUEUE_SIZE 16 // Number of records per interrupt context, must be a power of 2
+#endif
+
+#ifndef LOG_ISR_MAX_ARGS
+#define LOG_ISR_MAX_ARGS 4 // Max arguments per LOG_ISR_* call, 32 bits each
+#endif
+
+#ifndef LOG_ISR_CLAIM_ATTEMPTS
+#define LOG_ISR_CLAIM_ATTEMPTS 4 // Slot claims lost to other writers of the same ring before the record is dropped
+#endif
+
+#ifndef LOG_ISR_CONTEXTS
+#if defined(ESP32)
+#define LOG_ISR_CONTEXTS 2 // One ring per core
+#else
+#define LOG_ISR_CONTEXTS 1
+#endif
+#endif
+
+#ifndef LOG_ISR_CONTEXT
+#if defined(ESP32)
+#define LOG_ISR_CONTEXT() xPortGetCoreID() // Ring written by the calling interrupt handler, must be below LOG_ISR_CONTEXTS
+#else
+#define LOG_ISR_CONTEXT() 0
+#endif
+#endif
+
+#ifndef LOG_ISR_ATTR
+#if defined(ESP32)
+#define LOG_ISR_ATTR IRAM_ATTR // Keep the record path callable while the flash cache is disabled
+#else
+#define LOG_ISR_ATTR
+#endif
+#endif
+
+#endif // LOG_ISR_ENABLE
+
+#ifndef LOG_ASYNC_ENABLE
+#define LOG_ASYNC_ENABLE 0
+#endif
+
+#if LOG_ASYNC_ENABLE
+
+#ifndef LOG_ASYNC_QUEUE_SIZE
+#define LOG_ASYNC_QUEUE_SIZE 32 // Number of queued messages, must be a power of 2
+#endif
+
+#ifndef LOG_ASYNC_RECORD_SIZE
+#define LOG_ASYNC_RECORD_SIZE LOG_STATIC_BUFFER_SIZE // Max message bytes per queued record (source location and timestamp are stored beside them), longer messages are truncated
+#endif
+
+#ifndef LOG_ASYNC_FULL_POLICY
+#define LOG_ASYNC_FULL_POLICY LOG_ASYNC_FULL_BLOCK
+#endif
+
+#ifndef LOG_ASYNC_TASK_STACK_SIZE
+#define LOG_ASYNC_TASK_STACK_SIZE 4096
+#endif
+
+#ifndef LOG_ASYNC_TASK_PRIORITY
+#define LOG_ASYNC_TASK_PRIORITY 1
+#endif
+
+#ifndef LOG_ASYNC_TASK_CORE
+#define LOG_ASYNC_TASK_CORE -1 // -1 = no core affinity
+#endif
+
+#ifndef LOG_ASYNC_DEFERRED
+#define LOG_ASYNC_DEFERRED 0 // Copy raw arguments at the call site and format on the drain task. Set to 1 to enable.
+#endif
+
+#elif defined(LOG_ASYNC_DEFERRED) && LOG_ASYNC_DEFERRED
+#error "LOG_ASYNC_DEFERRED requires LOG_ASYNC_ENABLE"
+#endif // LOG_ASYNC_ENABLE
+
+#ifndef LOG_POLL_ENABLE
+#define LOG_POLL_ENABLE 0 // Cooperative mode: LOG_* calls only queue output, LOG_POLL() in loop() writes it without blocking. Set to 1 to enable.
+#endif
+
+#if LOG_POLL_ENABLE
+
+#ifndef LOG_POLL_BUFFER_SIZE
+#define LOG_POLL_BUFFER_SIZE 2048 // Bytes of queued output, lines that don't fit are dropped
+#endif
+
+#ifndef LOG_POLL_FILE_BUDGET_MS
+#define LOG_POLL_FILE_BUDGET_MS 5 // Time one LOG_POLL() may spend writing queued lines to file sinks
+#endif
+
+#endif // LOG_POLL_ENABLE
+
+#ifndef LOG_SHED_ENABLE
+#define LOG_SHED_ENABLE 0 // Drop verbose levels while writing to the outputs can't keep up. Set to 1 to enable.
+#endif
+
+#if LOG_SHED_ENABLE
+
+#ifndef LOG_SHED_WINDOW_MS
+#define LOG_SHED_WINDOW_MS 1000 // Sliding window over which the time spent writing lines is measured
+#endif
+
+#ifndef LOG_SHED_BUDGET_US
+#define LOG_SHED_BUDGET_US 200000 // Write time per window above which shedding starts (20% of the default window)
+#endif
+
+#ifndef LOG_SHED_RESTORE_US
+#define LOG_SHED_RESTORE_US (LOG_SHED_BUDGET_US / 4) // Write time per window below which shedding stops
+#endif
+
+#ifndef LOG_SHED_LEVEL
+#define LOG_SHED_LEVEL LOG_LEVEL_WARN // Most verbose level still written while shedding
+#endif
+
+#if LOG_POLL_ENABLE && !defined(LOG_SHED_BACKLOG_BYTES)
+#define LOG_SHED_BACKLOG_BYTES (LOG_POLL_BUFFER_SIZE / 2) // Cooperative mode: queued bytes above which shedding starts
+#endif
+
+#ifndef LOG_SHED_START_FORMAT
+#define LOG_SHED_START_FORMAT "Output falling behind, dropping levels below {}" // {level}
+#endif
+
+#ifndef LOG_SHED_STOP_FORMAT
+#define LOG_SHED_STOP_FORMAT "Output caught up, levels below {} dropped for {} ms" // {level} {duration}
+#endif
+
+#endif // LOG_SHED_ENABLE
+
 /**--------------------------------------------------------------------------------------
  * Static Assertions for Settings Validation
  *-------------------------------------------------------------------------------------*/
@@ -144,12 +446,49 @@ static_assert(LOG_FILENAME >= LOG_FILENAME_DISABLE && LOG_FILENAME <= LOG_FILENA
 static_assert(LOG_COLOR == LOG_COLOR_DISABLE || LOG_COLOR == LOG_COLOR_ENABLE,
               "LOG_COLOR must be either LOG_COLOR_DISABLE or LOG_COLOR_ENABLE");
 static_assert(LOG_STATIC_BUFFER_SIZE > 0, "LOG_STATIC_BUFFER_SIZE must be greater than 0");
+static_assert(LOG_CHUNKED_ENABLE == 0 || LOG_CHUNKED_ENABLE == 1,
+              "LOG_CHUNKED_ENABLE must be either 0 or 1");
+static_assert(LOG_MESSAGE_MAX_SIZE >= 0, "LOG_MESSAGE_MAX_SIZE must be greater than or equal to 0");
+static_assert(LOG_STACK_LIGHT_ENABLE == 0 || LOG_STACK_LIGHT_ENABLE == 1,
+              "LOG_STACK_LIGHT_ENABLE must be either 0 or 1");
+static_assert(LOG_POOL_ENABLE == 0 || LOG_POOL_ENABLE == 1,
+              "LOG_POOL_ENABLE must be either 0 or 1");
+static_assert(LOG_MAX_OUTPUTS >= 0, "LOG_MAX_OUTPUTS must be greater than or equal to 0");
 static_assert(LOG_PRINT_ENABLE == 0 || LOG_PRINT_ENABLE == 1,
               "LOG_PRINT_ENABLE must be either 0 or 1");
 static_assert(LOG_ASSERT_ENABLE == 0 || LOG_ASSERT_ENABLE == 1,
               "LOG_ASSERT_ENABLE must be either 0 or 1");
+static_assert(LOG_STREAM_FULL_POLICY >= LOG_STREAM_FULL_BLOCK && LOG_STREAM_FULL_POLICY <= LOG_STREAM_FULL_TRUNCATE,
+              "LOG_STREAM_FULL_POLICY must be between LOG_STREAM_FULL_BLOCK and LOG_STREAM_FULL_TRUNCATE");
+static_assert(LOG_STREAM_KEEP_LEVEL >= LOG_LEVEL_DISABLE && LOG_STREAM_KEEP_LEVEL <= LOG_LEVEL_TRACE,
+              "LOG_STREAM_KEEP_LEVEL must be between LOG_LEVEL_DISABLE and LOG_LEVEL_TRACE");
+static_assert(LOG_DEDUP_ENABLE == 0 || LOG_DEDUP_ENABLE == 1,
+              "LOG_DEDUP_ENABLE must be either 0 or 1");
+#if LOG_DEDUP_ENABLE
+static_assert(LOG_DEDUP_COMPARE_SIZE > 0, "LOG_DEDUP_COMPARE_SIZE must be greater than 0");
+#endif
 static_assert(LOG_FILE_ENABLE == 0 || LOG_FILE_ENABLE == 1,
               "LOG_FILE_ENABLE must be either 0 or 1");
+static_assert(LOG_THREAD_SAFE == 0 || LOG_THREAD_SAFE == 1,
+              "LOG_THREAD_SAFE must be either 0 or 1");
+static_assert(LOG_ISR_ENABLE == 0 || LOG_ISR_ENABLE == 1,
+              "LOG_ISR_ENABLE must be either 0 or 1");
+static_assert(LOG_ASYNC_ENABLE == 0 || LOG_ASYNC_ENABLE == 1,
+              "LOG_ASYNC_ENABLE must be either 0 or 1");
+
+#if LOG_STACK_LIGHT_ENABLE
+static_assert(LOG_SHARED_BUFFER_COUNT >= 1 && LOG_SHARED_BUFFER_COUNT <= 32,
+              "LOG_SHARED_BUFFER_COUNT must be between 1 and 32");
+#endif
+
+#if LOG_POOL_ENABLE
+static_assert(LOG_POOL_BLOCK_SIZE > LOG_STATIC_BUFFER_SIZE,
+              "LOG_POOL_BLOCK_SIZE must be greater than LOG_STATIC_BUFFER_SIZE");
+static_assert(LOG_POOL_BLOCK_COUNT >= 1 && LOG_POOL_BLOCK_COUNT <= UINT16_MAX,
+              "LOG_POOL_BLOCK_COUNT must be between 1 and 65535");
+static_assert(LOG_POOL_EXHAUSTED_POLICY == LOG_POOL_EXHAUSTED_HEAP || LOG_POOL_EXHAUSTED_POLICY == LOG_POOL_EXHAUSTED_FAIL,
+              "LOG_POOL_EXHAUSTED_POLICY must be either LOG_POOL_EXHAUSTED_HEAP or LOG_POOL_EXHAUSTED_FAIL");
+#endif
 
 #if LOG_FILE_ENABLE
 static_assert(LOG_FILE_LEVEL >= LOG_LEVEL_DISABLE && LOG_FILE_LEVEL <= LOG_LEVEL_TRACE,
@@ -162,6 +501,68 @@ static_assert(LOG_FILE_MAX_FILES >= 0,
               "LOG_FILE_MAX_FILES must be greater than or equal to 0");
 static_assert(LOG_FILE_NEW_ON_BOOT == 0 || LOG_FILE_NEW_ON_BOOT == 1,
               "LOG_FILE_NEW_ON_BOOT must be either 0 or 1");
+static_assert(LOG_FILE_FLUSH_ON_WRITE == 0 || LOG_FILE_FLUSH_ON_WRITE == 1,
+              "LOG_FILE_FLUSH_ON_WRITE must be either 0 or 1");
+static_assert(LOG_FILE_FLUSH_LEVEL >= LOG_LEVEL_DISABLE && LOG_FILE_FLUSH_LEVEL <= LOG_LEVEL_TRACE,
+              "LOG_FILE_FLUSH_LEVEL must be between LOG_LEVEL_DISABLE and LOG_LEVEL_TRACE");
+static_assert(LOG_FILE_ROTATION == LOG_FILE_ROTATION_RENAME || LOG_FILE_ROTATION == LOG_FILE_ROTATION_SEGMENTS,
+              "LOG_FILE_ROTATION must be either LOG_FILE_ROTATION_RENAME or LOG_FILE_ROTATION_SEGMENTS");
+static_assert(LOG_FILE_PREALLOCATE == 0 || LOG_FILE_PREALLOCATE == 1,
+              "LOG_FILE_PREALLOCATE must be either 0 or 1");
+static_assert(LOG_FILE_ALIGN_WRITES == 0 || LOG_FILE_ALIGN_WRITES == 1,
+              "LOG_FILE_ALIGN_WRITES must be either 0 or 1");
+static_assert(LOG_FILE_BACKGROUND == 0 || LOG_FILE_BACKGROUND == 1,
+              "LOG_FILE_BACKGROUND must be either 0 or 1");
+#if LOG_FILE_BACKGROUND
+static_assert(LOG_FILE_BACKGROUND_BUFFERS >= 2,
+              "LOG_FILE_BACKGROUND_BUFFERS must be at least 2");
+#endif
+#endif
+
+#if LOG_ISR_ENABLE
+static_assert(LOG_ISR_QUEUE_SIZE >= 2 && (LOG_ISR_QUEUE_SIZE & (LOG_ISR_QUEUE_SIZE - 1)) == 0,
+              "LOG_ISR_QUEUE_SIZE must be a power of 2");
+static_assert(LOG_ISR_MAX_ARGS >= 0 && LOG_ISR_MAX_ARGS <= 8,
+              "LOG_ISR_MAX_ARGS must be between 0 and 8");
+static_assert(LOG_ISR_CONTEXTS >= 1,
+              "LOG_ISR_CONTEXTS must be at least 1");
+static_assert(LOG_ISR_CLAIM_ATTEMPTS >= 1,
+              "LOG_ISR_CLAIM_ATTEMPTS must be at least 1");
+#endif
+
+static_assert(LOG_POLL_ENABLE == 0 || LOG_POLL_ENABLE == 1,
+              "LOG_POLL_ENABLE must be either 0 or 1");
+static_assert(!(LOG_POLL_ENABLE && LOG_ASYNC_ENABLE),
+              "LOG_POLL_ENABLE and LOG_ASYNC_ENABLE can't be used together");
+static_assert(!(LOG_CHUNKED_ENABLE && LOG_ASYNC_ENABLE),
+              "LOG_CHUNKED_ENABLE and LOG_ASYNC_ENABLE can't be used together, async records are bounded by LOG_ASYNC_RECORD_SIZE");
+
+#if LOG_POLL_ENABLE
+static_assert(LOG_POLL_BUFFER_SIZE >= 64,
+              "LOG_POLL_BUFFER_SIZE must be at least 64");
+#endif
+
+static_assert(LOG_SHED_ENABLE == 0 || LOG_SHED_ENABLE == 1,
+              "LOG_SHED_ENABLE must be either 0 or 1");
+
+#if LOG_SHED_ENABLE
+static_assert(LOG_SHED_WINDOW_MS > 0,
+              "LOG_SHED_WINDOW_MS must be greater than 0");
+static_assert(LOG_SHED_RESTORE_US < LOG_SHED_BUDGET_US,
+              "LOG_SHED_RESTORE_US must be less than LOG_SHED_BUDGET_US");
+static_assert(LOG_SHED_LEVEL >= LOG_LEVEL_ERROR && LOG_SHED_LEVEL < LOG_LEVEL_TRACE,
+              "LOG_SHED_LEVEL must be between LOG_LEVEL_ERROR and LOG_LEVEL_DEBUG");
+#endif
+
+#if LOG_ASYNC_ENABLE
+static_assert(LOG_ASYNC_QUEUE_SIZE >= 2 && (LOG_ASYNC_QUEUE_SIZE & (LOG_ASYNC_QUEUE_SIZE - 1)) == 0,
+              "LOG_ASYNC_QUEUE_SIZE must be a power of 2");
+static_assert(LOG_ASYNC_RECORD_SIZE > sizeof(LOG_EOL),
+              "LOG_ASYNC_RECORD_SIZE must be larger than LOG_EOL");
+static_assert(LOG_ASYNC_FULL_POLICY == LOG_ASYNC_FULL_BLOCK || LOG_ASYNC_FULL_POLICY == LOG_ASYNC_FULL_DROP,
+              "LOG_ASYNC_FULL_POLICY must be either LOG_ASYNC_FULL_BLOCK or LOG_ASYNC_FULL_DROP");
+static_assert(LOG_ASYNC_DEFERRED == 0 || LOG_ASYNC_DEFERRED == 1,
+              "LOG_ASYNC_DEFERRED must be either 0 or 1");
 #endif
 
 /**--------------------------------------------------------------------------------------
@@ -179,17 +580,21 @@ static_assert(LOG_FILE_NEW_ON_BOOT == 0 || LOG_FILE_NEW_ON_BOOT == 1,
 #if LOG_TIME != LOG_TIME_DISABLE
 #define PREAMBLE_TIME_FORMAT LOG_FORMATTER
 #define PREAMBLE_TIME(format) fmtlog::formatTime(static_cast<fmtlog::LogTime>(format)),
+#define PREAMBLE_TIME_AT(format, timestamp) fmtlog::formatTime(static_cast<fmtlog::LogTime>(format), timestamp),
 #else
 #define PREAMBLE_TIME_FORMAT
 #define PREAMBLE_TIME(format)
+#define PREAMBLE_TIME_AT(format, timestamp)
 #endif
 
 #if LOG_FILENAME != LOG_FILENAME_DISABLE
 #define PREAMBLE_FILENAME_FORMAT LOG_FORMATTER
 #define PREAMBLE_FILENAME(file, line, func, format) , fmtlog::formatFilename(file, line, func, static_cast<fmtlog::LogFilename>(format))
+#define PREAMBLE_LOCATION(loc) , fmtlog::formatFilename(loc)
 #else
 #define PREAMBLE_FILENAME_FORMAT
 #define PREAMBLE_FILENAME(file, line, func, format)
+#define PREAMBLE_LOCATION(loc)
 #endif
 
 #define PREAMBLE_LOG_LEVEL(level, format) fmtlog::logLevelText(level, static_cast<fmtlog::LogLevelTextFormat>(format))
@@ -200,6 +605,9 @@ static_assert(LOG_FILE_NEW_ON_BOOT == 0 || LOG_FILE_NEW_ON_BOOT == 1,
 
 #define DEFAULT_PREAMBLE_FORMAT (PREAMBLE_TIME_FORMAT LOG_FORMATTER PREAMBLE_FILENAME_FORMAT " ")
 #define DEFAULT_PREAMBLE_ARGS(level, filename, linenumber, function) PREAMBLE_TIME(LOG_TIME) PREAMBLE_LOG_LEVEL(level, LOG_LEVEL_TEXT_FORMAT) PREAMBLE_FILENAME(filename, linenumber, function, LOG_FILENAME)
+// Same as DEFAULT_PREAMBLE_ARGS, using the filename text of a fmtlog::SourceLocation and a captured fmtlog::LogTimestamp
+#define DEFAULT_PREAMBLE_LOCATION_ARGS(level, loc, timestamp) PREAMBLE_TIME_AT(LOG_TIME, timestamp) PREAMBLE_LOG_LEVEL(level, LOG_LEVEL_TEXT_FORMAT) PREAMBLE_LOCATION(loc)
 
 #define DEFAULT_FILE_PREAMBLE_FORMAT (PREAMBLE_TIME_FORMAT LOG_FORMATTER " ")
 #define DEFAULT_FILE_PREAMBLE_ARGS(level, filename, linenumber, function) PREAMBLE_TIME(LOG_TIME) PREAMBLE_LOG_LEVEL(level, LOG_LEVEL_TEXT_FORMAT)
+#define DEFAULT_FILE_PREAMBLE_LOCATION_ARGS(level, loc, timestamp) PREAMBLE_TIME_AT(LOG_TIME, timestamp) PREAMBLE_LOG_LEVEL(level, LOG_LEVEL_TEXT_FORMAT)
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "Config/Settings.h"
+
+/**--------------------------------------------------------------------------------------
+ * Module Tags
+ *
+ * Tags are listed once, in the config header shared by every translation unit:
+ *
+ *   #define LOG_TAG_LIST(TAG) TAG(wifi) TAG(sensor) TAG(storage)
+ *
+ * and selected per translation unit, before including the config header:
+ *
+ *   #define LOG_TAG wifi
+ *
+ * Tags can also be compiled down to a lower level than LOG_LEVEL, in the same config header:
+ *
+ *   #define LOG_TAG_LEVEL_LIST(TAG_LEVEL) TAG_LEVEL(wifi, LOG_LEVEL_WARN)
+ *
+ * Each tag becomes a fmtlog::LogTag value, so a call site finds its runtime level
+ * with a single indexed load. Untagged translation units use LogTag::UNTAGGED.
+ *-------------------------------------------------------------------------------------*/
+
+#define _LOG_TAG_ENUM(name) name,
+#define _LOG_TAG_NAME(name) #name,
+#define _LOG_TAG_ONE(name) +1
+
+/**
+ * Number of tags including UNTAGGED
+ */
+#define LOG_TAG_COUNT (1 LOG_TAG_LIST(_LOG_TAG_ONE))
+
+static_assert(LOG_TAG_COUNT <= 255, "LOG_TAG_LIST must declare less than 255 tags");
+
+namespace fmtlog
+{
+
+    enum class LogTag : uint8_t
+    {
+        UNTAGGED,
+        LOG_TAG_LIST(_LOG_TAG_ENUM)
+    };
+
+    /**
+     * Most verbose level compiled in for a tag, lowered with LOG_TAG_LEVEL_LIST. More verbose calls
+     * in that tag compile to nothing: their format strings, arguments and FormatLog::log()
+     * instantiations never reach the image.
+     */
+    template <LogTag Tag>
+    struct LogTagLimit
+    {
+        static const int value = LOG_LEVEL_TRACE;
+    };
+
+#define _LOG_TAG_LIMIT(name, level)                                                                        \
+    template <>                                                                                            \
+    struct LogTagLimit<LogTag::name>                                                                       \
+    {                                                                                                      \
+        static_assert((level) >= LOG_LEVEL_DISABLE && (level) <= LOG_LEVEL_TRACE, "Invalid tag level"); \
+        static const int value = (level);                                                                  \
+    };
+
+    LOG_TAG_LEVEL_LIST(_LOG_TAG_LIMIT)
+
+    /**
+     * @return Tag name as written in LOG_TAG_LIST, or "" for UNTAGGED
+     */
+    inline const char *logTagName(LogTag tag)
+    {
+        static const char *const names[] = {"", LOG_TAG_LIST(_LOG_TAG_NAME)};
+        size_t index = static_cast<size_t>(tag);
+        return index < LOG_TAG_COUNT ? names[index] : "";
+    }
+
+    /**
+     * Looks a tag up by name, for runtime configuration (console commands, config files).
+     *
+     * @return false if no tag has that name
+     */
+    inline bool findLogTag(const char *name, size_t length, LogTag &tag)
+    {
+        for (size_t i = 1; i < LOG_TAG_COUNT; ++i)
+        {
+            const char *candidate = logTagName(static_cast<LogTag>(i));
+            if (strlen(candidate) == length && strncmp(candidate, name, length) == 0)
+            {
+                tag = static_cast<LogTag>(i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    inline bool findLogTag(const char *name, LogTag &tag)
+    {
+        return findLogTag(name, strlen(name), tag);
+    }
+
+} // namespace fmtlog
+
@@ -21,6 +21,33 @@
 #undef LOG_ERROR
 #define LOG_ERROR(format, ...) ((void)0)
 
+#undef LOG_EVERY_N
+#define LOG_EVERY_N(level, n, format, ...) ((void)0)
+
+#undef LOG_EVERY_MS
+#define LOG_EVERY_MS(level, intervalMs, format, ...) ((void)0)
+
+#undef LOG_ONCE
+#define LOG_ONCE(level, format, ...) ((void)0)
+
+#undef LOG_RATE_LIMIT
+#define LOG_RATE_LIMIT(level, capacity, refillMs, format, ...) ((void)0)
+
+#undef LOG_ISR_TRACE
+#define LOG_ISR_TRACE(format, ...) ((void)0)
+
+#undef LOG_ISR_DEBUG
+#define LOG_ISR_DEBUG(format, ...) ((void)0)
+
+#undef LOG_ISR_INFO
+#define LOG_ISR_INFO(format, ...) ((void)0)
+
+#undef LOG_ISR_WARN
+#define LOG_ISR_WARN(format, ...) ((void)0)
+
+#undef LOG_ISR_ERROR
+#define LOG_ISR_ERROR(format, ...) ((void)0)
+
 #undef LOG_PRINT
 #define LOG_PRINT(format, ...) ((void)0)
 
@@ -7,6 +7,10 @@
 #include "FileStorage/Sinks/RotatingFileSink.h"
 #include "FileStorage/Sinks/SimpleFileSink.h"
 
+#if LOG_FILE_BACKGROUND
+#include "FileStorage/Sinks/BackgroundFileSink.h"
+#endif
+
 namespace fmtlog
 {
 
@@ -15,6 +19,8 @@ namespace fmtlog
  *
  * Rotation: Set maxFiles = 0 for single file (no backups, default = 3)
  * Buffer size: Specify BufferSize template parameter or use LOG_FILE_MAX_BUFFER_SIZE default, if set to 0 no buffering is used
+ * Background: With LOG_FILE_BACKGROUND, a BackgroundFileSink with LOG_FILE_BACKGROUND_BUFFERS buffers of BufferSize
+ * writes, flushes and rotates on its own task (BufferSize must not be 0)
  *
  * @tparam TFileSystem Filesystem type (SPIFFS, LittleFS, SD, SdFat)
  * @tparam BufferSize Size of the internal memory buffer (default = LOG_FILE_MAX_BUFFER_SIZE)
@@ -23,6 +29,7 @@ namespace fmtlog
  * @param maxFiles Maximum number of rotated files to keep (eg. "3" keeps .1, .2, .3, main file)
  * @param maxFileSize Maximum size of each log file before rotation
  * @param rotateOnInit Whether to rotate the existing log file on initialization
+ * @param rotation FileRotation::RENAME (log.1.txt, log.2.txt ...) or FileRotation::SEGMENTS (log.000001.txt ..., constant-time rotation)
  * @return Shared pointer to IFileSink
  */
 template <typename TFileSystem, size_t BufferSize = LOG_FILE_MAX_BUFFER_SIZE>
@@ -30,16 +37,22 @@ std::shared_ptr<IFileSink> createRotatingFileStorage(TFileSystem &fs,
                                                      const char *filePath = LOG_FILE_PATH,
                                                      size_t maxFiles = LOG_FILE_MAX_FILES,
                                                      size_t maxFileSize = LOG_FILE_MAX_SIZE,
-                                                     bool rotateOnInit = LOG_FILE_NEW_ON_BOOT)
+                                                     bool rotateOnInit = LOG_FILE_NEW_ON_BOOT,
+                                                     FileRotation rotation = static_cast<FileRotation>(LOG_FILE_ROTATION))
 {
     auto fileManager = createFileManager(fs);
-    return std::make_shared<RotatingFileSink<BufferSize>>(fileManager, filePath, maxFiles, maxFileSize, rotateOnInit);
+#if LOG_FILE_BACKGROUND
+    return std::make_shared<BackgroundFileSink<BufferSize>>(fileManager, filePath, maxFiles, maxFileSize, rotateOnInit, rotation);
+#else
+    return std::make_shared<RotatingFileSink<BufferSize>>(fileManager, filePath, maxFiles, maxFileSize, rotateOnInit, rotation);
+#endif
 }
 
 /**
  * Factory function to create a simple file storage sink with no buffering or rotation.
  *
- * Writes are flushed directly to the filesystem on each call.
+ * Each message is written to the filesystem as it comes, and flushed as the sink's FlushPolicy says
+ * (after every message by default).
  *
  * @tparam TFileSystem Filesystem type (SPIFFS, LittleFS, SD, SdFat)
  * @param fs Reference to the file system
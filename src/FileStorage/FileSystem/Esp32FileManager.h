@@ -1,6 +1,7 @@
 #pragma once
 
 #include "IFileManager.h"
+#include "FileSystemTraits.h"
 #include <string>
 
 namespace fmtlog
@@ -15,9 +16,11 @@ private:
     TFileSystem &_fs;
     TFile _file;
     std::string _filePath;
+    size_t _sectorSize;
 
 public:
-    Esp32FileManager(TFileSystem &fs) : _fs(fs) {}
+    Esp32FileManager(TFileSystem &fs, size_t sectorSize = FileSystemSectorSize<TFileSystem>::value)
+        : _fs(fs), _sectorSize(sectorSize) {}
 
     bool open(const char *filePath) override
     {
@@ -87,6 +90,42 @@ public:
     {
         return _fs.rename(oldPath, newPath);
     }
+
+    size_t readFile(const char *filePath, char *data, size_t size) override
+    {
+        if (!_fs.exists(filePath))
+        {
+            return 0;
+        }
+
+        TFile file = _fs.open(filePath, "r");
+        if (!file)
+        {
+            return 0;
+        }
+
+        size_t read = file.read(reinterpret_cast<uint8_t *>(data), size);
+        file.close();
+        return read;
+    }
+
+    bool replaceFile(const char *filePath, const char *data, size_t size) override
+    {
+        TFile file = _fs.open(filePath, "w");
+        if (!file)
+        {
+            return false;
+        }
+
+        size_t written = file.write(reinterpret_cast<const uint8_t *>(data), size);
+        file.close();
+        return written == size;
+    }
+
+    size_t sectorSize() const override
+    {
+        return _sectorSize;
+    }
 };
 
 } // namespace fmtlog
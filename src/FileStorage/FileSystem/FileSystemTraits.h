@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stddef.h>
 #include <type_traits>
 
 namespace fmtlog
@@ -14,6 +15,7 @@ namespace fmtlog
  *   2. Create a composite Is*FileSystem trait that combines the checks
  *   3. Add a FileManager implementation
  *   4. Add a createFileManager overload in FileManagerFactory.h
+ *   5. Give the family a FileSystemSectorSize if aligned writes should be batched to its sectors
  *
  * Known filesystem families:
  *   ESP32  (SD, SPIFFS, LittleFS)  –  string open modes, File::size()
@@ -74,6 +76,38 @@ struct HasRename<TFS, decltype(void(std::declval<TFS>().rename("", "")))> : std:
 {
 };
 
+// ---------------------------------------------------------------------------
+// File API detectors
+// ---------------------------------------------------------------------------
+
+// File::preAllocate(uint64_t) — SdFat contiguous allocation of an empty file
+template <typename TFile, typename = void>
+struct HasPreAllocate : std::false_type
+{
+};
+template <typename TFile>
+struct HasPreAllocate<TFile, decltype(void(std::declval<TFile>().preAllocate(0)))> : std::true_type
+{
+};
+
+// File::truncate(uint64_t)
+template <typename TFile, typename = void>
+struct HasTruncate : std::false_type
+{
+};
+template <typename TFile>
+struct HasTruncate<TFile, decltype(void(std::declval<TFile>().truncate(0)))> : std::true_type
+{
+};
+
+// Files that can be preallocated and cut back to their written size
+template <typename TFile>
+struct SupportsPreallocation : std::integral_constant<bool,
+                                                      HasPreAllocate<TFile>::value &&
+                                                          HasTruncate<TFile>::value>
+{
+};
+
 // ---------------------------------------------------------------------------
 // Composite filesystem traits
 // ---------------------------------------------------------------------------
@@ -107,4 +141,29 @@ struct IsSupportedFileSystem : std::integral_constant<bool,
 {
 };
 
+// ---------------------------------------------------------------------------
+// Write unit per filesystem family, used by LOG_FILE_ALIGN_WRITES.
+// Specialize it for a filesystem type to override the family default,
+// e.g. 4096 for LittleFS on a flash with 4 KB pages. 0 = no alignment.
+// ---------------------------------------------------------------------------
+
+template <typename TFS, typename = void>
+struct FileSystemSectorSize : std::integral_constant<size_t, 0>
+{
+};
+
+// SD cards: 512-byte sectors
+template <typename TFS>
+struct FileSystemSectorSize<TFS, typename std::enable_if<IsSdFatFileSystem<TFS>::value>::type>
+    : std::integral_constant<size_t, 512>
+{
+};
+
+// SD and FFat sectors; SPIFFS and LittleFS pages are a multiple or a divisor of it
+template <typename TFS>
+struct FileSystemSectorSize<TFS, typename std::enable_if<IsEsp32FileSystem<TFS>::value>::type>
+    : std::integral_constant<size_t, 512>
+{
+};
+
 } // namespace fmtlog
@@ -20,6 +20,45 @@ public:
     virtual bool exists(const char *filePath) = 0;
     virtual bool remove(const char *filePath) = 0;
     virtual bool rename(const char *oldPath, const char *newPath) = 0;
+
+    /**
+     * Reads up to size bytes from the start of another file, leaving the open file alone.
+     *
+     * @return Bytes read, 0 if the file doesn't exist or the file manager can't read files
+     */
+    virtual size_t readFile(const char *, char *, size_t)
+    {
+        return 0;
+    }
+
+    /**
+     * Replaces the content of another file, creating it if needed, leaving the open file alone.
+     *
+     * @return false if the file couldn't be written or the file manager can't replace files
+     */
+    virtual bool replaceFile(const char *, const char *, size_t)
+    {
+        return false;
+    }
+
+    /**
+     * Reserves size bytes for the open file while it is still empty, so writes up to that size don't
+     * allocate. size() keeps returning the bytes written, and the file is cut back to them on close.
+     *
+     * @return false if the file isn't empty or the file manager can't preallocate, writes then grow the file as usual
+     */
+    virtual bool preallocate(size_t)
+    {
+        return false;
+    }
+
+    /**
+     * @return Write unit of the device (sector or flash page) that aligned writes are batched to, 0 if unknown
+     */
+    virtual size_t sectorSize() const
+    {
+        return 0;
+    }
 };
 
 } // namespace fmtlog
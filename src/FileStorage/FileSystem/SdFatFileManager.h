@@ -1,11 +1,20 @@
 #pragma once
 
 #include "IFileManager.h"
+#include "FileSystemTraits.h"
 #include <string>
 
 namespace fmtlog
 {
 
+/**
+ * IFileManager for SdFat, SdFat32 and SdExFat.
+ *
+ * preallocate() reserves contiguous clusters for a new file (File::preAllocate()), so appends write
+ * straight to sectors without touching the FAT. The file is then written in place from the start,
+ * the end of the data is tracked here and the file is truncated to it on close. A file that was not
+ * closed (power loss) keeps its preallocated size, with unwritten space after the last line.
+ */
 template <typename TFileSystem>
 class SdFatFileManager : public IFileManager
 {
@@ -15,12 +24,62 @@ private:
     TFileSystem &_fs;
     TFile _file;
     std::string _filePath;
+    size_t _sectorSize;
+    bool _preallocated = false;
+    size_t _dataSize = 0; // Bytes written to a preallocated file
+
 
     // O_WRONLY | O_CREAT | O_APPEND (SdFat flags)
     static const int APPEND_FLAGS = 1 | 0x0200 | 0x0008;
+    // O_RDONLY
+    static const int READ_FLAGS = 0;
+    // O_WRONLY | O_CREAT | O_TRUNC
+    static const int REPLACE_FLAGS = 1 | 0x0200 | 0x0400;
+    // O_WRONLY | O_CREAT, written in place from the start
+    static const int WRITE_FLAGS = 1 | 0x0200;
+
+    bool preallocateFile(size_t size, std::true_type)
+    {
+        if (!_file || _file.size() != 0 || size == 0)
+        {
+            return false;
+        }
+
+        // O_APPEND would move every write to the preallocated end
+        _file.close();
+        _file = _fs.open(_filePath.c_str(), WRITE_FLAGS);
+        if (_file && _file.preAllocate(size))
+        {
+            _preallocated = true;
+            _dataSize = 0;
+            return true;
+        }
+
+        if (_file)
+        {
+            _file.close();
+        }
+        _file = _fs.open(_filePath.c_str(), APPEND_FLAGS);
+        return false;
+    }
+
+    bool preallocateFile(size_t, std::false_type)
+    {
+        return false;
+    }
+
+    void truncateFile(std::true_type)
+    {
+        _file.truncate(_dataSize);
+    }
+
+    void truncateFile(std::false_type)
+    {
+    }
 
 public:
-    SdFatFileManager(TFileSystem &fs) : _fs(fs) {}
+    SdFatFileManager(TFileSystem &fs, size_t sectorSize = FileSystemSectorSize<TFileSystem>::value)
+        : _fs(fs), _sectorSize(sectorSize) {}
 
     bool open(const char *filePath) override
     {
@@ -43,7 +102,12 @@ public:
             return 0;
         }
 
-        return _file.write(reinterpret_cast<const uint8_t *>(data), size);
+        size_t written = _file.write(reinterpret_cast<const uint8_t *>(data), size);
+        if (_preallocated)
+        {
+            _dataSize += written;
+        }
+        return written;
     }
 
     void flush() override
@@ -58,8 +122,13 @@ public:
     {
         if (_file)
         {
+            if (_preallocated)
+            {
+                truncateFile(SupportsPreallocation<TFile>());
+            }
             _file.close();
         }
+        _preallocated = false;
     }
 
     size_t size() override
@@ -68,7 +137,7 @@ public:
         {
             return 0;
         }
-        return _file.size();
+        return _preallocated ? _dataSize : _file.size();
     }
 
     const char *filePath() override
@@ -90,6 +159,47 @@ public:
     {
         return _fs.rename(oldPath, newPath);
     }
+
+    size_t readFile(const char *filePath, char *data, size_t size) override
+    {
+        if (!_fs.exists(filePath))
+        {
+            return 0;
+        }
+
+        TFile file = _fs.open(filePath, READ_FLAGS);
+        if (!file)
+        {
+            return 0;
+        }
+
+        int read = file.read(data, size);
+        file.close();
+        return read > 0 ? static_cast<size_t>(read) : 0;
+    }
+
+    bool replaceFile(const char *filePath, const char *data, size_t size) override
+    {
+        TFile file = _fs.open(filePath, REPLACE_FLAGS);
+        if (!file)
+        {
+            return false;
+        }
+
+        size_t written = file.write(reinterpret_cast<const uint8_t *>(data), size);
+        file.close();
+        return written == size;
+    }
+
+    bool preallocate(size_t size) override
+    {
+        return preallocateFile(size, SupportsPreallocation<TFile>());
+    }
+
+    size_t sectorSize() const override
+    {
+        return _sectorSize;
+    }
 };
 
 } // namespace fmtlog
@@ -0,0 +1,299 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <memory>
+#include <string.h>
+#include "Config/Settings.h"
+#include "Async/AsyncTask.h"
+#include "FileStorage/Sinks/IFileSink.h"
+#include "FileStorage/Sinks/RotatingFileSink.h"
+
+namespace fmtlog
+{
+
+/**
+ * Rotating file sink that writes, flushes and rotates on a background task.
+ *
+ * Callers append lines to one of BufferCount buffers. When it is full (or the FlushPolicy asks for a
+ * flush) the buffer is handed to the task and the caller carries on with the next one, so a slow
+ * SD card write or a rotation never runs on the logging thread. A caller only waits when every
+ * other buffer is still being written; those waits are counted by getBlockedCount().
+ *
+ * Lines longer than BufferSize are written by the caller, after the buffers handed over before them.
+ * flush(), close() and setFilePath() wait for the task to write everything out.
+ */
+template <size_t BufferSize = LOG_FILE_MAX_BUFFER_SIZE, size_t BufferCount = LOG_FILE_BACKGROUND_BUFFERS>
+class BackgroundFileSink : public IFileSink
+{
+    static_assert(BufferSize > 0, "BackgroundFileSink needs a buffer");
+    static_assert(BufferCount >= 2, "BackgroundFileSink needs at least 2 buffers");
+
+private:
+    struct Slot
+    {
+        char data[BufferSize];
+        size_t size;
+        bool flush; // Flush the file once this buffer is written
+    };
+
+    Slot _slots[BufferCount];
+    RotatingFileSink<0> _writer; // Only used by the task, or by the caller once the task is idle
+    FlushTracker _flushTracker;
+    AsyncTask _task;
+    AsyncSignal _written; // Notified each time the task has written a buffer
+    std::atomic<size_t> _submitted{0}; // Buffers handed to the task, the one being filled is _submitted % BufferCount
+    std::atomic<size_t> _completed{0}; // Buffers the task has written
+    std::atomic<bool> _started{false};
+    std::atomic<bool> _stopping{false};
+    std::atomic<uint32_t> _flushCount{0};
+    std::atomic<uint32_t> _blockedCount{0};
+    std::atomic<uint32_t> _blockedMicros{0};
+
+    static void taskMain(void *arg)
+    {
+        BackgroundFileSink *self = static_cast<BackgroundFileSink *>(arg);
+        while (!self->_stopping.load(std::memory_order_acquire))
+        {
+            if (!self->writeSubmitted())
+                self->_task.wait();
+        }
+        self->writeSubmitted();
+        self->_task.finish();
+    }
+
+    bool ensureStarted()
+    {
+        if (_started.load(std::memory_order_acquire))
+            return true;
+
+        if (!_task.start(taskMain, this, "fmtlog-file", LOG_FILE_TASK_STACK_SIZE, LOG_FILE_TASK_PRIORITY, LOG_FILE_TASK_CORE))
+            return false;
+        _started.store(true, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Writes every buffer handed over so far. Runs on the task, or on the caller if the task
+     * could not be started.
+     *
+     * @return true if there was anything to write
+     */
+    bool writeSubmitted()
+    {
+        size_t completed = _completed.load(std::memory_order_relaxed);
+        size_t submitted = _submitted.load(std::memory_order_acquire);
+        if (completed == submitted)
+            return false;
+
+        while (completed != submitted)
+        {
+            Slot &slot = _slots[completed % BufferCount];
+            if (slot.size > 0)
+                _writer.write(slot.data, slot.size);
+            if (slot.flush)
+                _writer.flush();
+            _flushCount.store(_writer.getFlushCount(), std::memory_order_relaxed);
+            _completed.store(++completed, std::memory_order_release);
+            _written.notify();
+        }
+        return true;
+    }
+
+    Slot &currentSlot()
+    {
+        return _slots[_submitted.load(std::memory_order_relaxed) % BufferCount];
+    }
+
+    // Hands the current buffer to the task and waits for the next one to be free
+    void submit(bool flush)
+    {
+        currentSlot().flush = flush;
+        size_t submitted = _submitted.load(std::memory_order_relaxed) + 1;
+        _submitted.store(submitted, std::memory_order_release);
+        if (flush)
+            _flushTracker.flushed();
+
+        if (ensureStarted())
+            _task.notify();
+        else
+            writeSubmitted();
+
+        if (submitted - _completed.load(std::memory_order_acquire) >= BufferCount)
+        {
+            uint32_t start = micros();
+            _written.waitUntil([this, submitted]
+                               { return submitted - _completed.load(std::memory_order_acquire) < BufferCount; });
+            _blockedCount.fetch_add(1, std::memory_order_relaxed);
+            _blockedMicros.fetch_add(micros() - start, std::memory_order_relaxed);
+        }
+
+        Slot &slot = currentSlot();
+        slot.size = 0;
+        slot.flush = false;
+    }
+
+    // Waits until the task has written every buffer handed over, after which the caller may use _writer
+    void waitIdle()
+    {
+        _written.waitUntil([this]
+                           { return _completed.load(std::memory_order_acquire) == _submitted.load(std::memory_order_relaxed); });
+    }
+
+    void stop()
+    {
+        if (!_started.load(std::memory_order_acquire))
+            return;
+
+        _stopping = true;
+        _task.notify();
+        _task.join();
+        _stopping = false;
+        _started = false;
+    }
+
+    void applyFlushPolicy(const FlushPolicy &policy)
+    {
+        _flushTracker.setPolicy(policy);
+
+        // The writer flushes every buffer if asked to, the rest is decided when lines are logged
+        _writer.setFlushPolicy(policy.onWrite ? FlushPolicy::everyWrite() : FlushPolicy::explicitOnly());
+    }
+
+public:
+    BackgroundFileSink(std::shared_ptr<IFileManager> fileManager,
+                       const char *path = LOG_FILE_PATH,
+                       size_t maxFiles = LOG_FILE_MAX_FILES,
+                       size_t maxFileSize = LOG_FILE_MAX_SIZE,
+                       bool rotateOnInit = LOG_FILE_NEW_ON_BOOT,
+                       FileRotation rotation = static_cast<FileRotation>(LOG_FILE_ROTATION))
+        : _writer(fileManager, path, maxFiles, maxFileSize, rotateOnInit, rotation)
+    {
+        _slots[0].size = 0;
+        _slots[0].flush = false;
+        applyFlushPolicy(_flushTracker.policy());
+    }
+
+    ~BackgroundFileSink() override
+    {
+        close();
+        stop();
+    }
+
+    void close() override
+    {
+        flush();
+        _writer.close();
+    }
+
+    void flush() override
+    {
+        if (!_started.load(std::memory_order_acquire) && currentSlot().size == 0)
+        {
+            // Nothing handed over yet, no need to start the task
+            _writer.flush();
+            _flushCount.store(_writer.getFlushCount(), std::memory_order_relaxed);
+            return;
+        }
+
+        submit(true);
+        waitIdle();
+    }
+
+    bool write(const char *data, size_t size) override
+    {
+        return writeLine(data, size, LogLevel::DISABLE);
+    }
+
+    bool writeLine(const char *data, size_t size, LogLevel level) override
+    {
+        if (!data || size == 0)
+            return false;
+
+        bool flushDue = _flushTracker.logged(size, level);
+
+        if (size > BufferSize)
+        {
+            if (currentSlot().size > 0)
+                submit(false);
+            waitIdle();
+
+            bool written = _writer.write(data, size);
+            if (flushDue)
+            {
+                _writer.flush();
+                _flushTracker.flushed();
+            }
+            _flushCount.store(_writer.getFlushCount(), std::memory_order_relaxed);
+            return written;
+        }
+
+        if (currentSlot().size + size > BufferSize)
+            submit(false);
+
+        Slot &slot = currentSlot();
+        memcpy(slot.data + slot.size, data, size);
+        slot.size += size;
+
+        if (flushDue)
+            submit(true);
+        return true;
+    }
+
+    void setFlushPolicy(const FlushPolicy &policy) override
+    {
+        waitIdle();
+        applyFlushPolicy(policy);
+    }
+
+    uint32_t getFlushCount() const override
+    {
+        return _flushCount.load(std::memory_order_relaxed);
+    }
+
+    uint32_t getBlockedCount() const override
+    {
+        return _blockedCount.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @return Total time callers waited for a free buffer, in microseconds
+     */
+    uint32_t getBlockedMicros() const
+    {
+        return _blockedMicros.load(std::memory_order_relaxed);
+    }
+
+    void setFilePath(const char *path) override
+    {
+        flush();
+        _writer.setFilePath(path);
+    }
+
+    std::string getFilePath() const override
+    {
+        return _writer.getFilePath();
+    }
+
+    /**
+     * @see RotatingFileSink::setPreallocate()
+     */
+    void setPreallocate(bool preallocate)
+    {
+        waitIdle();
+        _writer.setPreallocate(preallocate);
+    }
+
+    /**
+     * Waits for the buffers handed over so far to be written, so the path is up to date.
+     *
+     * @return Path of the file being written: the configured path, or the newest segment with FileRotation::SEGMENTS
+     */
+    std::string getActivePath()
+    {
+        waitIdle();
+        return _writer.getActivePath();
+    }
+};
+
+} // namespace fmtlog
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <Arduino.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "Config/Settings.h"
+
+namespace fmtlog
+{
+
+/**
+ * Decides when a file sink flushes what it wrote. A flush makes data durable but forces the
+ * filesystem to update its metadata (FAT, directory entry, LittleFS metadata pairs), which costs
+ * more than the write itself. Conditions combine: the sink flushes as soon as any of them is met.
+ * Explicit flushes (LOG_FLUSH_FILE(), close, rotation) always flush.
+ *
+ * The defaults come from LOG_FILE_FLUSH_ON_WRITE, LOG_FILE_FLUSH_BYTES, LOG_FILE_FLUSH_INTERVAL_MS
+ * and LOG_FILE_FLUSH_LEVEL.
+ */
+struct FlushPolicy
+{
+    bool onWrite = LOG_FILE_FLUSH_ON_WRITE;                       // Flush every time the sink writes to the file
+    size_t bytes = LOG_FILE_FLUSH_BYTES;                          // Flush once this many bytes were logged since the last flush, 0 = off
+    uint32_t intervalMs = LOG_FILE_FLUSH_INTERVAL_MS;             // Flush on the first line this long after the last flush, 0 = off
+    LogLevel level = static_cast<LogLevel>(LOG_FILE_FLUSH_LEVEL); // Flush right after lines at this level or more severe, DISABLE = off
+
+    /**
+     * Flushes only on LOG_FLUSH_FILE(), close and rotation.
+     */
+    static FlushPolicy explicitOnly()
+    {
+        FlushPolicy policy;
+        policy.onWrite = false;
+        policy.bytes = 0;
+        policy.intervalMs = 0;
+        policy.level = LogLevel::DISABLE;
+        return policy;
+    }
+
+    static FlushPolicy everyWrite()
+    {
+        FlushPolicy policy = explicitOnly();
+        policy.onWrite = true;
+        return policy;
+    }
+
+    static FlushPolicy everyBytes(size_t bytes)
+    {
+        FlushPolicy policy = explicitOnly();
+        policy.bytes = bytes;
+        return policy;
+    }
+
+    static FlushPolicy everyMs(uint32_t intervalMs)
+    {
+        FlushPolicy policy = explicitOnly();
+        policy.intervalMs = intervalMs;
+        return policy;
+    }
+
+    static FlushPolicy atLevel(LogLevel level)
+    {
+        FlushPolicy policy = explicitOnly();
+        policy.level = level;
+        return policy;
+    }
+};
+
+/**
+ * Applies a FlushPolicy for a sink: counts what was logged since the last flush and tells when the
+ * next one is due.
+ */
+class FlushTracker
+{
+private:
+    FlushPolicy _policy;
+    size_t _pending = 0;
+    uint32_t _lastFlushMs = 0;
+    uint32_t _flushCount = 0;
+
+public:
+    const FlushPolicy &policy() const
+    {
+        return _policy;
+    }
+
+    void setPolicy(const FlushPolicy &policy)
+    {
+        _policy = policy;
+    }
+
+    /**
+     * Counts a logged line, level DISABLE if it has none (raw prints).
+     *
+     * @return true if the policy wants a flush now
+     */
+    bool logged(size_t size, LogLevel level)
+    {
+        _pending += size;
+        if (_policy.bytes > 0 && _pending >= _policy.bytes)
+            return true;
+        if (_policy.intervalMs > 0 && millis() - _lastFlushMs >= _policy.intervalMs)
+            return true;
+        return level != LogLevel::DISABLE && _policy.level != LogLevel::DISABLE &&
+               static_cast<int>(level) <= static_cast<int>(_policy.level);
+    }
+
+    /**
+     * @return true if something was logged since the last flush
+     */
+    bool pending() const
+    {
+        return _pending > 0;
+    }
+
+    void flushed()
+    {
+        _pending = 0;
+        _lastFlushMs = millis();
+        ++_flushCount;
+    }
+
+    uint32_t flushCount() const
+    {
+        return _flushCount;
+    }
+};
+
+} // namespace fmtlog
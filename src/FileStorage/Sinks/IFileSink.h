@@ -2,6 +2,7 @@
 
 #include <string>
 #include <stddef.h>
+#include "FileStorage/Sinks/FlushPolicy.h"
 
 namespace fmtlog
 {
@@ -16,6 +17,35 @@ public:
     virtual void close() = 0;
     virtual void setFilePath(const char *path) = 0;
     virtual std::string getFilePath() const = 0;
+
+    /**
+     * Writes a log line. Sinks with a FlushPolicy use the level to decide when to flush.
+     */
+    virtual bool writeLine(const char *data, size_t size, LogLevel level)
+    {
+        (void)level;
+        return write(data, size);
+    }
+
+    virtual void setFlushPolicy(const FlushPolicy &)
+    {
+    }
+
+    /**
+     * @return Number of times the sink flushed the file, 0 if it doesn't count them
+     */
+    virtual uint32_t getFlushCount() const
+    {
+        return 0;
+    }
+
+    /**
+     * @return Number of times a caller had to wait for the sink to write out a buffer, 0 if it never does
+     */
+    virtual uint32_t getBlockedCount() const
+    {
+        return 0;
+    }
 };
 
 } // namespace fmtlog
@@ -2,6 +2,8 @@
 
 #include <string>
 #include <memory>
+#include <stdlib.h>
+#include <string.h>
 #include <fmt.h>
 #include "Config/Settings.h"
 #include "FileStorage/Sinks/IFileSink.h"
@@ -10,6 +12,25 @@
 namespace fmtlog
 {
 
+/**
+ * Buffered file sink that starts a new file once the current one reaches maxFileSize, keeping
+ * maxFiles older ones.
+ *
+ * FileRotation::RENAME keeps the current file at the configured path and renames each older one
+ * (log.1.txt, log.2.txt ...) on every rotation, so a rotation costs up to maxFiles renames.
+ * FileRotation::SEGMENTS names every file once with a sequence number (log.000041.txt,
+ * log.000042.txt ...) and rotating only removes the oldest, whatever maxFiles. The first and last
+ * sequence numbers are kept in a small state file (log.seq) so numbering continues after a reboot.
+ * It is written to log.seq.tmp first and renamed over log.seq, so a power loss leaves one of them whole.
+ *
+ * With preallocation (LOG_FILE_PREALLOCATE or setPreallocate()), each new file is given maxFileSize
+ * up front if the file manager supports it (SdFat), and cut back to its content on close.
+ *
+ * With aligned writes (LOG_FILE_ALIGN_WRITES or setAlignWrites()), a full buffer is written up to
+ * the last sector boundary of the file (IFileManager::sectorSize()) and the rest is carried over,
+ * so the device never has to read back and rewrite a partly written sector. Only flushes, close
+ * and rotation write a partial sector. Needs BufferSize >= the sector size.
+ */
 template <size_t BufferSize = LOG_FILE_MAX_BUFFER_SIZE>
 class RotatingFileSink : public IFileSink
 {
@@ -24,6 +45,13 @@ private:
     size_t _currentSize;
     bool _rotateOnInit;
     bool _initialized;
+    FileRotation _rotation;
+    std::string _activePath;
+    uint32_t _headSegment; // Sequence number of the file being written (FileRotation::SEGMENTS)
+    uint32_t _tailSegment; // Sequence number of the oldest file kept
+    bool _preallocate;
+    size_t _sectorSize; // Aligned write unit, 0 = write the whole buffer
+    FlushTracker _flushTracker;
 
     void parseFilePath()
     {
@@ -42,11 +70,93 @@ private:
         return fmt::format("{}.{}{}", _baseName, index, _extension);
     }
 
+    std::string createSegmentPath(uint32_t sequence) const
+    {
+        return fmt::format("{}.{:06}{}", _baseName, sequence, _extension);
+    }
+
+    std::string sequencePath() const
+    {
+        return _baseName + ".seq";
+    }
+
+    // log.seq is replaced by renaming this file over it, so a power loss never leaves it half written
+    std::string sequenceTempPath() const
+    {
+        return _baseName + ".seq.tmp";
+    }
+
+    // Reads "<head> <tail>\n", false if the file is missing or was cut short
+    bool readSequence(const char *path, uint32_t &head, uint32_t &tail)
+    {
+        char text[24];
+        size_t size = _fileManager->readFile(path, text, sizeof(text) - 1);
+        text[size] = '\0';
+        if (size == 0 || text[size - 1] != '\n')
+            return false;
+
+        char *end;
+        head = strtoul(text, &end, 10);
+        if (end == text || *end != ' ')
+            return false;
+        char *start = end;
+        tail = strtoul(start, &end, 10);
+        return end != start && *end == '\n' && tail <= head;
+    }
+
+    void loadSequence()
+    {
+        // A temp file left over means log.seq wasn't replaced yet, it holds the newer numbers
+        if (readSequence(sequenceTempPath().c_str(), _headSegment, _tailSegment))
+            return;
+        if (readSequence(sequencePath().c_str(), _headSegment, _tailSegment))
+            return;
+        _headSegment = 0;
+        _tailSegment = 0;
+    }
+
+    void saveSequence()
+    {
+        fmt::basic_memory_buffer<char, 24> text;
+        fmt::format_to(fmt::appender(text), "{} {}\n", _headSegment, _tailSegment);
+
+        std::string tempPath = sequenceTempPath();
+        std::string path = sequencePath();
+        if (!_fileManager->replaceFile(tempPath.c_str(), text.data(), text.size()))
+            return;
+
+        // Some file systems (FAT, SPIFFS) don't rename over an existing file
+        if (!_fileManager->rename(tempPath.c_str(), path.c_str()))
+        {
+            _fileManager->remove(path.c_str());
+            _fileManager->rename(tempPath.c_str(), path.c_str());
+        }
+    }
+
+    // Removes the oldest segments beyond maxFiles, just one after a rotation
+    void trimSegments()
+    {
+        while (_headSegment - _tailSegment > _maxFiles)
+        {
+            _fileManager->remove(createSegmentPath(_tailSegment).c_str());
+            ++_tailSegment;
+        }
+    }
+
+    void updateActivePath()
+    {
+        _activePath = _rotation == FileRotation::SEGMENTS ? createSegmentPath(_headSegment) : _filePath;
+    }
+
     bool ensureOpen()
     {
         if (_fileManager->isOpen())
             return true;
-        return _fileManager->open(_filePath.c_str());
+        if (!_fileManager->open(_activePath.c_str()))
+            return false;
+        if (_preallocate && _fileManager->size() == 0)
+            _fileManager->preallocate(_maxFileSize);
+        return true;
     }
 
     void initFile()
@@ -54,7 +164,14 @@ private:
         if (_initialized)
             return;
 
-        if (_fileManager->exists(_filePath.c_str()))
+        if (_rotation == FileRotation::SEGMENTS)
+        {
+            loadSequence();
+            trimSegments(); // maxFiles may be lower than on the last boot
+            updateActivePath();
+        }
+
+        if (_fileManager->exists(_activePath.c_str()))
         {
             if (_rotateOnInit)
             {
@@ -81,9 +198,103 @@ private:
         }
 
         size_t written = _fileManager->write(_buffer.data(), _buffer.size());
-        _fileManager->flush();
         _currentSize += written;
         _buffer.clear();
+        if (_flushTracker.policy().onWrite)
+            flushFile();
+    }
+
+    // Writes the buffer up to the last sector boundary of the file and keeps the rest
+    void writeWholeSectors()
+    {
+        size_t offset = _currentSize % _sectorSize;
+        size_t end = (offset + _buffer.size()) / _sectorSize * _sectorSize;
+        if (end <= offset)
+            return;
+
+        if (!ensureOpen())
+        {
+            _buffer.clear();
+            return;
+        }
+
+        size_t size = end - offset;
+        _currentSize += _fileManager->write(_buffer.data(), size);
+
+        size_t rest = _buffer.size() - size;
+        memmove(_buffer.data(), _buffer.data() + size, rest);
+        _buffer.resize(rest);
+        if (_flushTracker.policy().onWrite)
+            flushFile();
+    }
+
+    void updateSectorSize(bool alignWrites)
+    {
+        size_t sectorSize = _fileManager->sectorSize();
+        _sectorSize = alignWrites && sectorSize <= BufferSize ? sectorSize : 0;
+    }
+
+    void flushFile()
+    {
+        if (!_flushTracker.pending() || !_fileManager->isOpen())
+            return;
+        _fileManager->flush();
+        _flushTracker.flushed();
+    }
+
+    bool append(const char *data, size_t size)
+    {
+        initFile();
+
+        if (_sectorSize > 0)
+            return appendAligned(data, size);
+
+        if (size > BufferSize)
+        {
+            writeBufferToFile();
+
+            if (_currentSize + size > _maxFileSize)
+                rotate();
+
+            if (!ensureOpen())
+                return false;
+
+            size_t written = _fileManager->write(data, size);
+            _currentSize += written;
+            if (_flushTracker.policy().onWrite)
+                flushFile();
+            return written == size;
+        }
+
+        if (_buffer.size() + size > BufferSize)
+            writeBufferToFile();
+
+        if (_currentSize + _buffer.size() + size > _maxFileSize)
+            rotate();
+
+        _buffer.append(data, data + size);
+        return true;
+    }
+
+    bool appendAligned(const char *data, size_t size)
+    {
+        if (_currentSize + _buffer.size() + size > _maxFileSize)
+            rotate();
+
+        // Lines may span two writes, the file only ever sees whole sectors
+        while (size > 0)
+        {
+            size_t part = BufferSize - _buffer.size();
+            if (part > size)
+                part = size;
+            _buffer.append(data, data + part);
+            data += part;
+            size -= part;
+
+            if (_buffer.size() == BufferSize)
+                writeWholeSectors();
+        }
+        return true;
     }
 
 public:
@@ -91,16 +302,23 @@ public:
                      const char *path = LOG_FILE_PATH,
                      size_t maxFiles = LOG_FILE_MAX_FILES,
                      size_t maxFileSize = LOG_FILE_MAX_SIZE,
-                     bool rotateOnInit = LOG_FILE_NEW_ON_BOOT)
+                     bool rotateOnInit = LOG_FILE_NEW_ON_BOOT,
+                     FileRotation rotation = static_cast<FileRotation>(LOG_FILE_ROTATION))
         : _fileManager(fileManager),
           _filePath(path),
           _maxFiles(maxFiles),
           _maxFileSize(maxFileSize),
           _currentSize(0),
           _rotateOnInit(rotateOnInit),
-          _initialized(false)
+          _initialized(false),
+          _rotation(rotation),
+          _headSegment(0),
+          _tailSegment(0),
+          _preallocate(LOG_FILE_PREALLOCATE)
     {
         parseFilePath();
+        updateActivePath();
+        updateSectorSize(LOG_FILE_ALIGN_WRITES);
     }
 
     ~RotatingFileSink() override
@@ -117,45 +335,50 @@ public:
     void flush() override
     {
         writeBufferToFile();
+        flushFile();
     }
 
     bool write(const char *data, size_t size) override
+    {
+        return writeLine(data, size, LogLevel::DISABLE);
+    }
+
+    bool writeLine(const char *data, size_t size, LogLevel level) override
     {
         if (!data || size == 0)
             return false;
 
-        initFile();
-
-        if (size > BufferSize)
-        {
-            flush();
-
-            if (_currentSize + size > _maxFileSize)
-                rotate();
-
-            if (!ensureOpen())
-                return false;
-
-            size_t written = _fileManager->write(data, size);
-            _fileManager->flush();
-            _currentSize += written;
-            return written == size;
-        }
-
-        if (_buffer.size() + size > BufferSize)
+        bool flushDue = _flushTracker.logged(size, level);
+        bool written = append(data, size);
+        if (flushDue)
             flush();
+        return written;
+    }
 
-        if (_currentSize + _buffer.size() + size > _maxFileSize)
-            rotate();
+    void setFlushPolicy(const FlushPolicy &policy) override
+    {
+        _flushTracker.setPolicy(policy);
+    }
 
-        _buffer.append(data, data + size);
-        return true;
+    uint32_t getFlushCount() const override
+    {
+        return _flushTracker.flushCount();
     }
 
     void rotate()
     {
         close();
 
+        if (_rotation == FileRotation::SEGMENTS)
+        {
+            ++_headSegment;
+            trimSegments();
+            saveSequence();
+            updateActivePath();
+            _currentSize = 0;
+            return;
+        }
+
         if (_maxFiles == 0)
         {
             _fileManager->remove(_filePath.c_str());
@@ -185,13 +408,40 @@ public:
         _filePath = path;
         _initialized = false;
         _currentSize = 0;
+        _headSegment = 0;
+        _tailSegment = 0;
         parseFilePath();
+        updateActivePath();
     }
 
     std::string getFilePath() const override
     {
         return _filePath;
     }
+
+    /**
+     * Preallocates maxFileSize for each file opened empty from now on. Defaults to LOG_FILE_PREALLOCATE.
+     */
+    void setPreallocate(bool preallocate)
+    {
+        _preallocate = preallocate;
+    }
+
+    /**
+     * Writes whole sectors of the file manager's sectorSize() from now on. Defaults to LOG_FILE_ALIGN_WRITES.
+     */
+    void setAlignWrites(bool alignWrites)
+    {
+        updateSectorSize(alignWrites);
+    }
+
+    /**
+     * @return Path of the file being written: the configured path, or the newest segment with FileRotation::SEGMENTS
+     */
+    std::string getActivePath() const
+    {
+        return _activePath;
+    }
 };
 
 } // namespace fmtlog
@@ -13,6 +13,7 @@ class SimpleFileSink : public IFileSink
 private:
     std::shared_ptr<IFileManager> _fileManager;
     std::string _filePath;
+    FlushTracker _flushTracker;
 
     bool ensureOpen()
     {
@@ -35,6 +36,11 @@ public:
     }
 
     bool write(const char *data, size_t size) override
+    {
+        return writeLine(data, size, LogLevel::DISABLE);
+    }
+
+    bool writeLine(const char *data, size_t size, LogLevel level) override
     {
         if (!data || size == 0)
             return false;
@@ -42,15 +48,29 @@ public:
         if (!ensureOpen())
             return false;
 
+        bool flushDue = _flushTracker.logged(size, level);
         size_t written = _fileManager->write(data, size);
-        _fileManager->flush();
+        if (flushDue || _flushTracker.policy().onWrite)
+            flush();
         return written == size;
     }
 
     void flush() override
     {
-        if (_fileManager->isOpen())
-            _fileManager->flush();
+        if (!_flushTracker.pending() || !_fileManager->isOpen())
+            return;
+        _fileManager->flush();
+        _flushTracker.flushed();
+    }
+
+    void setFlushPolicy(const FlushPolicy &policy) override
+    {
+        _flushTracker.setPolicy(policy);
+    }
+
+    uint32_t getFlushCount() const override
+    {
+        return _flushTracker.flushCount();
     }
 
     void close() override
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <Arduino.h>
+#include <stddef.h>
+#include <iterator>
+#include "fmt.h"
+
+namespace fmtlog
+{
+
+    /**
+     * Message body that hands its bytes on in chunks while it is being formatted, so a message of
+     * any length needs the same Size bytes of RAM. A message that fits is never flushed: check
+     * flushed() and write pending() as one piece instead.
+     *
+     * @tparam Size Bytes buffered before each flush
+     */
+    template <size_t Size>
+    class ChunkedMessage
+    {
+        static_assert(Size > 0, "ChunkedMessage needs a buffer of at least one byte");
+
+    public:
+        using FlushFunction = void (*)(void *context, const char *data, size_t size);
+
+        // Output iterator for fmt::vformat_to(), appending to the message one char at a time
+        class Iterator
+        {
+        private:
+            ChunkedMessage *_message;
+
+        public:
+            using iterator_category = std::output_iterator_tag;
+            using value_type = void;
+            using difference_type = ptrdiff_t;
+            using pointer = void;
+            using reference = void;
+
+            explicit Iterator(ChunkedMessage &message) : _message(&message) {}
+
+            Iterator &operator=(char c)
+            {
+                _message->put(c);
+                return *this;
+            }
+            Iterator &operator*() { return *this; }
+            Iterator &operator++() { return *this; }
+            Iterator operator++(int) { return *this; }
+        };
+
+    private:
+        char _data[Size];
+        size_t _size = 0;
+        bool _flushed = false;
+        FlushFunction _flush;
+        void *_context;
+
+        void put(char c)
+        {
+            if (_size == Size)
+            {
+                _flush(_context, _data, _size);
+                _size = 0;
+                _flushed = true;
+            }
+            _data[_size++] = c;
+        }
+
+    public:
+        ChunkedMessage(FlushFunction flush, void *context) : _flush(flush), _context(context) {}
+
+        ChunkedMessage(const ChunkedMessage &) = delete;
+        ChunkedMessage &operator=(const ChunkedMessage &) = delete;
+
+        Iterator begin()
+        {
+            return Iterator(*this);
+        }
+
+        /**
+         * @return true if at least one chunk has been handed on
+         */
+        bool flushed() const
+        {
+            return _flushed;
+        }
+
+        /**
+         * @return Bytes formatted since the last flush, the whole message if nothing was flushed
+         */
+        fmt::string_view pending() const
+        {
+            return fmt::string_view(_data, _size);
+        }
+    };
+
+} // namespace fmtlog
@@ -1,15 +1,48 @@
 #pragma once
 
 #include <Arduino.h>
+#include <atomic>
 #include <memory>
+#include <strings.h>
 #include "Config/Settings.h"
+#include "Config/Tags.h"
 #include "Benchmark/Benchmark.h"
+#include "Throttle/Throttle.h"
+#include "Sync/LogMutex.h"
 #include "fmt.h"
 
 #if LOG_FILE_ENABLE
 #include "FileStorage/FileStorageFactory.h"
 #endif
 
+#if LOG_ASYNC_ENABLE
+#include "Async/AsyncWriter.h"
+#endif
+
+#if LOG_ASYNC_DEFERRED
+#include "Async/DeferredArgs.h"
+#endif
+
+#if LOG_ISR_ENABLE
+#include "Isr/IsrQueue.h"
+#endif
+
+#if LOG_POLL_ENABLE
+#include "Poll/PollBuffer.h"
+#endif
+
+#if LOG_POOL_ENABLE
+#include "Memory/LogPool.h"
+#endif
+
+#if LOG_CHUNKED_ENABLE
+#include "Format/ChunkedMessage.h"
+#endif
+
+#if LOG_STACK_LIGHT_ENABLE
+#include "Memory/SharedBuffers.h"
+#endif
+
 namespace fmtlog
 {
 
@@ -18,93 +51,1305 @@ namespace fmtlog
         const char *filename = "";
         int line = 0;
         const char *funcname = "";
+        const char *fragment = nullptr; // Filename preamble rendered once per call site, see LOG_SOURCE_LOCATION()
+        LogTag tag = LogTag::UNTAGGED;  // LOG_TAG of the calling translation unit
 
         constexpr SourceLocation() = default;
-        constexpr SourceLocation(const char *filename, int line, const char *funcname)
-            : filename{filename}, line{line}, funcname{funcname} {}
+        constexpr SourceLocation(const char *filename, int line, const char *funcname, const char *fragment = nullptr, LogTag tag = LogTag::UNTAGGED)
+            : filename{filename}, line{line}, funcname{funcname}, fragment{fragment}, tag{tag} {}
     };
 
+    /**
+     * Filename preamble of a location for LOG_FILENAME: the call site's fragment, or rendered into
+     * the result if the location has none.
+     */
+    inline FilenameText formatFilename(const SourceLocation &loc)
+    {
+        if (loc.fragment)
+            return FilenameText(loc.fragment);
+        return formatFilename(loc.filename, loc.line, loc.funcname, static_cast<LogFilename>(LOG_FILENAME));
+    }
+
+#if LOG_ISR_ENABLE
+    /**
+     * Call site of a LOG_ISR_* macro. Constant-initialized, records only store its address.
+     */
+    struct IsrSite
+    {
+        SourceLocation loc;
+        LogLevel level;
+        const char *format;
+    };
+#endif
+
+    /**
+     * Most verbose level any output of the global logger accepts, per tag. The LOG_* macros read it
+     * before evaluating their arguments, so a call filtered at runtime costs one load and one compare.
+     * Constant-initialized, so reading it needs no guard or function call.
+     */
+    template <typename T = void>
+    struct LogGate
+    {
+        static std::atomic<uint8_t> levels[LOG_TAG_COUNT];
+
+        static bool enabled(LogTag tag, LogLevel value)
+        {
+            return static_cast<uint8_t>(value) <= levels[static_cast<size_t>(tag)].load(std::memory_order_relaxed);
+        }
+    };
+
+#define _LOG_TAG_GATE(name) {LOG_LEVEL},
+
+    template <typename T>
+    std::atomic<uint8_t> LogGate<T>::levels[LOG_TAG_COUNT] = {{LOG_LEVEL}, LOG_TAG_LIST(_LOG_TAG_GATE)};
+
     class FormatLog
     {
         using PanicHandler = void (*)();
+        using LineBuffer = fmt::basic_memory_buffer<char, LOG_STATIC_BUFFER_SIZE, LOG_BUFFER_ALLOCATOR>;
+#if LOG_THREAD_SAFE
+        using OutputMutex = LogMutex;
+#else
+        using OutputMutex = NullMutex;
+#endif
+        using OutputLock = LockGuard<OutputMutex>;
+
+#if LOG_DEDUP_ENABLE
+        /**
+         * Last message written to one output, and how often it was repeated since (held back).
+         */
+        struct RepeatState
+        {
+            uint32_t hash = 0;
+            uint32_t size = 0;                 // Length of the message body
+            char body[LOG_DEDUP_COMPARE_SIZE]; // Its first bytes, so a hash collision isn't taken for a repeat
+            uint32_t count = 0;                // Repeats held back
+            uint32_t firstMs = 0;              // When the message was written
+            uint32_t lastMs = 0;               // When it was last repeated
+            SourceLocation loc;
+            LogLevel level = LogLevel::DISABLE;
+        };
+#endif
+
+        /**
+         * Extra destination added with addStream() or addFileStorage(), filtered by its own level.
+         */
+        struct LogOutput
+        {
+            Stream *stream = nullptr;
+#if LOG_FILE_ENABLE
+            std::shared_ptr<IFileSink> fileSink;
+#endif
+            LogLevel level = LogLevel::DISABLE;
+#if LOG_DEDUP_ENABLE
+            RepeatState repeat;
+#endif
+        };
 
     private:
+        OutputMutex outputMutex; // Held while lines are written to the outputs, or the outputs change
+
+#if LOG_STACK_LIGHT_ENABLE
+        // Stack-light mode: message bodies are formatted in a shared buffer, lines composed in the
+        // locked ones while holding outputMutex, instead of on the caller's stack
+        SharedBuffers<LineBuffer, LOG_SHARED_BUFFER_COUNT> bodyBuffers;
+        std::atomic<uint32_t> stackFallbacks{0};
+        LineBuffer lockedLine;
+#if LOG_DEDUP_ENABLE
+        LineBuffer lockedRepeat;
+#endif
+#if LOG_SHED_ENABLE
+        LineBuffer lockedMarker;
+#endif
+#define _LOG_LOCKED_BUFFER(name, member) \
+    LineBuffer &name = member;           \
+    name.clear()
+#else
+#define _LOG_LOCKED_BUFFER(name, member) LineBuffer name
+#endif
         Stream *serial = nullptr;
+#if LOG_DEDUP_ENABLE
+        RepeatState serialRepeat;
+#endif
         LogLevel logLevel = static_cast<LogLevel>(LOG_LEVEL);
         PanicHandler panicHandler = LOG_PANIC_HANDLER;
 
+        LogOutput outputs[LOG_MAX_OUTPUTS > 0 ? LOG_MAX_OUTPUTS : 1];
+        size_t outputCount = 0;
+
+        static const uint8_t TAG_LEVEL_INHERIT = 0xFF;
+
+        uint8_t tagLevels[LOG_TAG_COUNT];                  // Level set per tag, or TAG_LEVEL_INHERIT to use each output's level
+        std::atomic<uint8_t> enabledLevels[LOG_TAG_COUNT]; // Most verbose level accepted by any output, per tag (read without the lock)
+        std::atomic<uint8_t> *gate = nullptr;              // LogGate levels kept in sync for the global logger
+
 #if LOG_FILE_ENABLE
         std::shared_ptr<IFileSink> fileStorage;
         LogLevel fileLogLevel = static_cast<LogLevel>(LOG_FILE_LEVEL);
+#if LOG_DEDUP_ENABLE
+        RepeatState fileRepeat;
+#endif
+
+        bool shouldLogFileStorage(LogTag tag, LogLevel level)
+        {
+            return fileStorage && level <= outputLevel(tag, fileLogLevel);
+        }
+#endif
+
+        bool shouldLog(LogTag tag, LogLevel level)
+        {
+            return serial && level <= outputLevel(tag, logLevel);
+        }
+
+        // Level an output applies to a message: the tag's level if one is set, otherwise the output's own
+        LogLevel outputLevel(LogTag tag, LogLevel level) const
+        {
+            uint8_t tagLevel = tagLevels[static_cast<size_t>(tag)];
+            return tagLevel == TAG_LEVEL_INHERIT ? level : static_cast<LogLevel>(tagLevel);
+        }
+
+        // True if at least one output accepts the level, checked before formatting anything
+        bool shouldLogAny(LogTag tag, LogLevel level)
+        {
+            return static_cast<uint8_t>(level) <= enabledLevels[static_cast<size_t>(tag)].load(std::memory_order_relaxed);
+        }
+
+        // Must be called with outputMutex held whenever an output, a level or a tag level changes
+        void updateEnabledLevel()
+        {
+            bool hasOutput = serial != nullptr || outputCount > 0;
+            LogLevel level = serial ? logLevel : LogLevel::DISABLE;
+#if LOG_FILE_ENABLE
+            hasOutput = hasOutput || fileStorage;
+            if (fileStorage && fileLogLevel > level)
+                level = fileLogLevel;
+#endif
+            for (size_t i = 0; i < outputCount; ++i)
+            {
+                if (outputs[i].level > level)
+                    level = outputs[i].level;
+            }
+
+            for (size_t i = 0; i < LOG_TAG_COUNT; ++i)
+            {
+                LogLevel tagLevel = hasOutput ? outputLevel(static_cast<LogTag>(i), level) : LogLevel::DISABLE;
+                // The gate stays open for shed levels, so their calls reach acceptLine() and can end shedding
+                if (gate)
+                    gate[i].store(static_cast<uint8_t>(tagLevel), std::memory_order_relaxed);
+#if LOG_SHED_ENABLE
+                if (shedding.load(std::memory_order_relaxed) && tagLevel > static_cast<LogLevel>(LOG_SHED_LEVEL))
+                    tagLevel = static_cast<LogLevel>(LOG_SHED_LEVEL);
+#endif
+                enabledLevels[i].store(static_cast<uint8_t>(tagLevel), std::memory_order_relaxed);
+            }
+        }
+
+        // One "name=level" entry of setTagLevels(), without updating the enabled levels
+        bool applyTagLevel(const char *entry, size_t length, const char *separator)
+        {
+            if (separator == nullptr)
+                return false;
+
+            size_t nameLength = separator - entry;
+            const char *levelText = separator + 1;
+            size_t levelLength = length - nameLength - 1;
+
+            uint8_t value;
+            LogLevel level;
+            if (levelLength == 7 && strncasecmp(levelText, "INHERIT", levelLength) == 0)
+                value = TAG_LEVEL_INHERIT;
+            else if (parseLogLevel(levelText, levelLength, level))
+                value = static_cast<uint8_t>(level);
+            else
+                return false;
+
+            if (nameLength == 1 && entry[0] == '*')
+            {
+                memset(tagLevels, value, sizeof(tagLevels));
+                return true;
+            }
+
+            LogTag tag;
+            if (!findLogTag(entry, nameLength, tag))
+                return false;
+            tagLevels[static_cast<size_t>(tag)] = value;
+            return true;
+        }
+
+        bool addOutput(const LogOutput &output)
+        {
+            waitForQueued();
+            OutputLock lock(outputMutex);
+
+            size_t index = 0;
+            while (index < outputCount && !isSameOutput(outputs[index], output))
+                ++index;
+
+            if (index == outputCount)
+            {
+                if (outputCount >= LOG_MAX_OUTPUTS)
+                    return false;
+                ++outputCount;
+            }
+
+            outputs[index] = output;
+            updateEnabledLevel();
+            return true;
+        }
+
+        static bool isSameOutput(const LogOutput &a, const LogOutput &b)
+        {
+#if LOG_FILE_ENABLE
+            if (a.fileSink || b.fileSink)
+                return a.fileSink == b.fileSink;
+#endif
+            return a.stream == b.stream;
+        }
+
+        void composeStreamPreamble(LineBuffer &buffer, const SourceLocation &loc, LogLevel level, const LogTimestamp &timestamp)
+        {
+            (void)loc; // Not every preamble configuration shows the location or the time
+            (void)timestamp;
+            APPEND_COLOR(buffer, level);
+            fmt::format_to(fmt::appender(buffer), LOG_PREAMBLE_FORMAT, LOG_PREAMBLE_LOCATION_ARGS(level, loc, timestamp));
+        }
+
+        static void composeStreamEnd(LineBuffer &buffer)
+        {
+            APPEND_RESET_COLOR(buffer);
+            buffer.append(fmt::string_view(LOG_EOL));
+        }
+
+        void composeStreamLine(LineBuffer &buffer, const SourceLocation &loc, LogLevel level, const LogTimestamp &timestamp, fmt::string_view message)
+        {
+            composeStreamPreamble(buffer, loc, level, timestamp);
+            buffer.append(message);
+            composeStreamEnd(buffer);
+        }
+
+#if LOG_FILE_ENABLE
+        void composeFilePreamble(LineBuffer &buffer, const SourceLocation &loc, LogLevel level, const LogTimestamp &timestamp)
+        {
+            (void)loc;
+            (void)timestamp;
+            fmt::format_to(fmt::appender(buffer), LOG_FILE_PREAMBLE_FORMAT, LOG_FILE_PREAMBLE_LOCATION_ARGS(level, loc, timestamp));
+        }
+
+        void composeFileLine(LineBuffer &buffer, const SourceLocation &loc, LogLevel level, const LogTimestamp &timestamp, fmt::string_view message)
+        {
+            composeFilePreamble(buffer, loc, level, timestamp);
+            buffer.append(message);
+            buffer.append(fmt::string_view(LOG_EOL));
+        }
+#endif
+
+#if LOG_DEDUP_ENABLE
+        // FNV-1a over the level and message body, far cheaper than composing and writing the line
+        static uint32_t hashMessage(LogLevel level, fmt::string_view message)
+        {
+            uint32_t hash = (2166136261u ^ static_cast<uint8_t>(level)) * 16777619u;
+            for (size_t i = 0; i < message.size(); ++i)
+                hash = (hash ^ static_cast<uint8_t>(message.data()[i])) * 16777619u;
+            return hash;
+        }
+
+        /**
+         * Checks a message against the last one written to an output. A different message (or a repeat
+         * after LOG_DEDUP_TIMEOUT_MS) becomes the output's last message, and the held back repeats of the
+         * previous one, if any, are returned in summary.
+         *
+         * @return true if the message repeats the last one and must be held back
+         */
+        static bool holdRepeat(RepeatState &state, const SourceLocation &loc, LogLevel level, uint32_t hash, fmt::string_view message, uint32_t now, RepeatState &summary)
+        {
+            size_t compared = message.size() < LOG_DEDUP_COMPARE_SIZE ? message.size() : LOG_DEDUP_COMPARE_SIZE;
+            if (hash == state.hash && level == state.level && message.size() == state.size &&
+                memcmp(message.data(), state.body, compared) == 0 && now - state.firstMs < LOG_DEDUP_TIMEOUT_MS)
+            {
+                ++state.count;
+                state.lastMs = now;
+                return true;
+            }
+
+            summary = state;
+            state.hash = hash;
+            state.size = static_cast<uint32_t>(message.size());
+            memcpy(state.body, message.data(), compared);
+            state.count = 0;
+            state.firstMs = now;
+            state.lastMs = now;
+            state.loc = loc;
+            state.level = level;
+            return false;
+        }
+
+        static void composeRepeatSummary(LineBuffer &buffer, const RepeatState &summary)
+        {
+            fmt::format_to(fmt::appender(buffer), LOG_DEDUP_FORMAT, summary.count, summary.lastMs - summary.firstMs);
+        }
+
+        void writeStreamRepeats(Stream *stream, const RepeatState &summary, const LogTimestamp &timestamp)
+        {
+            if (summary.count == 0)
+                return;
+            _LOG_LOCKED_BUFFER(line, lockedRepeat);
+            composeStreamPreamble(line, summary.loc, summary.level, timestamp);
+            composeRepeatSummary(line, summary);
+            composeStreamEnd(line);
+            emitStream(stream, line.data(), line.size(), summary.level);
+        }
+
+#if LOG_FILE_ENABLE
+        void writeFileRepeats(IFileSink &sink, const RepeatState &summary, const LogTimestamp &timestamp)
+        {
+            if (summary.count == 0)
+                return;
+            _LOG_LOCKED_BUFFER(line, lockedRepeat);
+            composeFilePreamble(line, summary.loc, summary.level, timestamp);
+            composeRepeatSummary(line, summary);
+            line.append(fmt::string_view(LOG_EOL));
+            emitFile(&sink, line.data(), line.size(), summary.level);
+        }
+#endif
+
+        bool holdStreamRepeat(RepeatState &state, Stream *stream, const SourceLocation &loc, LogLevel level, const LogTimestamp &timestamp, uint32_t hash, fmt::string_view message, uint32_t now)
+        {
+            RepeatState summary;
+            if (holdRepeat(state, loc, level, hash, message, now, summary))
+                return true;
+            writeStreamRepeats(stream, summary, timestamp);
+            return false;
+        }
+
+#if LOG_FILE_ENABLE
+        bool holdFileRepeat(RepeatState &state, IFileSink &sink, const SourceLocation &loc, LogLevel level, const LogTimestamp &timestamp, uint32_t hash, fmt::string_view message, uint32_t now)
+        {
+            RepeatState summary;
+            if (holdRepeat(state, loc, level, hash, message, now, summary))
+                return true;
+            writeFileRepeats(sink, summary, timestamp);
+            return false;
+        }
+#endif
+
+        /**
+         * Writes the summary of every output's held back repeats now, instead of on its next message.
+         */
+        void writeRepeats()
+        {
+            LogTimestamp timestamp = captureTimestamp(static_cast<LogTime>(LOG_TIME));
+            if (serial)
+                writeStreamRepeats(serial, serialRepeat, timestamp);
+            serialRepeat.count = 0;
+#if LOG_FILE_ENABLE
+            if (fileStorage)
+                writeFileRepeats(*fileStorage, fileRepeat, timestamp);
+            fileRepeat.count = 0;
+#endif
+            for (size_t i = 0; i < outputCount; ++i)
+            {
+                LogOutput &output = outputs[i];
+                if (output.stream)
+                    writeStreamRepeats(output.stream, output.repeat, timestamp);
+#if LOG_FILE_ENABLE
+                if (output.fileSink)
+                    writeFileRepeats(*output.fileSink, output.repeat, timestamp);
+#endif
+                output.repeat.count = 0;
+            }
+        }
+#endif
+
+#if LOG_SHED_ENABLE
+        // Load shedding: time spent writing lines, in two LOG_SHED_WINDOW_MS buckets forming a sliding window
+        uint32_t shedWindowStart = 0;
+        uint32_t shedPreviousUs = 0;
+        uint32_t shedCurrentUs = 0;
+        uint32_t shedSince = 0;
+        std::atomic<bool> shedding{false};      // Written with outputMutex held, read by acceptLine() without it
+        std::atomic<uint32_t> shedRecheckAt{0}; // While shedding: when a call of a shed level next checks the load
+
+        static constexpr LogLevel SHED_MARKER_LEVEL = LOG_SHED_LEVEL < LOG_LEVEL_WARN ? LogLevel::ERROR : LogLevel::WARN;
+
+        void advanceShedWindow(uint32_t now)
+        {
+            uint32_t elapsed = now - shedWindowStart;
+            if (elapsed < LOG_SHED_WINDOW_MS)
+                return;
+            bool adjacent = elapsed < 2 * LOG_SHED_WINDOW_MS;
+            shedPreviousUs = adjacent ? shedCurrentUs : 0;
+            shedCurrentUs = 0;
+            shedWindowStart = adjacent ? shedWindowStart + LOG_SHED_WINDOW_MS : now;
+        }
+
+        // Write time over the last LOG_SHED_WINDOW_MS, counting the part of the previous bucket still inside it
+        uint32_t shedLoadUs(uint32_t now) const
+        {
+            uint32_t remaining = LOG_SHED_WINDOW_MS - (now - shedWindowStart);
+            return static_cast<uint32_t>(static_cast<uint64_t>(shedPreviousUs) * remaining / LOG_SHED_WINDOW_MS) + shedCurrentUs;
+        }
+
+        /**
+         * Adds the time a line took to write, then starts or stops shedding. Shedding caps the enabled
+         * levels at LOG_SHED_LEVEL until the load falls below LOG_SHED_RESTORE_US (hysteresis).
+         */
+        void trackWriteTime(const SourceLocation &loc, uint32_t elapsedUs)
+        {
+            uint32_t now = millis();
+            advanceShedWindow(now);
+            shedCurrentUs += elapsedUs;
+            uint32_t load = shedLoadUs(now);
+#if LOG_POLL_ENABLE
+            size_t backlog = pollBuffer.pending();
+            bool over = load > LOG_SHED_BUDGET_US || backlog > LOG_SHED_BACKLOG_BYTES;
+            bool under = load < LOG_SHED_RESTORE_US && backlog < LOG_SHED_BACKLOG_BYTES / 2;
+#else
+            bool over = load > LOG_SHED_BUDGET_US;
+            bool under = load < LOG_SHED_RESTORE_US;
+#endif
+            bool wasShedding = shedding.load(std::memory_order_relaxed);
+            if (wasShedding)
+                shedRecheckAt.store(shedWindowStart + LOG_SHED_WINDOW_MS, std::memory_order_relaxed);
+            if (wasShedding ? !under : !over)
+                return;
+
+            shedding.store(!wasShedding, std::memory_order_relaxed);
+            updateEnabledLevel();
+
+            _LOG_LOCKED_BUFFER(marker, lockedMarker);
+            const char *levelText = logLevelText(static_cast<LogLevel>(LOG_SHED_LEVEL), static_cast<LogLevelTextFormat>(LOG_LEVEL_TEXT_FORMAT));
+            if (!wasShedding)
+            {
+                shedRecheckAt.store(shedWindowStart + LOG_SHED_WINDOW_MS, std::memory_order_relaxed);
+                shedSince = now;
+                fmt::format_to(fmt::appender(marker), LOG_SHED_START_FORMAT, levelText);
+            }
+            else
+            {
+                fmt::format_to(fmt::appender(marker), LOG_SHED_STOP_FORMAT, levelText, now - shedSince);
+            }
+            writeLineNow(loc, SHED_MARKER_LEVEL, captureTimestamp(static_cast<LogTime>(LOG_TIME)), fmt::string_view(marker.data(), marker.size()));
+        }
+
+        /**
+         * Called for a message of a shed level. Nothing of those levels is written while shedding, so once
+         * per window bucket one of their calls checks the load, and the levels come back when the
+         * outputs have caught up even if nothing else is logged.
+         */
+        void recheckShed(const SourceLocation &loc)
+        {
+            if (static_cast<int32_t>(millis() - shedRecheckAt.load(std::memory_order_relaxed)) < 0)
+                return;
+            OutputLock lock(outputMutex);
+            if (shedding.load(std::memory_order_relaxed))
+                trackWriteTime(loc, 0);
+        }
+#endif
+
+        /**
+         * Fans an already formatted message body out to every output that accepts its level.
+         * The serial and file lines are each composed at most once, however many outputs share them.
+         * With LOG_DEDUP_ENABLE, an output skips a message identical to the last one it was written.
+         */
+        void writeLineNow(const SourceLocation &loc, LogLevel level, const LogTimestamp &timestamp, fmt::string_view message)
+        {
+#if LOG_SHED_ENABLE
+            // Also drops lines queued before shedding started
+            if (shedding.load(std::memory_order_relaxed) && level > static_cast<LogLevel>(LOG_SHED_LEVEL))
+                return;
+            uint32_t startUs = micros();
+#endif
+            _LOG_LOCKED_BUFFER(buffer, lockedLine);
+            bool composed = false;
+#if LOG_DEDUP_ENABLE
+            uint32_t hash = hashMessage(level, message);
+            uint32_t now = millis();
+#define _LOG_HOLD_STREAM_REPEAT(state, stream) holdStreamRepeat(state, stream, loc, level, timestamp, hash, message, now)
+#define _LOG_HOLD_FILE_REPEAT(state, sink) holdFileRepeat(state, sink, loc, level, timestamp, hash, message, now)
+#else
+#define _LOG_HOLD_STREAM_REPEAT(state, stream) false
+#define _LOG_HOLD_FILE_REPEAT(state, sink) false
+#endif
+
+            if (shouldLog(loc.tag, level) && !_LOG_HOLD_STREAM_REPEAT(serialRepeat, serial))
+            {
+                composeStreamLine(buffer, loc, level, timestamp, message);
+                composed = true;
+                emitStream(serial, buffer.data(), buffer.size(), level);
+            }
+
+            for (size_t i = 0; i < outputCount; ++i)
+            {
+                LogOutput &output = outputs[i];
+                if (output.stream == nullptr || level > outputLevel(loc.tag, output.level) ||
+                    _LOG_HOLD_STREAM_REPEAT(output.repeat, output.stream))
+                    continue;
+                if (!composed)
+                {
+                    composeStreamLine(buffer, loc, level, timestamp, message);
+                    composed = true;
+                }
+                emitStream(output.stream, buffer.data(), buffer.size(), level);
+            }
+
+#if LOG_FILE_ENABLE
+            buffer.clear();
+            composed = false;
+
+            if (shouldLogFileStorage(loc.tag, level) && !_LOG_HOLD_FILE_REPEAT(fileRepeat, *fileStorage))
+            {
+                composeFileLine(buffer, loc, level, timestamp, message);
+                composed = true;
+                emitFile(fileStorage.get(), buffer.data(), buffer.size(), level);
+            }
+
+            for (size_t i = 0; i < outputCount; ++i)
+            {
+                LogOutput &output = outputs[i];
+                if (!output.fileSink || level > outputLevel(loc.tag, output.level) ||
+                    _LOG_HOLD_FILE_REPEAT(output.repeat, *output.fileSink))
+                    continue;
+                if (!composed)
+                {
+                    composeFileLine(buffer, loc, level, timestamp, message);
+                    composed = true;
+                }
+                emitFile(output.fileSink.get(), buffer.data(), buffer.size(), level);
+            }
+#endif
+#undef _LOG_HOLD_STREAM_REPEAT
+#undef _LOG_HOLD_FILE_REPEAT
+#if LOG_SHED_ENABLE
+            trackWriteTime(loc, micros() - startUs);
+#endif
+        }
+
+        // Writes a line whose timestamp was taken when the message was logged or recorded
+        void writeLineAt(const SourceLocation &loc, LogLevel level, const LogTimestamp &timestamp, fmt::string_view message)
+        {
+#if LOG_ASYNC_ENABLE
+            if (asyncEnabled)
+            {
+                LineHeader header;
+                header.loc = loc;
+                header.timestamp = timestamp;
+                header.level = level;
+                asyncWriter.write(AsyncTarget::LINE, header, message.data(), message.size());
+                return;
+            }
+#endif
+            OutputLock lock(outputMutex);
+            writeLineNow(loc, level, timestamp, message);
+        }
+
+        // Out of line, so its frame is only on the stack once the message body is formatted
+        __attribute__((noinline)) void writeLine(const SourceLocation &loc, LogLevel level, fmt::string_view message)
+        {
+            writeLineAt(loc, level, captureTimestamp(static_cast<LogTime>(LOG_TIME)), message);
+        }
+
+#if LOG_CHUNKED_ENABLE
+        /**
+         * Line whose body goes out in chunks while it is formatted (LOG_CHUNKED_ENABLE). The first
+         * chunk takes the output lock and writes the preambles; it is released when the line ends.
+         */
+        struct ChunkedLine
+        {
+            FormatLog *self;
+            const SourceLocation &loc;
+            LogLevel level;
+            LogTimestamp timestamp;
+            bool started = false;
+#if LOG_SHED_ENABLE
+            uint32_t startUs = 0;
+#endif
+
+            ChunkedLine(FormatLog *self, const SourceLocation &loc, LogLevel level)
+                : self(self), loc(loc), level(level), timestamp(captureTimestamp(static_cast<LogTime>(LOG_TIME))) {}
+
+            ~ChunkedLine()
+            {
+                if (started)
+                    self->outputMutex.unlock();
+            }
+        };
+
+        /**
+         * Writes part of a chunked line to every Stream that accepts its level. The first part ends
+         * any run of held back repeats, a chunked line can't be compared with the last message.
+         */
+        void writeChunkedStreams(const ChunkedLine &line, fmt::string_view part)
+        {
+            const SourceLocation &loc = line.loc;
+            LogLevel level = line.level;
+#if LOG_DEDUP_ENABLE
+#define _LOG_END_REPEATS(state, write, output) \
+    if (!line.started)                         \
+    {                                          \
+        write(output, state, line.timestamp);  \
+        state = RepeatState();                 \
+    }
+#else
+#define _LOG_END_REPEATS(state, write, output)
+#endif
+            if (shouldLog(loc.tag, level))
+            {
+                _LOG_END_REPEATS(serialRepeat, writeStreamRepeats, serial)
+                emitStream(serial, part.data(), part.size(), level);
+            }
+
+            for (size_t i = 0; i < outputCount; ++i)
+            {
+                LogOutput &output = outputs[i];
+                if (output.stream == nullptr || level > outputLevel(loc.tag, output.level))
+                    continue;
+                _LOG_END_REPEATS(output.repeat, writeStreamRepeats, output.stream)
+                emitStream(output.stream, part.data(), part.size(), level);
+            }
+        }
+
+        // Same for the file sinks
+        void writeChunkedFiles(const ChunkedLine &line, fmt::string_view part)
+        {
+#if LOG_FILE_ENABLE
+            const SourceLocation &loc = line.loc;
+            LogLevel level = line.level;
+            if (shouldLogFileStorage(loc.tag, level))
+            {
+                _LOG_END_REPEATS(fileRepeat, writeFileRepeats, *fileStorage)
+                emitFile(fileStorage.get(), part.data(), part.size(), level);
+            }
+
+            for (size_t i = 0; i < outputCount; ++i)
+            {
+                LogOutput &output = outputs[i];
+                if (!output.fileSink || level > outputLevel(loc.tag, output.level))
+                    continue;
+                _LOG_END_REPEATS(output.repeat, writeFileRepeats, *output.fileSink)
+                emitFile(output.fileSink.get(), part.data(), part.size(), level);
+            }
+#else
+            (void)line;
+            (void)part;
+#endif
+        }
+#undef _LOG_END_REPEATS
+
+        static void writeChunk(void *context, const char *data, size_t size)
+        {
+            ChunkedLine &line = *static_cast<ChunkedLine *>(context);
+            FormatLog *self = line.self;
+            if (!line.started)
+            {
+                self->outputMutex.lock();
+#if LOG_SHED_ENABLE
+                line.startUs = micros();
+#endif
+                _LOG_LOCKED_BUFFER(preamble, self->lockedLine);
+                self->composeStreamPreamble(preamble, line.loc, line.level, line.timestamp);
+                self->writeChunkedStreams(line, fmt::string_view(preamble.data(), preamble.size()));
+#if LOG_FILE_ENABLE
+                preamble.clear();
+                self->composeFilePreamble(preamble, line.loc, line.level, line.timestamp);
+                self->writeChunkedFiles(line, fmt::string_view(preamble.data(), preamble.size()));
+#endif
+                line.started = true;
+            }
+            self->writeChunkedStreams(line, fmt::string_view(data, size));
+            self->writeChunkedFiles(line, fmt::string_view(data, size));
+        }
+
+        /**
+         * Formats a message body straight to the outputs. A body that fits in LOG_STATIC_BUFFER_SIZE
+         * is written as one line like any other. A longer one is written a chunk at a time as the
+         * buffer fills, so it never needs more RAM, but holds the output lock until it is formatted.
+         */
+        void logChunked(const SourceLocation &loc, LogLevel level, fmt::string_view format, fmt::format_args args)
+        {
+            ChunkedLine line(this, loc, level);
+            ChunkedMessage<LOG_STATIC_BUFFER_SIZE> message(&FormatLog::writeChunk, &line);
+            formatMessage(message.begin(), format, args);
+            if (!message.flushed())
+            {
+                writeLine(loc, level, message.pending());
+                return;
+            }
+
+#if LOG_COLOR == LOG_COLOR_ENABLE
+            static const char streamEnd[] = COLOR_RESET LOG_EOL;
+#else
+            static const char streamEnd[] = LOG_EOL;
+#endif
+            writeChunkedStreams(line, message.pending());
+            writeChunkedFiles(line, message.pending());
+            writeChunkedStreams(line, fmt::string_view(streamEnd, sizeof(streamEnd) - 1));
+            writeChunkedFiles(line, fmt::string_view(LOG_EOL));
+#if LOG_SHED_ENABLE
+            trackWriteTime(loc, micros() - line.startUs);
+#endif
+        }
+#endif
+
+#if LOG_ISR_ENABLE
+        std::atomic<bool> isrDraining{false};
 
-        bool shouldLogFileStorage(LogLevel level)
+        // Rebuilds the timestamp of an ISR record, which only reads the cheap clock
+        static LogTimestamp isrTimestamp(uint32_t time)
         {
-            return fileStorage && level <= fileLogLevel;
+            LogTimestamp timestamp;
+#if LOG_TIME == LOG_TIME_MICROS
+            timestamp.micros = time;
+#elif LOG_TIME == LOG_TIME_LOCALTIME
+            uint32_t age = millis() - time;
+            gettimeofday(&timestamp.wall, NULL);
+            long usec = timestamp.wall.tv_usec - static_cast<long>(age % 1000) * 1000;
+            timestamp.wall.tv_sec -= age / 1000 + (usec < 0 ? 1 : 0);
+            timestamp.wall.tv_usec = usec < 0 ? usec + 1000000 : usec;
+#else
+            timestamp.millis = time;
+#endif
+            return timestamp;
+        }
+
+        // Ring holding the oldest pending record across interrupt contexts, or nullptr if all are empty
+        static IsrQueue<>::Ring *oldestIsrRing()
+        {
+            IsrQueue<>::Ring *oldest = nullptr;
+            uint32_t oldestTime = 0;
+            for (size_t i = 0; i < LOG_ISR_CONTEXTS; ++i)
+            {
+                const IsrRecord *record = IsrQueue<>::rings[i].front();
+                if (record && (oldest == nullptr || static_cast<int32_t>(record->time - oldestTime) < 0))
+                {
+                    oldest = &IsrQueue<>::rings[i];
+                    oldestTime = record->time;
+                }
+            }
+            return oldest;
         }
 #endif
 
-        bool shouldLog(LogLevel level)
+#if LOG_ASYNC_ENABLE
+        // Start of every queued line, followed by the formatted message body
+        struct LineHeader
         {
-            return serial && level <= logLevel;
+            SourceLocation loc;
+            LogTimestamp timestamp;
+            LogLevel level;
+        };
+
+#if LOG_ASYNC_DEFERRED
+        // Start of every deferred record, followed by the serialized arguments
+        struct DeferredHeader
+        {
+            void (*formatter)(const char *in, fmt::string_view format, fmt::appender out);
+            const char *format;
+            size_t formatSize;
+            LineHeader line;
+        };
+
+        using AsyncHeader = DeferredHeader; // Largest header queued, LOG_ASYNC_RECORD_SIZE is on top of it
+#else
+        using AsyncHeader = LineHeader;
+#endif
+
+        AsyncWriter<sizeof(AsyncHeader)> asyncWriter{&FormatLog::drainRecord, this};
+        bool asyncEnabled = true;
+
+        // Composes a queued line with the timestamp captured at the call site
+        void writeQueuedLine(const LineHeader &header, fmt::string_view message)
+        {
+            writeLineNow(header.loc, header.level, header.timestamp, message);
         }
 
+        static void drainRecord(void *context, AsyncTarget target, const char *data, size_t size)
+        {
+            FormatLog *self = static_cast<FormatLog *>(context);
+            OutputLock lock(self->outputMutex);
+            if (target == AsyncTarget::STREAM)
+            {
+                if (self->serial)
+                    self->serial->write(reinterpret_cast<const uint8_t *>(data), size);
+            }
+            else if (target == AsyncTarget::LINE)
+            {
+                LineHeader header;
+                memcpy(&header, data, sizeof(header));
+                self->writeQueuedLine(header, fmt::string_view(data + sizeof(header), size - sizeof(header)));
+            }
+#if LOG_FILE_ENABLE
+            else if (target == AsyncTarget::FILE_STORAGE)
+            {
+                if (self->fileStorage)
+                    self->fileStorage->writeLine(data, size, LogLevel::DISABLE);
+            }
+#endif
+#if LOG_ASYNC_DEFERRED
+            else if (target == AsyncTarget::DEFERRED)
+            {
+                self->writeDeferred(data);
+            }
+#endif
+        }
+#endif
+
+#if LOG_ASYNC_DEFERRED
+        /**
+         * Copies the format string pointer, location, timestamp and arguments into a queue record.
+         *
+         * @return false if the message must be formatted at the call site instead (arguments larger than
+         *         LOG_ASYNC_RECORD_SIZE, or no drain task)
+         */
         template <typename... Args>
-        void log(SourceLocation loc, LogLevel level, fmt::format_string<Args...> format, Args &&...args)
+        bool logDeferred(std::true_type, SourceLocation loc, LogLevel level, fmt::string_view format, const Args &...args)
         {
-            if (shouldLog(level))
+            using Format = DeferredFormat<Args...>;
+            size_t argsSize = Format::size(args...);
+            if (argsSize > LOG_ASYNC_RECORD_SIZE || !asyncWriter.ensureStarted())
+                return false;
+
+            size_t ticket;
+            auto *record = asyncWriter.reserve(ticket);
+            if (record == nullptr)
+                return true;
+
+            DeferredHeader header;
+            header.formatter = &Format::format;
+            header.format = format.data();
+            header.formatSize = format.size();
+            header.line.loc = loc;
+            header.line.timestamp = captureTimestamp(static_cast<LogTime>(LOG_TIME));
+            header.line.level = level;
+
+            memcpy(record->data, &header, sizeof(header));
+            Format::write(record->data + sizeof(header), args...);
+            record->target = AsyncTarget::DEFERRED;
+            record->size = sizeof(header) + argsSize;
+            asyncWriter.commit(ticket);
+            return true;
+        }
+
+        // Argument types that cannot be copied safely, format at the call site
+        template <typename... Args>
+        bool logDeferred(std::false_type, SourceLocation, LogLevel, fmt::string_view, const Args &...)
+        {
+            return false;
+        }
+
+        /**
+         * Formats a deferred record on the drain task, then fans it out like any other line.
+         */
+        void writeDeferred(const char *data)
+        {
+            DeferredHeader header;
+            memcpy(&header, data, sizeof(header));
+
+            LineBuffer body;
+            header.formatter(data + sizeof(header), fmt::string_view(header.format, header.formatSize), fmt::appender(body));
+            writeQueuedLine(header.line, fmt::string_view(body.data(), body.size()));
+        }
+#endif
+
+        // level only matters to LOG_STREAM_FULL_DROP_LOW, prints count as INFO
+        void writeSerial(const char *data, size_t size, LogLevel level = LogLevel::INFO)
+        {
+#if LOG_ASYNC_ENABLE
+            if (asyncEnabled)
             {
-                fmt::basic_memory_buffer<char, LOG_STATIC_BUFFER_SIZE> buffer;
-                APPEND_COLOR(buffer, level);
-                fmt::format_to(fmt::appender(buffer), LOG_PREAMBLE_FORMAT, LOG_PREAMBLE_ARGS(level, loc.filename, loc.line, loc.funcname));
-                fmt::vformat_to(fmt::appender(buffer), format, fmt::make_format_args(args...));
-                APPEND_RESET_COLOR(buffer);
-                buffer.append(fmt::string_view(LOG_EOL));
-                serial->write(reinterpret_cast<const uint8_t *>(buffer.data()), buffer.size());
+                asyncWriter.write(AsyncTarget::STREAM, data, size);
+                return;
             }
+#endif
+            OutputLock lock(outputMutex);
+            emitStream(serial, data, size, level);
+        }
 
 #if LOG_FILE_ENABLE
-            if (shouldLogFileStorage(level))
+        void writeFile(const char *data, size_t size)
+        {
+#if LOG_ASYNC_ENABLE
+            if (asyncEnabled)
+            {
+                asyncWriter.write(AsyncTarget::FILE_STORAGE, data, size);
+                return;
+            }
+#endif
+            OutputLock lock(outputMutex);
+            emitFile(fileStorage.get(), data, size, LogLevel::DISABLE);
+        }
+#endif
+
+#if LOG_POLL_ENABLE
+        PollBuffer<LOG_POLL_BUFFER_SIZE> pollBuffer;
+
+        /**
+         * Writes queued output, oldest first. Unless blocking, stops at the first Stream without room
+         * and once LOG_POLL_FILE_BUDGET_MS has been spent, leaving the rest for the next call.
+         */
+        void writePolled(bool blocking)
+        {
+#if LOG_FILE_ENABLE
+            uint32_t start = millis();
+#endif
+            PollBuffer<LOG_POLL_BUFFER_SIZE>::Header header;
+            while (pollBuffer.front(header))
+            {
+                const char *data;
+                size_t size;
+                if (header.target == PollTarget::STREAM)
+                {
+                    Stream *stream = static_cast<Stream *>(header.output);
+                    int room = blocking ? header.size : stream->availableForWrite();
+                    if (room <= 0)
+                        return;
+                    size = pollBuffer.peek(header, data, static_cast<size_t>(room));
+                    size_t written = stream->write(reinterpret_cast<const uint8_t *>(data), size);
+                    if (written == 0 && !blocking)
+                        return;
+                    size = written == 0 ? size : written; // When blocking, skip what a stream refuses instead of retrying forever
+                }
+                else
+                {
+#if LOG_FILE_ENABLE
+                    if (!blocking && millis() - start >= LOG_POLL_FILE_BUDGET_MS)
+                        return;
+                    size = pollBuffer.peek(header, data, header.size);
+                    static_cast<IFileSink *>(header.output)->writeLine(data, size, static_cast<LogLevel>(header.level));
+#else
+                    size = header.size;
+#endif
+                }
+                pollBuffer.consume(header, size);
+            }
+        }
+#endif
+
+#if LOG_STREAM_FULL_POLICY != LOG_STREAM_FULL_BLOCK
+        uint32_t streamDropped = 0;
+        uint32_t streamTruncated = 0;
+        uint32_t streamBlocked = 0;
+        bool panicking = false; // A failed assertion always writes its message
+
+        /**
+         * Applies LOG_STREAM_FULL_POLICY to a line that doesn't fit in availableForWrite().
+         */
+        void writeStreamFull(Stream *stream, const char *data, size_t size, LogLevel level, int room)
+        {
+#if LOG_STREAM_FULL_POLICY == LOG_STREAM_FULL_DROP_LOW
+            (void)room;
+            if (static_cast<int>(level) <= LOG_STREAM_KEEP_LEVEL || panicking)
             {
-                fmt::basic_memory_buffer<char, LOG_STATIC_BUFFER_SIZE> buffer;
-                fmt::format_to(fmt::appender(buffer), LOG_FILE_PREAMBLE_FORMAT, LOG_FILE_PREAMBLE_ARGS(level, loc.filename, loc.line, loc.funcname));
-                fmt::vformat_to(fmt::appender(buffer), format, fmt::make_format_args(args...));
-                buffer.append(fmt::string_view(LOG_EOL));
-                fileStorage->write(buffer.data(), buffer.size());
+                ++streamBlocked;
+                stream->write(reinterpret_cast<const uint8_t *>(data), size);
+                return;
             }
+#elif LOG_STREAM_FULL_POLICY == LOG_STREAM_FULL_TRUNCATE
+            (void)level;
+#if LOG_COLOR == LOG_COLOR_ENABLE
+            static const char marker[] = COLOR_RESET LOG_STREAM_TRUNCATED_MARKER;
+#else
+            static const char marker[] = LOG_STREAM_TRUNCATED_MARKER;
 #endif
+            if (room > static_cast<int>(sizeof(marker) - 1))
+            {
+                ++streamTruncated;
+                stream->write(reinterpret_cast<const uint8_t *>(data), room - (sizeof(marker) - 1));
+                stream->write(reinterpret_cast<const uint8_t *>(marker), sizeof(marker) - 1);
+                return;
+            }
+#else
+            (void)level;
+            (void)room;
+#endif
+            if (panicking)
+            {
+                stream->write(reinterpret_cast<const uint8_t *>(data), size);
+                return;
+            }
+            ++streamDropped;
+        }
+#endif
+
+        // Writes to a Stream output, or queues it in cooperative mode (LOG_POLL_ENABLE)
+        void emitStream(Stream *stream, const char *data, size_t size, LogLevel level)
+        {
+#if LOG_POLL_ENABLE
+            (void)level;
+            pollBuffer.push(PollTarget::STREAM, stream, data, size);
+#elif LOG_STREAM_FULL_POLICY != LOG_STREAM_FULL_BLOCK
+            int room = stream->availableForWrite();
+            if (room >= static_cast<int>(size))
+                stream->write(reinterpret_cast<const uint8_t *>(data), size);
+            else
+                writeStreamFull(stream, data, size, level, room);
+#else
+            (void)level;
+            stream->write(reinterpret_cast<const uint8_t *>(data), size);
+#endif
+        }
+
+#if LOG_FILE_ENABLE
+        // level is the line's, or DISABLE for raw prints; sinks use it for their FlushPolicy
+        void emitFile(IFileSink *sink, const char *data, size_t size, LogLevel level)
+        {
+#if LOG_POLL_ENABLE
+            pollBuffer.push(PollTarget::FILE_SINK, sink, data, size, static_cast<uint8_t>(level));
+#else
+            sink->writeLine(data, size, level);
+#endif
+        }
+#endif
+
+        // Waits until queued output (async or cooperative mode) has been written
+        void waitForQueued()
+        {
+#if LOG_ASYNC_ENABLE
+            asyncWriter.flush();
+#elif LOG_POLL_ENABLE
+            OutputLock lock(outputMutex);
+            writePolled(true);
+#endif
+        }
+
+        /**
+         * Calls use(buffer) with an empty buffer for a message body: one of the shared buffers with
+         * LOG_STACK_LIGHT_ENABLE, or one on the stack.
+         */
+        template <typename Use>
+        void withBodyBuffer(Use use)
+        {
+#if LOG_STACK_LIGHT_ENABLE
+            LineBuffer *buffer = bodyBuffers.acquire();
+            if (buffer != nullptr)
+            {
+                use(*buffer);
+                bodyBuffers.release(buffer);
+                return;
+            }
+            stackFallbacks.fetch_add(1, std::memory_order_relaxed);
+            withStackBuffer(use);
+#else
+            LineBuffer buffer;
+            use(buffer);
+#endif
+        }
+
+#if LOG_STACK_LIGHT_ENABLE
+        // Out of line, so the buffer only takes stack when all shared ones are taken
+        template <typename Use>
+        static __attribute__((noinline)) void withStackBuffer(Use &use)
+        {
+            LineBuffer buffer;
+            use(buffer);
+        }
+#endif
+
+        /**
+         * Formats a message body, cut at LOG_MESSAGE_MAX_SIZE bytes and ended with LOG_MESSAGE_TRUNCATED_FORMAT.
+         */
+        template <typename OutputIt>
+        static void formatMessage(OutputIt out, fmt::string_view format, fmt::format_args args)
+        {
+#if LOG_MESSAGE_MAX_SIZE > 0
+            // Bytes past the limit are formatted and counted, never stored
+            auto result = fmt::vformat_to_n(out, LOG_MESSAGE_MAX_SIZE, format, args);
+            if (result.size > LOG_MESSAGE_MAX_SIZE)
+                fmt::format_to(result.out, LOG_MESSAGE_TRUNCATED_FORMAT, result.size - LOG_MESSAGE_MAX_SIZE);
+#else
+            fmt::vformat_to(out, format, args);
+#endif
+        }
+
+        /**
+         * Lines queued from interrupts go out first, then the level decides if any output takes the line.
+         * While shedding, a call of a shed level may first find that the outputs have caught up.
+         */
+        bool acceptLine(const SourceLocation &loc, LogLevel level)
+        {
+#if LOG_ISR_ENABLE
+            if (gate && IsrQueue<>::pending())
+                drainIsr();
+#endif
+#if LOG_SHED_ENABLE
+            if (level > static_cast<LogLevel>(LOG_SHED_LEVEL) && shedding.load(std::memory_order_relaxed))
+                recheckShed(loc);
+#endif
+            return shouldLogAny(loc.tag, level);
+        }
+
+        /**
+         * Formats the message body once and hands it to every output, each adding its own preamble.
+         */
+        __attribute__((noinline)) void formatLine(const SourceLocation &loc, LogLevel level, fmt::string_view format, fmt::format_args args)
+        {
+#if LOG_CHUNKED_ENABLE
+            logChunked(loc, level, format, args);
+#else
+            withBodyBuffer([&](LineBuffer &body)
+                           {
+                               formatMessage(fmt::appender(body), format, args);
+                               writeLine(loc, level, fmt::string_view(body.data(), body.size()));
+                           });
+#endif
+        }
+
+        // Only erases the argument types, everything else happens once in vlog()
+        template <typename... Args>
+        void log(SourceLocation loc, LogLevel level, fmt::format_string<Args...> format, Args &&...args)
+        {
+#if LOG_ASYNC_DEFERRED
+            using Deferrable = std::integral_constant<bool, DeferredFormat<Args...>::value>;
+            if (Deferrable::value && asyncEnabled)
+            {
+                if (acceptLine(loc, level) && !logDeferred(Deferrable(), loc, level, fmt::string_view(format), args...))
+                    formatLine(loc, level, format, fmt::make_format_args(args...));
+                return;
+            }
+#endif
+            vlog(loc, level, format, fmt::make_format_args(args...));
+        }
+
+        __attribute__((noinline)) void vprint(fmt::string_view format, fmt::format_args args, bool newline)
+        {
+            withBodyBuffer([&](LineBuffer &buffer)
+                           {
+                               fmt::vformat_to(fmt::appender(buffer), format, args);
+                               if (newline)
+                                   buffer.append(fmt::string_view(LOG_EOL));
+                               writeSerial(buffer.data(), buffer.size());
+                           });
+        }
+
+#if LOG_FILE_ENABLE
+        __attribute__((noinline)) void vprintFile(fmt::string_view format, fmt::format_args args, bool newline)
+        {
+            if (!fileStorage)
+                return;
+            withBodyBuffer([&](LineBuffer &buffer)
+                           {
+                               fmt::vformat_to(fmt::appender(buffer), format, args);
+                               if (newline)
+                                   buffer.append(fmt::string_view(LOG_EOL));
+                               writeFile(buffer.data(), buffer.size());
+                           });
+        }
+#endif
+
+        __attribute__((cold, noinline)) void vthrottled(const SourceLocation &loc, LogLevel level, uint32_t suppressed, fmt::string_view format, fmt::format_args args)
+        {
+            if (!acceptLine(loc, level))
+                return;
+
+            withBodyBuffer([&](LineBuffer &body)
+                           {
+                               formatMessage(fmt::appender(body), format, args);
+                               fmt::format_to(fmt::appender(body), LOG_SUPPRESSED_FORMAT, suppressed);
+                               writeLine(loc, level, fmt::string_view(body.data(), body.size()));
+                           });
+        }
+
+        FormatLog(Stream *stream, std::atomic<uint8_t> *gate) : serial(stream), gate(gate)
+        {
+            memset(tagLevels, TAG_LEVEL_INHERIT, sizeof(tagLevels));
+            updateEnabledLevel();
         }
 
     public:
-        FormatLog(Stream *stream = &Serial) : serial(stream) {}
+        FormatLog(Stream *stream = &Serial) : FormatLog(stream, nullptr) {}
 
 #if LOG_FILE_ENABLE
         ~FormatLog()
         {
+#if LOG_ASYNC_ENABLE
+            asyncWriter.stop();
+#elif LOG_POLL_ENABLE
+            waitForQueued();
+#endif
             fileStorage.reset();
+            clearOutputs();
         }
 #endif
 
         static FormatLog &instance()
         {
-            static FormatLog logger(&LOG_STREAM);
+            static FormatLog logger(&LOG_STREAM, LogGate<>::levels);
             return logger;
         }
 
         void setSerial(Stream &stream)
         {
+            waitForQueued();
+            OutputLock lock(outputMutex);
             serial = &stream;
+#if LOG_DEDUP_ENABLE
+            serialRepeat = RepeatState();
+#endif
+            updateEnabledLevel();
+        }
+
+        /**
+         * Adds another Stream output (e.g. Serial1) with its own level. Messages are formatted once
+         * and written to every output that accepts them. Adding the same stream again updates its level.
+         *
+         * @return false if LOG_MAX_OUTPUTS outputs have already been added
+         */
+        bool addStream(Stream &stream, LogLevel level)
+        {
+            LogOutput output;
+            output.stream = &stream;
+            output.level = level;
+            return addOutput(output);
+        }
+
+#if LOG_FILE_ENABLE
+        /**
+         * Adds another file sink with its own level, alongside the one set with setFileStorage().
+         * Adding the same sink again updates its level.
+         *
+         * @return false if LOG_MAX_OUTPUTS outputs have already been added
+         */
+        bool addFileStorage(std::shared_ptr<IFileSink> sink, LogLevel level)
+        {
+            if (!sink)
+                return false;
+            LogOutput output;
+            output.fileSink = sink;
+            output.level = level;
+            return addOutput(output);
+        }
+#endif
+
+        /**
+         * Removes every output added with addStream() / addFileStorage().
+         */
+        void clearOutputs()
+        {
+            waitForQueued();
+            OutputLock lock(outputMutex);
+            for (size_t i = 0; i < outputCount; ++i)
+                outputs[i] = LogOutput();
+            outputCount = 0;
+            updateEnabledLevel();
         }
 
 #if LOG_FILE_ENABLE
         void setFileStorage(std::shared_ptr<IFileSink> sink)
         {
+            waitForQueued();
+            OutputLock lock(outputMutex);
             fileStorage.reset();
             fileStorage = sink;
+#if LOG_DEDUP_ENABLE
+            fileRepeat = RepeatState();
+#endif
+            updateEnabledLevel();
         }
 
         void setFileLogLevel(LogLevel level)
         {
+            OutputLock lock(outputMutex);
             fileLogLevel = level;
+            updateEnabledLevel();
         }
 
         LogLevel getFileLogLevel()
@@ -112,20 +1357,72 @@ namespace fmtlog
             return fileLogLevel;
         }
 
+        /**
+         * Sets when the file storage flushes (see FlushPolicy). Applies to the current sink, so call it
+         * after setFileStorage().
+         */
+        void setFileFlushPolicy(const FlushPolicy &policy)
+        {
+            waitForQueued();
+            OutputLock lock(outputMutex);
+            if (fileStorage)
+                fileStorage->setFlushPolicy(policy);
+        }
+
+        /**
+         * @return Number of times the file storage flushed its file
+         */
+        uint32_t getFileFlushCount()
+        {
+            OutputLock lock(outputMutex);
+            return fileStorage ? fileStorage->getFlushCount() : 0;
+        }
+
+        /**
+         * @return Number of times a caller waited for the file storage to write out a buffer (LOG_FILE_BACKGROUND)
+         */
+        uint32_t getFileBlockedCount()
+        {
+            OutputLock lock(outputMutex);
+            return fileStorage ? fileStorage->getBlockedCount() : 0;
+        }
+
         void flushFile()
         {
+            waitForQueued();
+            OutputLock lock(outputMutex);
+#if LOG_DEDUP_ENABLE
+            writeRepeats();
+#endif
+#if LOG_POLL_ENABLE
+            writePolled(true);
+#endif
             if (fileStorage)
                 fileStorage->flush();
+            for (size_t i = 0; i < outputCount; ++i)
+            {
+                if (outputs[i].fileSink)
+                    outputs[i].fileSink->flush();
+            }
         }
 
         void closeFile()
         {
+            waitForQueued();
+            OutputLock lock(outputMutex);
             if (fileStorage)
                 fileStorage->close();
+            for (size_t i = 0; i < outputCount; ++i)
+            {
+                if (outputs[i].fileSink)
+                    outputs[i].fileSink->close();
+            }
         }
 
         void setFilePath(const char *path)
         {
+            waitForQueued();
+            OutputLock lock(outputMutex);
             if (fileStorage)
                 fileStorage->setFilePath(path);
         }
@@ -145,7 +1442,108 @@ namespace fmtlog
 
         void setLogLevel(LogLevel level)
         {
+            OutputLock lock(outputMutex);
             logLevel = level;
+            updateEnabledLevel();
+        }
+
+        /**
+         * @return true if at least one output (serial, file storage or an added output) accepts the level
+         */
+        bool isLevelEnabled(LogLevel level) const
+        {
+            return isLevelEnabled(LogTag::UNTAGGED, level);
+        }
+
+        /**
+         * @return true if at least one output accepts the level for messages from the tag
+         */
+        bool isLevelEnabled(LogTag tag, LogLevel level) const
+        {
+            return static_cast<uint8_t>(level) <= enabledLevels[static_cast<size_t>(tag)].load(std::memory_order_relaxed);
+        }
+
+        /**
+         * Sets the level of one tag. Messages from that tag are filtered by it on every output,
+         * in place of the output's own level, e.g. to debug a single module.
+         */
+        void setTagLevel(LogTag tag, LogLevel level)
+        {
+            OutputLock lock(outputMutex);
+            tagLevels[static_cast<size_t>(tag)] = static_cast<uint8_t>(level);
+            updateEnabledLevel();
+        }
+
+        /**
+         * @return false if no tag has that name
+         */
+        bool setTagLevel(const char *name, LogLevel level)
+        {
+            LogTag tag;
+            if (!findLogTag(name, tag))
+                return false;
+            setTagLevel(tag, level);
+            return true;
+        }
+
+        /**
+         * @return Level set for the tag, or the serial level if the tag uses each output's level
+         */
+        LogLevel getTagLevel(LogTag tag) const
+        {
+            return outputLevel(tag, logLevel);
+        }
+
+        /**
+         * Goes back to filtering the tag's messages by each output's own level.
+         */
+        void resetTagLevel(LogTag tag)
+        {
+            OutputLock lock(outputMutex);
+            tagLevels[static_cast<size_t>(tag)] = TAG_LEVEL_INHERIT;
+            updateEnabledLevel();
+        }
+
+        void setAllTagLevels(LogLevel level)
+        {
+            OutputLock lock(outputMutex);
+            memset(tagLevels, static_cast<uint8_t>(level), sizeof(tagLevels));
+            updateEnabledLevel();
+        }
+
+        void resetTagLevels()
+        {
+            OutputLock lock(outputMutex);
+            memset(tagLevels, TAG_LEVEL_INHERIT, sizeof(tagLevels));
+            updateEnabledLevel();
+        }
+
+        /**
+         * Sets several tag levels at once from text such as "wifi=debug,sensor=warn".
+         * "*" sets every tag, and "name=inherit" resets a tag. Entries are applied in order.
+         *
+         * @return false if an entry names an unknown tag or level (the other entries are still applied)
+         */
+        bool setTagLevels(const char *spec)
+        {
+            OutputLock lock(outputMutex);
+            bool valid = true;
+            while (*spec)
+            {
+                size_t length = strcspn(spec, ", ;");
+                const char *separator = static_cast<const char *>(memchr(spec, '=', length));
+                if (separator == nullptr)
+                    separator = static_cast<const char *>(memchr(spec, ':', length));
+
+                if (length > 0)
+                    valid = applyTagLevel(spec, length, separator) && valid;
+
+                spec += length;
+                if (*spec)
+                    ++spec;
+            }
+            updateEnabledLevel();
+            return valid;
         }
 
         void setPanicHandler(PanicHandler handler)
@@ -153,38 +1551,220 @@ namespace fmtlog
             panicHandler = handler;
         }
 
+        /**
+         * Flushes the serial stream and any added streams. In async mode, first waits until every
+         * queued message has been written. With LOG_DEDUP_ENABLE, held back repeats are summarized first.
+         */
         void flush()
         {
+#if LOG_ISR_ENABLE
+            if (gate)
+                drainIsr();
+#endif
+            waitForQueued();
+            OutputLock lock(outputMutex);
+#if LOG_DEDUP_ENABLE
+            writeRepeats();
+#endif
+#if LOG_POLL_ENABLE
+            writePolled(true);
+#endif
             serial->flush();
+            for (size_t i = 0; i < outputCount; ++i)
+            {
+                if (outputs[i].stream)
+                    outputs[i].stream->flush();
+            }
+        }
+
+#if LOG_POLL_ENABLE
+        /**
+         * Writes queued output without blocking (LOG_POLL_ENABLE). Call it from loop(): each Stream gets
+         * as many bytes as its availableForWrite() reports, file sinks get queued lines until
+         * LOG_POLL_FILE_BUDGET_MS has passed. The rest waits for the next call, in order.
+         */
+        void poll()
+        {
+#if LOG_ISR_ENABLE
+            if (gate)
+                drainIsr();
+#endif
+            OutputLock lock(outputMutex);
+            writePolled(false);
+        }
+
+        /**
+         * @return Bytes of output queued and not written yet
+         */
+        size_t getPollPending()
+        {
+            OutputLock lock(outputMutex);
+            return pollBuffer.pending();
+        }
+
+        /**
+         * @return Number of lines dropped because the poll buffer was full
+         */
+        uint32_t getPollDroppedCount()
+        {
+            OutputLock lock(outputMutex);
+            return pollBuffer.droppedCount();
+        }
+#endif
+
+#if LOG_STREAM_FULL_POLICY != LOG_STREAM_FULL_BLOCK
+        /**
+         * @return Number of lines dropped because a Stream had no room for them (LOG_STREAM_FULL_POLICY)
+         */
+        uint32_t getStreamDroppedCount()
+        {
+            OutputLock lock(outputMutex);
+            return streamDropped;
+        }
+
+        /**
+         * @return Number of lines cut short with LOG_STREAM_TRUNCATED_MARKER (LOG_STREAM_FULL_TRUNCATE)
+         */
+        uint32_t getStreamTruncatedCount()
+        {
+            OutputLock lock(outputMutex);
+            return streamTruncated;
+        }
+
+        /**
+         * @return Number of lines at LOG_STREAM_KEEP_LEVEL or above that waited for a full Stream (LOG_STREAM_FULL_DROP_LOW)
+         */
+        uint32_t getStreamBlockedCount()
+        {
+            OutputLock lock(outputMutex);
+            return streamBlocked;
+        }
+#endif
+
+#if LOG_STACK_LIGHT_ENABLE
+        /**
+         * @return Number of calls that formatted on their own stack because all shared buffers were taken
+         */
+        uint32_t getStackFallbackCount() const
+        {
+            return stackFallbacks.load(std::memory_order_relaxed);
+        }
+#endif
+
+#if LOG_POOL_ENABLE
+        /**
+         * @return Usage of the line buffer pool since boot (LOG_POOL_ENABLE)
+         */
+        PoolStats getPoolStats() const
+        {
+            return LogPool<>::pool.stats();
         }
+#endif
+
+#if LOG_ISR_ENABLE
+        /**
+         * Formats the records written by LOG_ISR_* macros, oldest first, and writes them like any other
+         * line. Runs on its own before the next log call or flush of the global logger; call it from the
+         * loop if nothing else logs. Only one task drains at a time, concurrent callers return at once.
+         */
+        void drainIsr()
+        {
+            if (isrDraining.exchange(true, std::memory_order_acquire))
+                return;
+
+            while (IsrQueue<>::Ring *ring = oldestIsrRing())
+            {
+                IsrRecord record = *ring->front();
+                ring->pop(); // Free the slot before formatting, the handler may fire again meanwhile
+
+                withBodyBuffer([&](LineBuffer &body)
+                               {
+                                   record.formatter(record.args, record.site->format, fmt::appender(body));
+                                   writeLineAt(record.site->loc, record.site->level, isrTimestamp(record.time), fmt::string_view(body.data(), body.size()));
+                               });
+            }
+
+            if (const IsrSite *site = IsrQueue<>::invalidSite.exchange(nullptr, std::memory_order_relaxed))
+            {
+                withBodyBuffer([&](LineBuffer &body)
+                               {
+                                   fmt::format_to(fmt::appender(body), "LOG_ISR_CONTEXT() must be below LOG_ISR_CONTEXTS ({}), message dropped", LOG_ISR_CONTEXTS);
+                                   writeLine(site->loc, LogLevel::ERROR, fmt::string_view(body.data(), body.size()));
+                               });
+            }
+
+            isrDraining.store(false, std::memory_order_release);
+        }
+
+        /**
+         * @return Number of LOG_ISR_* messages dropped because the ring of their context was full
+         */
+        uint32_t getIsrDroppedCount() const
+        {
+            return IsrQueue<>::dropped.load(std::memory_order_relaxed);
+        }
+#endif
+
+#if LOG_ASYNC_ENABLE
+        /**
+         * Switches between queued (true) and direct (false) output at runtime.
+         * Pending messages are written before switching to direct output.
+         */
+        void setAsync(bool enable)
+        {
+            if (!enable)
+                asyncWriter.flush();
+            asyncEnabled = enable;
+        }
+
+        bool isAsync() const
+        {
+            return asyncEnabled;
+        }
+
+        /**
+         * @return Number of messages dropped because the async queue was full (LOG_ASYNC_FULL_DROP)
+         */
+        uint32_t getAsyncDroppedCount() const
+        {
+            return asyncWriter.droppedCount();
+        }
+
+        /**
+         * @return Number of messages truncated to LOG_ASYNC_RECORD_SIZE
+         */
+        uint32_t getAsyncTruncatedCount() const
+        {
+            return asyncWriter.truncatedCount();
+        }
+#endif
 
         template <typename T>
         void print(const T &message)
         {
+            waitForQueued();
+            OutputLock lock(outputMutex);
             serial->print(message);
         }
 
         template <typename... Args>
         void print(fmt::format_string<Args...> format, Args &&...args)
         {
-            fmt::basic_memory_buffer<char, LOG_STATIC_BUFFER_SIZE> buffer;
-            fmt::vformat_to(fmt::appender(buffer), format, fmt::make_format_args(args...));
-            serial->write(reinterpret_cast<const uint8_t *>(buffer.data()), buffer.size());
+            vprint(format, fmt::make_format_args(args...), false);
         }
 
         template <typename T>
         void println(const T &message)
         {
+            waitForQueued();
+            OutputLock lock(outputMutex);
             serial->println(message);
         }
 
         template <typename... Args>
         void println(fmt::format_string<Args...> format, Args &&...args)
         {
-            fmt::basic_memory_buffer<char, LOG_STATIC_BUFFER_SIZE> buffer;
-            fmt::vformat_to(fmt::appender(buffer), format, fmt::make_format_args(args...));
-            buffer.append(fmt::string_view(LOG_EOL));
-            serial->write(reinterpret_cast<const uint8_t *>(buffer.data()), buffer.size());
+            vprint(format, fmt::make_format_args(args...), true);
         }
 
 #if LOG_FILE_ENABLE
@@ -197,11 +1777,7 @@ namespace fmtlog
         template <typename... Args>
         void printFile(fmt::format_string<Args...> format, Args &&...args)
         {
-            if (!fileStorage)
-                return;
-            fmt::basic_memory_buffer<char, LOG_STATIC_BUFFER_SIZE> buffer;
-            fmt::vformat_to(fmt::appender(buffer), format, fmt::make_format_args(args...));
-            fileStorage->write(buffer.data(), buffer.size());
+            vprintFile(format, fmt::make_format_args(args...), false);
         }
 
         template <typename T>
@@ -213,43 +1789,45 @@ namespace fmtlog
         template <typename... Args>
         void printlnFile(fmt::format_string<Args...> format, Args &&...args)
         {
-            if (!fileStorage)
-                return;
-            fmt::basic_memory_buffer<char, LOG_STATIC_BUFFER_SIZE> buffer;
-            fmt::vformat_to(fmt::appender(buffer), format, fmt::make_format_args(args...));
-            buffer.append(fmt::string_view(LOG_EOL));
-            fileStorage->write(buffer.data(), buffer.size());
+            vprintFile(format, fmt::make_format_args(args...), true);
         }
 #endif
 
-        void checkedLog(const char *expr, const char *message = "")
+        // Failure paths are cold: kept out of line and away from the code of the loops that call them
+        __attribute__((cold, noinline)) void checkedLog(const char *expr, const char *message = "")
         {
-            fmt::basic_memory_buffer<char, LOG_STATIC_BUFFER_SIZE> buffer;
+            LineBuffer buffer;
             APPEND_COLOR(buffer, static_cast<LogLevel>(LOG_LEVEL_WARN));
             fmt::format_to(fmt::appender(buffer), LOG_CHECK_FORMAT, expr, message);
             APPEND_RESET_COLOR(buffer);
             buffer.append(fmt::string_view(LOG_EOL));
-            serial->write(reinterpret_cast<const uint8_t *>(buffer.data()), buffer.size());
+            writeSerial(buffer.data(), buffer.size(), LogLevel::WARN);
         }
 
-        void assertionLog(const char *file, int line, const char *func, const char *expr, const char *message = "")
+        __attribute__((cold, noinline)) void assertionLog(const char *file, int line, const char *func, const char *expr, const char *message = "")
         {
-            fmt::basic_memory_buffer<char, LOG_STATIC_BUFFER_SIZE> buffer;
+            LineBuffer buffer;
             APPEND_COLOR(buffer, static_cast<LogLevel>(LOG_LEVEL_ERROR));
             fmt::format_to(fmt::appender(buffer), LOG_PANIC_FORMAT, file, line, func, expr, message);
             APPEND_RESET_COLOR(buffer);
             buffer.append(fmt::string_view(LOG_EOL));
-            serial->write(reinterpret_cast<const uint8_t *>(buffer.data()), buffer.size());
+#if LOG_STREAM_FULL_POLICY != LOG_STREAM_FULL_BLOCK
+            panicking = true;
+#endif
+            writeSerial(buffer.data(), buffer.size(), LogLevel::ERROR);
 
             flush();
 #if LOG_FILE_ENABLE
             flushFile();
+#endif
+#if LOG_STREAM_FULL_POLICY != LOG_STREAM_FULL_BLOCK
+            panicking = false;
 #endif
         }
 
         void assertion(bool condition, const char *file, int line, const char *func, const char *expr, const char *message = "")
         {
-            if (condition)
+            if (__builtin_expect(condition, 1))
                 return;
 
             assertionLog(file, line, func, expr, message);
@@ -258,6 +1836,54 @@ namespace fmtlog
                 panicHandler();
         }
 
+        /**
+         * Logs a failed assertion, then calls the panic handler. ASSERT() calls it only once the condition
+         * failed, so a passing ASSERT() doesn't even look up the instance.
+         */
+        static __attribute__((cold, noinline)) void assertionFailed(const char *file, int line, const char *func, const char *expr, const char *message = "")
+        {
+            instance().assertion(false, file, line, func, expr, message);
+        }
+
+        /**
+         * Logs a failed CHECK_OR_RETURN() / CHECK_OR_RETURN_VALUE().
+         */
+        static __attribute__((cold, noinline)) void checkFailed(const char *expr, const char *message = "")
+        {
+            instance().checkedLog(expr, message);
+        }
+
+        /**
+         * Logs a message whose arguments are already packed with fmt::make_format_args(), e.g. from a
+         * wrapper of your own taking fmt::format_args. Every LOG_* call site ends up here, so the code
+         * behind it is in the firmware once, whatever the argument types. Cold, so the calls to it are
+         * laid out off the path of the code around them.
+         */
+        __attribute__((cold, noinline)) void vlog(const SourceLocation &loc, LogLevel level, fmt::string_view format, fmt::format_args args)
+        {
+            if (acceptLine(loc, level))
+                formatLine(loc, level, format, args);
+        }
+
+        /**
+         * Logs from a throttled call site, appending LOG_SUPPRESSED_FORMAT when calls were suppressed
+         * since its last message. Used by LOG_EVERY_N(), LOG_EVERY_MS(), LOG_ONCE() and LOG_RATE_LIMIT().
+         */
+        template <typename... Args>
+        void throttled(SourceLocation loc, LogLevel level, uint32_t suppressed, fmt::format_string<Args...> format, Args &&...args)
+        {
+            if (suppressed == 0)
+                log(loc, level, format, std::forward<Args>(args)...);
+            else
+                vthrottled(loc, level, suppressed, format, fmt::make_format_args(args...));
+        }
+
+        template <typename T>
+        void throttled(SourceLocation loc, LogLevel level, uint32_t suppressed, const T &value)
+        {
+            throttled(loc, level, suppressed, "{}", value);
+        }
+
         template <typename... Args>
         void trace(SourceLocation loc, fmt::format_string<Args...> format, Args &&...args)
         {
@@ -317,44 +1943,215 @@ namespace fmtlog
         {
             error(loc, "{}", value);
         }
+
+#if LOG_ASYNC_DEFERRED
+        // Only the format string pointer is queued, so fmt::runtime() strings are formatted at the call site
+        template <typename... Args>
+        void throttled(SourceLocation loc, LogLevel level, uint32_t suppressed, RuntimeFormat format, Args &&...args)
+        {
+            if (suppressed == 0)
+                vlog(loc, level, format.str, fmt::make_format_args(args...));
+            else
+                vthrottled(loc, level, suppressed, format.str, fmt::make_format_args(args...));
+        }
+
+        template <typename... Args>
+        void trace(SourceLocation loc, RuntimeFormat format, Args &&...args)
+        {
+            vlog(loc, LogLevel::TRACE, format.str, fmt::make_format_args(args...));
+        }
+
+        template <typename... Args>
+        void info(SourceLocation loc, RuntimeFormat format, Args &&...args)
+        {
+            vlog(loc, LogLevel::INFO, format.str, fmt::make_format_args(args...));
+        }
+
+        template <typename... Args>
+        void debug(SourceLocation loc, RuntimeFormat format, Args &&...args)
+        {
+            vlog(loc, LogLevel::DEBUG, format.str, fmt::make_format_args(args...));
+        }
+
+        template <typename... Args>
+        void warn(SourceLocation loc, RuntimeFormat format, Args &&...args)
+        {
+            vlog(loc, LogLevel::WARN, format.str, fmt::make_format_args(args...));
+        }
+
+        template <typename... Args>
+        void error(SourceLocation loc, RuntimeFormat format, Args &&...args)
+        {
+            vlog(loc, LogLevel::ERROR, format.str, fmt::make_format_args(args...));
+        }
+#endif
     };
 
+#undef _LOG_LOCKED_BUFFER
+
 } // namespace fmtlog
 
 /**------------------------------------------------------------------------------
  * Logger Log Macros
  *-------------------------------------------------------------------------------------*/
 
+/**
+ * @brief Source location of the calling line. The filename preamble (basename without extension,
+ * plus line and function depending on filenameFormat) is rendered once, on the first call, into a
+ * static buffer whose size is computed at compile time. Later calls only pass a pointer to it.
+ *
+ * @param filenameFormat LOG_FILENAME_* option to render the fragment for
+ */
+#define LOG_SOURCE_LOCATION(filenameFormat)                                                                                              \
+    (__extension__({                                                                                                                     \
+        static char _log_fragment_[fmtlog::sourceFragmentSize(__FILE__, __LINE__, sizeof(__FUNCTION__),                                  \
+                                                              static_cast<fmtlog::LogFilename>(filenameFormat))];                        \
+        static const char *const _log_rendered_ = fmtlog::renderSourceFragment(                                                          \
+            _log_fragment_, sizeof(_log_fragment_), __FILE__, __LINE__, __FUNCTION__, static_cast<fmtlog::LogFilename>(filenameFormat)); \
+        fmtlog::SourceLocation(__FILE__, __LINE__, __FUNCTION__, _log_rendered_, fmtlog::LogTag::LOG_TAG);                              \
+    }))
+
+#if LOG_FILE_ENABLE && LOG_FILE_LEVEL > LOG_LEVEL
+#define _LOG_COMPILED_LEVEL LOG_FILE_LEVEL
+#else
+#define _LOG_COMPILED_LEVEL LOG_LEVEL
+#endif
+
+// Drops calls above the compiled level or the LOG_TAG_LEVEL_LIST entry of the LOG_TAG at compile time, then
+// checks the runtime level of the tag before the call's arguments (or its source location) are evaluated
+#define _LOG_IF_ENABLED(level, call)                                                                            \
+    (static_cast<int>(level) <= _LOG_COMPILED_LEVEL &&                                                          \
+             static_cast<int>(level) <= fmtlog::LogTagLimit<fmtlog::LogTag::LOG_TAG>::value &&                  \
+             fmtlog::LogGate<>::enabled(fmtlog::LogTag::LOG_TAG, level)                                         \
+         ? call                                                                                                 \
+         : (void)0)
+
+// Branch hints for checks that pass on every call but a rare failure
+#define _LOG_LIKELY(condition) __builtin_expect(!!(condition), 1)
+#define _LOG_UNLIKELY(condition) __builtin_expect(!!(condition), 0)
+
+#if LOG_SOURCE_FRAGMENT
+#define _LOG_LOCATION() LOG_SOURCE_LOCATION(LOG_FILENAME)
+#else
+#define _LOG_LOCATION() fmtlog::SourceLocation(__FILE__, __LINE__, __FUNCTION__, nullptr, fmtlog::LogTag::LOG_TAG)
+#endif
+
 #if LOG_LEVEL >= LOG_LEVEL_TRACE || (LOG_FILE_ENABLE && LOG_FILE_LEVEL >= LOG_LEVEL_TRACE)
-#define LOG_TRACE(format, ...) fmtlog::FormatLog::instance().trace(fmtlog::SourceLocation(__FILE__, __LINE__, __FUNCTION__), format, ##__VA_ARGS__)
+#define LOG_TRACE(format, ...) _LOG_IF_ENABLED(fmtlog::LogLevel::TRACE, fmtlog::FormatLog::instance().trace(_LOG_LOCATION(), format, ##__VA_ARGS__))
 #else
 #define LOG_TRACE(format, ...) ((void)0)
 #endif
 
 #if LOG_LEVEL >= LOG_LEVEL_DEBUG || (LOG_FILE_ENABLE && LOG_FILE_LEVEL >= LOG_LEVEL_DEBUG)
-#define LOG_DEBUG(format, ...) fmtlog::FormatLog::instance().debug(fmtlog::SourceLocation(__FILE__, __LINE__, __FUNCTION__), format, ##__VA_ARGS__)
+#define LOG_DEBUG(format, ...) _LOG_IF_ENABLED(fmtlog::LogLevel::DEBUG, fmtlog::FormatLog::instance().debug(_LOG_LOCATION(), format, ##__VA_ARGS__))
 #else
 #define LOG_DEBUG(format, ...) ((void)0)
 #endif
 
 #if LOG_LEVEL >= LOG_LEVEL_INFO || (LOG_FILE_ENABLE && LOG_FILE_LEVEL >= LOG_LEVEL_INFO)
-#define LOG_INFO(format, ...) fmtlog::FormatLog::instance().info(fmtlog::SourceLocation(__FILE__, __LINE__, __FUNCTION__), format, ##__VA_ARGS__)
+#define LOG_INFO(format, ...) _LOG_IF_ENABLED(fmtlog::LogLevel::INFO, fmtlog::FormatLog::instance().info(_LOG_LOCATION(), format, ##__VA_ARGS__))
 #else
 #define LOG_INFO(format, ...) ((void)0)
 #endif
 
 #if LOG_LEVEL >= LOG_LEVEL_WARN || (LOG_FILE_ENABLE && LOG_FILE_LEVEL >= LOG_LEVEL_WARN)
-#define LOG_WARN(format, ...) fmtlog::FormatLog::instance().warn(fmtlog::SourceLocation(__FILE__, __LINE__, __FUNCTION__), format, ##__VA_ARGS__)
+#define LOG_WARN(format, ...) _LOG_IF_ENABLED(fmtlog::LogLevel::WARN, fmtlog::FormatLog::instance().warn(_LOG_LOCATION(), format, ##__VA_ARGS__))
 #else
 #define LOG_WARN(format, ...) ((void)0)
 #endif
 
 #if LOG_LEVEL >= LOG_LEVEL_ERROR || (LOG_FILE_ENABLE && LOG_FILE_LEVEL >= LOG_LEVEL_ERROR)
-#define LOG_ERROR(format, ...) fmtlog::FormatLog::instance().error(fmtlog::SourceLocation(__FILE__, __LINE__, __FUNCTION__), format, ##__VA_ARGS__)
+#define LOG_ERROR(format, ...) _LOG_IF_ENABLED(fmtlog::LogLevel::ERROR, fmtlog::FormatLog::instance().error(_LOG_LOCATION(), format, ##__VA_ARGS__))
 #else
 #define LOG_ERROR(format, ...) ((void)0)
 #endif
 
+/**--------------------------------------------------------------------------------------
+ * Throttled Log Macros
+ *
+ * Each call site keeps its own throttle state. The throttle is checked after the level and
+ * before any argument is evaluated. When calls were suppressed, the next message that gets
+ * through ends with LOG_SUPPRESSED_FORMAT.
+ *
+ * level is a level name: TRACE, DEBUG, INFO, WARN or ERROR.
+ *-------------------------------------------------------------------------------------*/
+
+#define _LOG_THROTTLED(level, Throttle, allow, format, ...)                                                           \
+    _LOG_IF_ENABLED(fmtlog::LogLevel::level, __extension__({                                                          \
+        static Throttle _log_throttle_;                                                                               \
+        uint32_t _log_suppressed_ = 0;                                                                                \
+        if (allow)                                                                                                    \
+            fmtlog::FormatLog::instance().throttled(_LOG_LOCATION(), fmtlog::LogLevel::level, _log_suppressed_,       \
+                                                    format, ##__VA_ARGS__);                                           \
+    }))
+
+/**
+ * @brief Logs the first call and then every nth call of this call site
+ *
+ * @param level Level name (e.g. WARN)
+ * @param n Calls per logged message
+ */
+#define LOG_EVERY_N(level, n, format, ...) _LOG_THROTTLED(level, fmtlog::EveryN, _log_throttle_.allow(n, _log_suppressed_), format, ##__VA_ARGS__)
+/**
+ * @brief Logs at most one call of this call site per interval
+ *
+ * @param level Level name (e.g. WARN)
+ * @param intervalMs Minimum time between logged messages
+ */
+#define LOG_EVERY_MS(level, intervalMs, format, ...) _LOG_THROTTLED(level, fmtlog::EveryMs, _log_throttle_.allow(intervalMs, _log_suppressed_), format, ##__VA_ARGS__)
+/**
+ * @brief Logs only the first call of this call site
+ *
+ * @param level Level name (e.g. WARN)
+ */
+#define LOG_ONCE(level, format, ...) _LOG_THROTTLED(level, fmtlog::Once, _log_throttle_.allow(_log_suppressed_), format, ##__VA_ARGS__)
+/**
+ * @brief Token bucket: logs bursts of up to capacity calls, then one call per refillMs
+ *
+ * @param level Level name (e.g. WARN)
+ * @param capacity Largest burst logged at once
+ * @param refillMs Time to earn back one message
+ */
+#define LOG_RATE_LIMIT(level, capacity, refillMs, format, ...) _LOG_THROTTLED(level, fmtlog::TokenBucket, _log_throttle_.allow(capacity, refillMs, _log_suppressed_), format, ##__VA_ARGS__)
+
+/**--------------------------------------------------------------------------------------
+ * Interrupt Log Macros
+ *
+ * Safe to call from an interrupt handler: never blocks, never allocates, never formats.
+ * The call stores the call site, the clock and up to LOG_ISR_MAX_ARGS integer, float,
+ * enum or bool arguments into the ring of its context (a fixed number of stores, and at
+ * most LOG_ISR_CLAIM_ATTEMPTS compare-and-swaps against other writers of that ring).
+ * Task-level code formats the records later with the normal pipeline: before the next
+ * log call or flush, or when LOG_ISR_DRAIN() is called. A full ring drops the message.
+ *-------------------------------------------------------------------------------------*/
+
+#if LOG_ISR_ENABLE
+#define _LOG_ISR(level, format, ...)                                                                              \
+    _LOG_IF_ENABLED(fmtlog::LogLevel::level, __extension__({                                                      \
+        fmtlog::checkIsrFormat(format, ##__VA_ARGS__);                                                            \
+        static const fmtlog::IsrSite _log_isr_site_ = {                                                           \
+            fmtlog::SourceLocation(__FILE__, __LINE__, __FUNCTION__, nullptr, fmtlog::LogTag::LOG_TAG),           \
+            fmtlog::LogLevel::level, format};                                                                     \
+        fmtlog::IsrQueue<>::write(_log_isr_site_, LOG_ISR_CONTEXT(), ##__VA_ARGS__);                              \
+    }))
+
+#define LOG_ISR_TRACE(format, ...) _LOG_ISR(TRACE, format, ##__VA_ARGS__)
+#define LOG_ISR_DEBUG(format, ...) _LOG_ISR(DEBUG, format, ##__VA_ARGS__)
+#define LOG_ISR_INFO(format, ...) _LOG_ISR(INFO, format, ##__VA_ARGS__)
+#define LOG_ISR_WARN(format, ...) _LOG_ISR(WARN, format, ##__VA_ARGS__)
+#define LOG_ISR_ERROR(format, ...) _LOG_ISR(ERROR, format, ##__VA_ARGS__)
+#define LOG_ISR_DRAIN() fmtlog::FormatLog::instance().drainIsr()
+#define LOG_ISR_DROPPED_COUNT() fmtlog::FormatLog::instance().getIsrDroppedCount()
+#else
+#define LOG_ISR_TRACE(format, ...) ((void)0)
+#define LOG_ISR_DEBUG(format, ...) ((void)0)
+#define LOG_ISR_INFO(format, ...) ((void)0)
+#define LOG_ISR_WARN(format, ...) ((void)0)
+#define LOG_ISR_ERROR(format, ...) ((void)0)
+#define LOG_ISR_DRAIN() ((void)0)
+#define LOG_ISR_DROPPED_COUNT() 0
+#endif
+
 /**--------------------------------------------------------------------------------------
  * Logger Extra Macros
  *-------------------------------------------------------------------------------------*/
@@ -365,12 +2162,52 @@ namespace fmtlog
 #define LOG_FLUSH() fmtlog::FormatLog::instance().flush()
 #define LOG_SET_LOG_LEVEL(level) fmtlog::FormatLog::instance().setLogLevel(level)
 #define LOG_GET_LOG_LEVEL() fmtlog::FormatLog::instance().getLogLevel()
+/**
+ * @brief Adds another Stream output with its own level (up to LOG_MAX_OUTPUTS)
+ *
+ * @param stream Stream to write to (e.g. Serial1)
+ * @param level LogLevel for this output (e.g. fmtlog::LogLevel::WARN)
+ */
+#define LOG_ADD_STREAM(stream, level) fmtlog::FormatLog::instance().addStream(stream, level)
+#define LOG_CLEAR_OUTPUTS() fmtlog::FormatLog::instance().clearOutputs()
+/**
+ * @brief Sets the runtime level of one tag from LOG_TAG_LIST, overriding the output levels for it
+ *
+ * @param tag Tag name as listed in LOG_TAG_LIST (e.g. wifi)
+ * @param level LogLevel for this tag (e.g. fmtlog::LogLevel::DEBUG)
+ */
+#define LOG_SET_TAG_LEVEL(tag, level) fmtlog::FormatLog::instance().setTagLevel(fmtlog::LogTag::tag, level)
+#define LOG_GET_TAG_LEVEL(tag) fmtlog::FormatLog::instance().getTagLevel(fmtlog::LogTag::tag)
+/**
+ * @brief Sets several tag levels from text, e.g. "wifi=debug,sensor=warn" or "*=error"
+ */
+#define LOG_SET_TAG_LEVELS(spec) fmtlog::FormatLog::instance().setTagLevels(spec)
+#define LOG_RESET_TAG_LEVELS() fmtlog::FormatLog::instance().resetTagLevels()
 #else
 #define LOG_BEGIN(baud) ((void)0)
 #define LOG_END() ((void)0)
 #define LOG_FLUSH() ((void)0)
 #define LOG_SET_LOG_LEVEL(level) ((void)0)
 #define LOG_GET_LOG_LEVEL() fmtlog::LogLevel::DISABLE
+#define LOG_ADD_STREAM(stream, level) false
+#define LOG_CLEAR_OUTPUTS() ((void)0)
+#define LOG_SET_TAG_LEVEL(tag, level) ((void)0)
+#define LOG_GET_TAG_LEVEL(tag) fmtlog::LogLevel::DISABLE
+#define LOG_SET_TAG_LEVELS(spec) false
+#define LOG_RESET_TAG_LEVELS() ((void)0)
+#endif
+
+#if LOG_POLL_ENABLE
+/**
+ * @brief Writes queued output without blocking, call it from loop() (LOG_POLL_ENABLE)
+ */
+#define LOG_POLL() fmtlog::FormatLog::instance().poll()
+#define LOG_POLL_PENDING() fmtlog::FormatLog::instance().getPollPending()
+#define LOG_POLL_DROPPED_COUNT() fmtlog::FormatLog::instance().getPollDroppedCount()
+#else
+#define LOG_POLL() ((void)0)
+#define LOG_POLL_PENDING() 0
+#define LOG_POLL_DROPPED_COUNT() 0
 #endif
 
 #if LOG_PRINT_ENABLE
@@ -381,6 +2218,59 @@ namespace fmtlog
 #define LOG_PRINTLN(format, ...) ((void)0)
 #endif
 
+#if LOG_ASYNC_ENABLE
+/**
+ * @param enable true to queue messages for the drain task, false to write them directly
+ */
+#define LOG_SET_ASYNC(enable) fmtlog::FormatLog::instance().setAsync(enable)
+/**
+ * @return Number of messages dropped because the async queue was full
+ */
+#define LOG_GET_ASYNC_DROPPED() fmtlog::FormatLog::instance().getAsyncDroppedCount()
+#else
+#define LOG_SET_ASYNC(enable) ((void)0)
+#define LOG_GET_ASYNC_DROPPED() 0
+#endif
+
+#if LOG_STREAM_FULL_POLICY != LOG_STREAM_FULL_BLOCK
+/**
+ * @return Lines dropped, truncated, or that had to wait, because a Stream was full (LOG_STREAM_FULL_POLICY)
+ */
+#define LOG_GET_STREAM_DROPPED() fmtlog::FormatLog::instance().getStreamDroppedCount()
+#define LOG_GET_STREAM_TRUNCATED() fmtlog::FormatLog::instance().getStreamTruncatedCount()
+#define LOG_GET_STREAM_BLOCKED() fmtlog::FormatLog::instance().getStreamBlockedCount()
+#else
+#define LOG_GET_STREAM_DROPPED() 0
+#define LOG_GET_STREAM_TRUNCATED() 0
+#define LOG_GET_STREAM_BLOCKED() 0
+#endif
+
+#if LOG_STACK_LIGHT_ENABLE
+/**
+ * @return Calls that formatted on their own stack because all LOG_SHARED_BUFFER_COUNT buffers were taken
+ */
+#define LOG_GET_STACK_FALLBACKS() fmtlog::FormatLog::instance().getStackFallbackCount()
+#else
+#define LOG_GET_STACK_FALLBACKS() 0
+#endif
+
+#if LOG_POOL_ENABLE
+/**
+ * @return fmtlog::PoolStats of the line buffer pool: blocks in use, high-water mark, heap fallbacks and failures
+ */
+#define LOG_GET_POOL_STATS() fmtlog::FormatLog::instance().getPoolStats()
+/**
+ * @return Most pool blocks taken at the same time, lines that needed the heap, and LOG_POOL_EXHAUSTED_HANDLER calls
+ */
+#define LOG_GET_POOL_HIGH_WATER() LOG_GET_POOL_STATS().highWater
+#define LOG_GET_POOL_FALLBACKS() LOG_GET_POOL_STATS().fallbacks
+#define LOG_GET_POOL_FAILURES() LOG_GET_POOL_STATS().failures
+#else
+#define LOG_GET_POOL_HIGH_WATER() 0
+#define LOG_GET_POOL_FALLBACKS() 0
+#define LOG_GET_POOL_FAILURES() 0
+#endif
+
 /**--------------------------------------------------------------------------------------
  * Benchmark
  *-------------------------------------------------------------------------------------*/
@@ -390,7 +2280,8 @@ namespace fmtlog
 #define _LOG_CONCAT_IMPL(x, y) x##y
 #endif
 
-inline void _logBenchmarkCallback(const char *label, uint32_t elapsedMs)
+// Internal linkage: the LOG_TAG its log call is filtered by differs per translation unit
+static inline void _logBenchmarkCallback(const char *label, uint32_t elapsedMs)
 {
     LOG_BENCHMARK_LOG(LOG_BENCHMARK_FORMAT, label, elapsedMs);
 }
@@ -450,7 +2341,10 @@ inline void _logBenchmarkCallback(const char *label, uint32_t elapsedMs)
  * @param condition Condition to assert (true = pass, false = fail)
  * @param message (Optional) message to log on assertion failure
  */
-#define ASSERT(condition, ...) fmtlog::FormatLog::instance().assertion(!!(condition), __FILE__, __LINE__, __FUNCTION__, #condition, ##__VA_ARGS__)
+#define ASSERT(condition, ...)                                                                                           \
+    (_LOG_LIKELY(condition)                                                                                              \
+         ? (void)0                                                                                                       \
+         : fmtlog::FormatLog::assertionFailed(__FILE__, __LINE__, __FUNCTION__, #condition, ##__VA_ARGS__))
 /**
  * @brief Checks a condition and returns from the calling function if it fails.
  *
@@ -459,9 +2353,9 @@ inline void _logBenchmarkCallback(const char *label, uint32_t elapsedMs)
  */
 #define CHECK_OR_RETURN(condition, ...)                                          \
     {                                                                            \
-        if (!(condition))                                                        \
+        if (_LOG_UNLIKELY(!(condition)))                                         \
         {                                                                        \
-            fmtlog::FormatLog::instance().checkedLog(#condition, ##__VA_ARGS__); \
+            fmtlog::FormatLog::checkFailed(#condition, ##__VA_ARGS__);           \
             return;                                                              \
         }                                                                        \
     }
@@ -474,9 +2368,9 @@ inline void _logBenchmarkCallback(const char *label, uint32_t elapsedMs)
  */
 #define CHECK_OR_RETURN_VALUE(condition, value, ...)                             \
     {                                                                            \
-        if (!(condition))                                                        \
+        if (_LOG_UNLIKELY(!(condition)))                                         \
         {                                                                        \
-            fmtlog::FormatLog::instance().checkedLog(#condition, ##__VA_ARGS__); \
+            fmtlog::FormatLog::checkFailed(#condition, ##__VA_ARGS__);           \
             return (value);                                                      \
         }                                                                        \
     }
@@ -484,14 +2378,14 @@ inline void _logBenchmarkCallback(const char *label, uint32_t elapsedMs)
 #define LOG_SET_PANIC_HANDLER(handler) fmtlog::FormatLog::instance().setPanicHandler(handler)
 #else
 #define ASSERT(condition, ...) ((void)0)
-#define CHECK_OR_RETURN(condition, ...) \
-    {                                   \
-        if (!(condition))               \
-            return;                     \
+#define CHECK_OR_RETURN(condition, ...)  \
+    {                                    \
+        if (_LOG_UNLIKELY(!(condition))) \
+            return;                      \
     }
 #define CHECK_OR_RETURN_VALUE(condition, value, ...) \
     {                                                \
-        if (!(condition))                            \
+        if (_LOG_UNLIKELY(!(condition)))             \
             return (value);                          \
     }
 #define LOG_SET_PANIC_HANDLER(handler) ((void)0)
@@ -516,6 +2410,23 @@ inline void _logBenchmarkCallback(const char *label, uint32_t elapsedMs)
  * @return Current LogLevel used for file storage filtering
  */
 #define LOG_GET_FILE_LOG_LEVEL() fmtlog::FormatLog::instance().getFileLogLevel()
+/**
+ * @brief Adds another rotating log file with its own level (up to LOG_MAX_OUTPUTS)
+ *
+ * @param level LogLevel for this file (e.g. fmtlog::LogLevel::ERROR)
+ * @param fs Reference to the file system
+ * @param filePath (Optional) Path to the log file, must differ from the other log files
+ */
+#define LOG_ADD_FILE_STORAGE(level, fs, ...) fmtlog::FormatLog::instance().addFileStorage(fmtlog::createRotatingFileStorage(fs, ##__VA_ARGS__), level)
+/**
+ * @param policy fmtlog::FlushPolicy, e.g. fmtlog::FlushPolicy::everyBytes(4096). Set it after LOG_SET_FILE_STORAGE()
+ */
+#define LOG_SET_FILE_FLUSH_POLICY(policy) fmtlog::FormatLog::instance().setFileFlushPolicy(policy)
+#define LOG_GET_FILE_FLUSH_COUNT() fmtlog::FormatLog::instance().getFileFlushCount()
+/**
+ * With LOG_FILE_BACKGROUND, counts the log calls that waited because every file buffer was still being written.
+ */
+#define LOG_GET_FILE_BLOCKED_COUNT() fmtlog::FormatLog::instance().getFileBlockedCount()
 /**
  * Flushes the file storage write buffer to the log file.
  */
@@ -538,6 +2449,10 @@ inline void _logBenchmarkCallback(const char *label, uint32_t elapsedMs)
 #define LOG_SET_FILE_STORAGE(fs, ...) ((void)0)
 #define LOG_SET_FILE_LOG_LEVEL(level) ((void)0)
 #define LOG_GET_FILE_LOG_LEVEL() fmtlog::LogLevel::DISABLE
+#define LOG_ADD_FILE_STORAGE(level, fs, ...) false
+#define LOG_SET_FILE_FLUSH_POLICY(policy) ((void)0)
+#define LOG_GET_FILE_FLUSH_COUNT() 0
+#define LOG_GET_FILE_BLOCKED_COUNT() 0
 #define LOG_FLUSH_FILE() ((void)0)
 #define LOG_CLOSE_FILE() ((void)0)
 #define LOG_SET_FILE_PATH(path) ((void)0)
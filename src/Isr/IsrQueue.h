@@ -0,0 +1,250 @@
+#pragma once
+
+#include <Arduino.h>
+#include <string.h>
+#include <atomic>
+#include <tuple>
+#include <type_traits>
+#include "Config/Settings.h"
+#include "Async/DeferredArgs.h"
+#include "fmt.h"
+
+namespace fmtlog
+{
+
+    struct IsrSite; // Static per call site data (location, level, format), see LOG_ISR_INFO()
+
+    using IsrFormatter = void (*)(const uint32_t *args, fmt::string_view format, fmt::appender out);
+
+    /**
+     * Compact record written by an interrupt handler. Arguments are stored raw in 32-bit slots
+     * and read back with their original types by the formatter.
+     */
+    struct IsrRecord
+    {
+        const IsrSite *site;
+        IsrFormatter formatter;
+        uint32_t time; // micros() with LOG_TIME_MICROS, millis() otherwise
+        uint32_t args[LOG_ISR_MAX_ARGS > 0 ? LOG_ISR_MAX_ARGS : 1];
+    };
+
+    /**
+     * Bounded lock-free multi-producer / single-consumer ring for interrupt handlers. Producers
+     * claim a slot with a compare-and-swap, so nested interrupt handlers, a task and the handler
+     * preempting it, or two cores can share a ring. A producer never waits for the consumer or
+     * for another producer: it gives up when the ring is full or after Attempts lost claims.
+     * Slots are published one by one, the consumer stops at the oldest slot still being written.
+     * Constant-initialized, unlike the async MpscRing.
+     *
+     * @tparam T Slot type (stored by value, never allocated)
+     * @tparam Capacity Number of slots, must be a power of 2
+     * @tparam Attempts Claims tried before reserve() gives up
+     */
+    template <typename T, size_t Capacity, uint32_t Attempts>
+    class IsrRing
+    {
+        static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "IsrRing capacity must be a power of 2");
+        static_assert(Attempts >= 1, "IsrRing needs at least one attempt");
+
+    private:
+        static const uint32_t MASK = Capacity - 1;
+
+        struct Cell
+        {
+            std::atomic<uint32_t> published; // Position + 1 once the slot is written for that position
+            T value;
+        };
+
+        Cell _cells[Capacity] = {};
+        std::atomic<uint32_t> _head{0}; // Next position to claim (producers)
+        std::atomic<uint32_t> _tail{0}; // Next position to read (consumer)
+
+    public:
+        /**
+         * Producers.
+         *
+         * @param position Set to the claimed position, pass it to commit()
+         * @return Slot to fill and publish with commit(), or nullptr if the ring is full or
+         *         other producers won Attempts claims in a row
+         */
+        T *reserve(uint32_t &position)
+        {
+            position = _head.load(std::memory_order_relaxed);
+            for (uint32_t attempt = 0; attempt < Attempts; ++attempt)
+            {
+                if (position - _tail.load(std::memory_order_acquire) >= Capacity)
+                    return nullptr;
+                // Strong, so only a claim lost to another producer uses up an attempt
+                if (_head.compare_exchange_strong(position, position + 1, std::memory_order_relaxed))
+                    return &_cells[position & MASK].value;
+            }
+            return nullptr;
+        }
+
+        void commit(uint32_t position)
+        {
+            _cells[position & MASK].published.store(position + 1, std::memory_order_release);
+        }
+
+        /**
+         * Consumer only.
+         *
+         * @return Oldest slot if it is published, or nullptr if the ring is empty or it is still being written
+         */
+        T *front()
+        {
+            uint32_t tail = _tail.load(std::memory_order_relaxed);
+            Cell &cell = _cells[tail & MASK];
+            if (cell.published.load(std::memory_order_acquire) != tail + 1)
+                return nullptr;
+            return &cell.value;
+        }
+
+        void pop()
+        {
+            _tail.store(_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        // Also false while a claimed slot is still being written
+        bool empty() const
+        {
+            return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_relaxed);
+        }
+    };
+
+    /**
+     * Argument types an interrupt handler can log: integers, floats, enums and bool up to 32 bits.
+     */
+    template <typename T>
+    struct IsrArg
+    {
+        static const bool value = (std::is_arithmetic<T>::value || std::is_enum<T>::value) && sizeof(T) <= sizeof(uint32_t);
+    };
+
+    template <typename... Args>
+    struct IsrFormat
+    {
+        static_assert(sizeof...(Args) <= LOG_ISR_MAX_ARGS, "LOG_ISR_* takes at most LOG_ISR_MAX_ARGS arguments");
+        static_assert(AllOf<IsrArg<typename std::decay<Args>::type>::value...>::value,
+                      "LOG_ISR_* arguments must be integers, floats, enums or bool of at most 32 bits");
+
+        static LOG_ISR_ATTR void write(uint32_t *slots, const Args &...args)
+        {
+            int expand[] = {0, (store(slots++, args), 0)...};
+            (void)expand;
+            (void)slots;
+        }
+
+        static void format(const uint32_t *slots, fmt::string_view format, fmt::appender out)
+        {
+            formatImpl(slots, format, out, typename MakeIndexSequence<sizeof...(Args)>::type());
+        }
+
+    private:
+        // Copies through a plain local, so volatile arguments (e.g. counters shared with the handler) can be stored
+        template <typename T>
+        static LOG_ISR_ATTR void store(uint32_t *slot, const T &arg)
+        {
+            typename std::decay<T>::type value = arg;
+            memcpy(slot, &value, sizeof(value));
+        }
+
+        template <typename T>
+        static T read(const uint32_t *slot)
+        {
+            T value;
+            memcpy(&value, slot, sizeof(T));
+            return value;
+        }
+
+        template <size_t... I>
+        static void formatImpl(const uint32_t *slots, fmt::string_view format, fmt::appender out, IndexSequence<I...>)
+        {
+            // make_format_args() only binds lvalues
+            std::tuple<typename std::decay<Args>::type...> values{read<typename std::decay<Args>::type>(slots + I)...};
+            (void)slots;
+            fmt::vformat_to(out, format, fmt::make_format_args(std::get<I>(values)...));
+        }
+    };
+
+    /**
+     * Checks a LOG_ISR_* format string against its arguments at compile time, like the LOG_* macros
+     * (C++20 or FMT_STRING). Empty at runtime, the site keeps the format as a plain pointer.
+     */
+    template <typename... Args>
+    __attribute__((always_inline)) inline void checkIsrFormat(fmt::format_string<Args...>, const Args &...)
+    {
+    }
+
+    /**
+     * Rings written by LOG_ISR_* macros, one per interrupt context (LOG_ISR_CONTEXTS).
+     * Constant-initialized, so an interrupt handler can use them before and without the logger instance.
+     */
+    template <typename T = void>
+    struct IsrQueue
+    {
+        using Ring = IsrRing<IsrRecord, LOG_ISR_QUEUE_SIZE, LOG_ISR_CLAIM_ATTEMPTS>;
+
+        static Ring rings[LOG_ISR_CONTEXTS];
+        static std::atomic<uint32_t> dropped;
+        static std::atomic<const IsrSite *> invalidSite; // Last site called with LOG_ISR_CONTEXT() out of range
+
+        /**
+         * Records a message. Lock-free, never allocates: a fixed number of stores plus at most
+         * LOG_ISR_CLAIM_ATTEMPTS claims, or a dropped message if the ring of this context is full
+         * or the claims are lost to other writers.
+         */
+        template <typename... Args>
+        static LOG_ISR_ATTR void write(const IsrSite &site, uint32_t context, const Args &...args)
+        {
+            using Format = IsrFormat<Args...>;
+            if (context >= LOG_ISR_CONTEXTS)
+            {
+                // Reported by the next drain
+                invalidSite.store(&site, std::memory_order_relaxed);
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            uint32_t position;
+            IsrRecord *record = rings[context].reserve(position);
+            if (record == nullptr)
+            {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            record->site = &site;
+            record->formatter = &Format::format;
+#if LOG_TIME == LOG_TIME_MICROS
+            record->time = micros();
+#else
+            record->time = millis();
+#endif
+            Format::write(record->args, args...);
+            rings[context].commit(position);
+        }
+
+        static bool pending()
+        {
+            if (invalidSite.load(std::memory_order_relaxed) != nullptr)
+                return true;
+            for (size_t i = 0; i < LOG_ISR_CONTEXTS; ++i)
+            {
+                if (!rings[i].empty())
+                    return true;
+            }
+            return false;
+        }
+    };
+
+    template <typename T>
+    typename IsrQueue<T>::Ring IsrQueue<T>::rings[LOG_ISR_CONTEXTS];
+
+    template <typename T>
+    std::atomic<uint32_t> IsrQueue<T>::dropped{0};
+
+    template <typename T>
+    std::atomic<const IsrSite *> IsrQueue<T>::invalidSite{nullptr};
+
+} // namespace fmtlog
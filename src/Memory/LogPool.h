@@ -0,0 +1,205 @@
+#pragma once
+
+#include <Arduino.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <new>
+#include "Config/Settings.h"
+
+namespace fmtlog
+{
+
+    struct PoolStats
+    {
+        uint16_t inUse;          // Blocks taken right now
+        uint16_t highWater;      // Most blocks taken at the same time
+        uint32_t allocations;    // Buffers served from the pool
+        uint32_t fallbacks;      // Buffers served from the heap (pool exhausted or request larger than a block)
+        uint32_t failures;       // Times LOG_POOL_EXHAUSTED_HANDLER was called (LOG_POOL_EXHAUSTED_FAIL)
+        uint32_t largestRequest; // Largest request in bytes, pool or not
+    };
+
+    /**
+     * Fixed number of fixed-size blocks, reserved in static storage. Taking and returning a block is
+     * lock-free and takes a bounded number of steps, so it behaves the same on every call and never
+     * fragments. Safe to use from several tasks at once.
+     *
+     * @tparam BlockSize Bytes per block
+     * @tparam BlockCount Number of blocks
+     */
+    template <size_t BlockSize, size_t BlockCount>
+    class BlockPool
+    {
+        static_assert(BlockSize > 0 && BlockCount > 0, "BlockPool needs at least one block of at least one byte");
+
+    private:
+        static const size_t WORDS = (BlockCount + 31) / 32;
+
+        alignas(alignof(max_align_t)) char _blocks[BlockCount][BlockSize];
+        std::atomic<uint32_t> _used[WORDS]; // One bit per block
+        std::atomic<uint16_t> _inUse;
+        std::atomic<uint16_t> _highWater;
+        std::atomic<uint32_t> _allocations;
+        std::atomic<uint32_t> _fallbacks;
+        std::atomic<uint32_t> _failures;
+        std::atomic<uint32_t> _largestRequest;
+
+        static uint32_t wordMask(size_t word)
+        {
+            size_t bits = BlockCount - word * 32;
+            return bits >= 32 ? UINT32_MAX : (uint32_t(1) << bits) - 1;
+        }
+
+        static void raise(std::atomic<uint32_t> &value, uint32_t candidate)
+        {
+            uint32_t current = value.load(std::memory_order_relaxed);
+            while (candidate > current && !value.compare_exchange_weak(current, candidate, std::memory_order_relaxed))
+                ;
+        }
+
+        void taken()
+        {
+            uint16_t inUse = _inUse.fetch_add(1, std::memory_order_relaxed) + 1;
+            uint16_t highWater = _highWater.load(std::memory_order_relaxed);
+            while (inUse > highWater && !_highWater.compare_exchange_weak(highWater, inUse, std::memory_order_relaxed))
+                ;
+            _allocations.fetch_add(1, std::memory_order_relaxed);
+        }
+
+    public:
+        /**
+         * @return A free block, or nullptr if all are taken or size is larger than a block
+         */
+        void *acquire(size_t size)
+        {
+            raise(_largestRequest, static_cast<uint32_t>(size));
+            if (size > BlockSize)
+                return nullptr;
+
+            for (size_t word = 0; word < WORDS; ++word)
+            {
+                uint32_t used = _used[word].load(std::memory_order_relaxed);
+                uint32_t free = ~used & wordMask(word);
+                while (free != 0)
+                {
+                    uint32_t bit = __builtin_ctz(free);
+                    if (_used[word].compare_exchange_weak(used, used | (uint32_t(1) << bit), std::memory_order_acquire, std::memory_order_relaxed))
+                    {
+                        taken();
+                        return _blocks[word * 32 + bit];
+                    }
+                    free = ~used & wordMask(word);
+                }
+            }
+            return nullptr;
+        }
+
+        /**
+         * Returns a block taken with acquire().
+         */
+        void release(void *block)
+        {
+            size_t index = (static_cast<char *>(block) - _blocks[0]) / BlockSize;
+            _inUse.fetch_sub(1, std::memory_order_relaxed);
+            _used[index / 32].fetch_and(~(uint32_t(1) << (index % 32)), std::memory_order_release);
+        }
+
+        bool owns(const void *pointer) const
+        {
+            uintptr_t address = reinterpret_cast<uintptr_t>(pointer);
+            return address >= reinterpret_cast<uintptr_t>(_blocks[0]) &&
+                   address < reinterpret_cast<uintptr_t>(_blocks[0]) + sizeof(_blocks);
+        }
+
+        void countFallback()
+        {
+            _fallbacks.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void countFailure()
+        {
+            _failures.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        PoolStats stats() const
+        {
+            PoolStats stats;
+            stats.inUse = _inUse.load(std::memory_order_relaxed);
+            stats.highWater = _highWater.load(std::memory_order_relaxed);
+            stats.allocations = _allocations.load(std::memory_order_relaxed);
+            stats.fallbacks = _fallbacks.load(std::memory_order_relaxed);
+            stats.failures = _failures.load(std::memory_order_relaxed);
+            stats.largestRequest = _largestRequest.load(std::memory_order_relaxed);
+            return stats;
+        }
+    };
+
+    /**
+     * The pool behind PoolAllocator. Zero-initialized static storage, reserved before setup() runs
+     * and usable before and without the logger instance.
+     */
+    template <typename T = void>
+    struct LogPool
+    {
+        static BlockPool<LOG_POOL_BLOCK_SIZE, LOG_POOL_BLOCK_COUNT> pool;
+    };
+
+    template <typename T>
+    BlockPool<LOG_POOL_BLOCK_SIZE, LOG_POOL_BLOCK_COUNT> LogPool<T>::pool;
+
+    /**
+     * Allocator for the line buffers (LOG_BUFFER_ALLOCATOR), used once a line outgrows its
+     * LOG_STATIC_BUFFER_SIZE bytes on the stack. Serves each request with a whole pool block.
+     *
+     * max_size() is one block, which keeps fmt from growing a buffer past a block while the line still
+     * fits in one. A larger request, or any request while all blocks are taken, follows
+     * LOG_POOL_EXHAUSTED_POLICY.
+     */
+    template <typename T>
+    struct PoolAllocator
+    {
+        using value_type = T;
+
+        PoolAllocator() = default;
+
+        template <typename U>
+        PoolAllocator(const PoolAllocator<U> &) {}
+
+        T *allocate(size_t n)
+        {
+            auto &pool = LogPool<>::pool;
+            void *block = pool.acquire(n * sizeof(T));
+            if (block != nullptr)
+                return static_cast<T *>(block);
+
+#if LOG_POOL_EXHAUSTED_POLICY == LOG_POOL_EXHAUSTED_FAIL
+            pool.countFailure();
+            LOG_POOL_EXHAUSTED_HANDLER(); // Falls through to the heap only if the handler returns
+#endif
+            pool.countFallback();
+            return static_cast<T *>(::operator new(n * sizeof(T)));
+        }
+
+        void deallocate(T *pointer, size_t)
+        {
+            auto &pool = LogPool<>::pool;
+            if (pool.owns(pointer))
+                pool.release(pointer);
+            else
+                ::operator delete(pointer);
+        }
+
+        size_t max_size() const
+        {
+            return LOG_POOL_BLOCK_SIZE / sizeof(T);
+        }
+
+        template <typename U>
+        bool operator==(const PoolAllocator<U> &) const { return true; }
+
+        template <typename U>
+        bool operator!=(const PoolAllocator<U> &) const { return false; }
+    };
+
+} // namespace fmtlog
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <Arduino.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+namespace fmtlog
+{
+
+    /**
+     * Fixed set of buffers handed out by index reservation: a caller claims a free one with a single
+     * atomic bit and gives it back when done. Never blocks, acquire() reports when all are taken.
+     *
+     * @tparam Buffer Buffer type, needs clear()
+     * @tparam Count Number of buffers, at most 32
+     */
+    template <typename Buffer, size_t Count>
+    class SharedBuffers
+    {
+        static_assert(Count >= 1 && Count <= 32, "SharedBuffers holds between 1 and 32 buffers");
+
+    private:
+        Buffer _buffers[Count];
+        std::atomic<uint32_t> _used{0}; // One bit per buffer
+
+    public:
+        /**
+         * @return An empty buffer, or nullptr if all are taken
+         */
+        Buffer *acquire()
+        {
+            const uint32_t all = Count == 32 ? UINT32_MAX : (uint32_t(1) << Count) - 1;
+            uint32_t used = _used.load(std::memory_order_relaxed);
+            while ((~used & all) != 0)
+            {
+                uint32_t index = __builtin_ctz(~used & all);
+                if (_used.compare_exchange_weak(used, used | (uint32_t(1) << index), std::memory_order_acquire, std::memory_order_relaxed))
+                {
+                    _buffers[index].clear();
+                    return &_buffers[index];
+                }
+            }
+            return nullptr;
+        }
+
+        void release(Buffer *buffer)
+        {
+            size_t index = buffer - _buffers;
+            _used.fetch_and(~(uint32_t(1) << index), std::memory_order_release);
+        }
+    };
+
+} // namespace fmtlog
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <Arduino.h>
+#include <string.h>
+#include "Config/Settings.h"
+
+namespace fmtlog
+{
+
+    enum class PollTarget : uint8_t
+    {
+        STREAM,   // Stream *
+        FILE_SINK // IFileSink *
+    };
+
+    /**
+     * Output queued by LOG_* calls in cooperative mode (LOG_POLL_ENABLE), written out by LOG_POLL().
+     *
+     * A fixed byte ring of chunks, each a header naming its output followed by the bytes to write.
+     * The oldest chunk can be consumed a few bytes at a time, as the output has room for them.
+     * Not thread-safe on its own, FormatLog only uses it under its output lock.
+     */
+    template <size_t Size>
+    class PollBuffer
+    {
+    public:
+        struct Header
+        {
+            void *output;
+            uint16_t size;
+            PollTarget target;
+            uint8_t level; // LogLevel of a file line, for the sink's FlushPolicy
+        };
+
+    private:
+        char _data[Size];
+        size_t _start = 0;   // Index of the oldest chunk header
+        size_t _used = 0;    // Bytes used, headers and the skipped end of the ring included
+        size_t _skipped = 0; // Bytes left unused at the end of the ring when the newest chunks start over at 0
+        size_t _offset = 0;  // Bytes of the oldest chunk already written
+        uint32_t _dropped = 0;
+
+    public:
+        /**
+         * Queues a copy of data for output. Never blocks.
+         *
+         * A chunk is never split across the end of the ring, so a file line always reaches the sink
+         * in one writeLine() call. If it doesn't fit before the end, the rest of the ring is skipped.
+         *
+         * @return false if the chunk doesn't fit and was dropped
+         */
+        bool push(PollTarget target, void *output, const char *data, size_t size, uint8_t level = LOG_LEVEL_DISABLE)
+        {
+            if (size == 0)
+                return true;
+            if (_used == 0)
+                _start = 0;
+
+            size_t chunk = sizeof(Header) + size;
+            size_t end = _start + _used;
+            size_t skip = 0;
+            if (end >= Size)
+                end -= Size; // Already wrapped, the free space up to _start is contiguous
+            else if (Size - end < chunk)
+                skip = Size - end;
+
+            if (size > UINT16_MAX || skip + chunk > Size - _used)
+            {
+                ++_dropped;
+                return false;
+            }
+
+            Header header;
+            header.output = output;
+            header.size = static_cast<uint16_t>(size);
+            header.target = target;
+            header.level = level;
+            if (skip > 0)
+            {
+                end = 0;
+                _skipped = skip;
+            }
+            memcpy(_data + end, &header, sizeof(header));
+            memcpy(_data + end + sizeof(header), data, size);
+            _used += skip + chunk;
+            return true;
+        }
+
+        /**
+         * @return false if nothing is queued, otherwise the header of the oldest chunk
+         */
+        bool front(Header &header) const
+        {
+            if (_used == 0)
+                return false;
+            memcpy(&header, _data + _start, sizeof(header));
+            return true;
+        }
+
+        /**
+         * Points data at the next unwritten bytes of the oldest chunk.
+         *
+         * @return Number of bytes, at most max
+         */
+        size_t peek(const Header &header, const char *&data, size_t max) const
+        {
+            size_t size = header.size - _offset;
+            data = _data + _start + sizeof(Header) + _offset;
+            return size > max ? max : size;
+        }
+
+        /**
+         * Marks bytes of the oldest chunk as written, removing the chunk once all are.
+         */
+        void consume(const Header &header, size_t size)
+        {
+            _offset += size;
+            if (_offset < header.size)
+                return;
+            _start += sizeof(Header) + header.size;
+            _used -= sizeof(Header) + header.size;
+            _offset = 0;
+            if (_start == Size - _skipped)
+            {
+                _start = 0;
+                _used -= _skipped;
+                _skipped = 0;
+            }
+        }
+
+        size_t pending() const
+        {
+            return _used;
+        }
+
+        uint32_t droppedCount() const
+        {
+            return _dropped;
+        }
+    };
+
+} // namespace fmtlog
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <Arduino.h>
+
+#if defined(ESP32)
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#else
+#include <mutex>
+#endif
+
+namespace fmtlog
+{
+
+    /**
+     * Serializes the writes of concurrent log calls (LOG_THREAD_SAFE). Only held while finished
+     * lines are written, never while a message is formatted.
+     *
+     * ESP32  –  statically allocated FreeRTOS mutex (priority inheritance, no heap)
+     * Other  –  std::mutex
+     */
+    class LogMutex
+    {
+    private:
+#if defined(ESP32)
+        StaticSemaphore_t _storage;
+        SemaphoreHandle_t _handle;
+#else
+        std::mutex _mutex;
+#endif
+
+    public:
+#if defined(ESP32)
+        LogMutex() : _handle(xSemaphoreCreateMutexStatic(&_storage)) {}
+
+        void lock() { xSemaphoreTake(_handle, portMAX_DELAY); }
+        void unlock() { xSemaphoreGive(_handle); }
+#else
+        LogMutex() = default;
+
+        void lock() { _mutex.lock(); }
+        void unlock() { _mutex.unlock(); }
+#endif
+
+        LogMutex(const LogMutex &) = delete;
+        LogMutex &operator=(const LogMutex &) = delete;
+    };
+
+    /**
+     * Stand-in for LogMutex when LOG_THREAD_SAFE is off, compiles to nothing.
+     */
+    struct NullMutex
+    {
+        void lock() {}
+        void unlock() {}
+    };
+
+    template <typename Mutex>
+    class LockGuard
+    {
+    private:
+        Mutex &_mutex;
+
+    public:
+        explicit LockGuard(Mutex &mutex) : _mutex(mutex) { _mutex.lock(); }
+        ~LockGuard() { _mutex.unlock(); }
+
+        LockGuard(const LockGuard &) = delete;
+        LockGuard &operator=(const LockGuard &) = delete;
+    };
+
+} // namespace fmtlog
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+
+namespace fmtlog
+{
+
+    /**--------------------------------------------------------------------------------------
+     * Per call site throttles used by LOG_EVERY_N, LOG_EVERY_MS, LOG_ONCE and LOG_RATE_LIMIT.
+     *
+     * Each call site owns one static instance. All members are constant-initialized, so the
+     * instance needs no construction guard, and the check runs before anything is formatted.
+     * allow() reports how many calls were suppressed since the last one it let through.
+     *-------------------------------------------------------------------------------------*/
+
+    /**
+     * Lets the first call through, then every nth call.
+     */
+    class EveryN
+    {
+    private:
+        std::atomic<uint32_t> _count{0};
+
+    public:
+        bool allow(uint32_t n, uint32_t &suppressed)
+        {
+            uint32_t count = _count.fetch_add(1, std::memory_order_relaxed);
+            if (n <= 1)
+                return true;
+            if (count % n != 0)
+                return false;
+            suppressed = count == 0 ? 0 : n - 1;
+            return true;
+        }
+    };
+
+    /**
+     * Lets at most one call through per interval.
+     */
+    class EveryMs
+    {
+    private:
+        std::atomic<uint32_t> _last{0};
+        std::atomic<uint32_t> _suppressed{0};
+        std::atomic<bool> _started{false};
+
+    public:
+        bool allow(uint32_t intervalMs, uint32_t &suppressed)
+        {
+            uint32_t now = millis();
+            uint32_t last = _last.load(std::memory_order_relaxed);
+            bool started = _started.load(std::memory_order_relaxed);
+
+            // Only the caller that moves _last forward logs, concurrent callers count as suppressed
+            if ((started && now - last < intervalMs) || !_last.compare_exchange_strong(last, now, std::memory_order_relaxed))
+            {
+                _suppressed.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+
+            _started.store(true, std::memory_order_relaxed);
+            suppressed = _suppressed.exchange(0, std::memory_order_relaxed);
+            return true;
+        }
+    };
+
+    /**
+     * Lets the first call through, once per boot.
+     */
+    class Once
+    {
+    private:
+        std::atomic<bool> _done{false};
+
+    public:
+        bool allow(uint32_t &suppressed)
+        {
+            suppressed = 0;
+            return !_done.exchange(true, std::memory_order_relaxed);
+        }
+    };
+
+    /**
+     * Token bucket: lets bursts of up to capacity calls through, then one call per refill interval.
+     */
+    class TokenBucket
+    {
+    private:
+        std::atomic<uint32_t> _tokens{0};
+        std::atomic<uint32_t> _lastRefill{0};
+        std::atomic<uint32_t> _suppressed{0};
+        std::atomic<bool> _started{false};
+
+        void refill(uint32_t capacity, uint32_t refillMs, uint32_t now)
+        {
+            uint32_t last = _lastRefill.load(std::memory_order_relaxed);
+            uint32_t elapsed = now - last;
+            if (refillMs == 0 || elapsed < refillMs)
+                return;
+
+            // The caller that advances _lastRefill adds the tokens earned since, capped at capacity
+            uint32_t earned = elapsed / refillMs;
+            if (!_lastRefill.compare_exchange_strong(last, last + earned * refillMs, std::memory_order_relaxed))
+                return;
+
+            uint32_t tokens = _tokens.load(std::memory_order_relaxed);
+            uint32_t filled;
+            do
+            {
+                filled = capacity - tokens < earned ? capacity : tokens + earned;
+            } while (!_tokens.compare_exchange_weak(tokens, filled, std::memory_order_relaxed));
+        }
+
+    public:
+        bool allow(uint32_t capacity, uint32_t refillMs, uint32_t &suppressed)
+        {
+            uint32_t now = millis();
+            if (!_started.exchange(true, std::memory_order_relaxed))
+            {
+                _lastRefill.store(now, std::memory_order_relaxed);
+                _tokens.store(capacity, std::memory_order_relaxed);
+            }
+            else
+            {
+                refill(capacity, refillMs, now);
+            }
+
+            uint32_t tokens = _tokens.load(std::memory_order_relaxed);
+            do
+            {
+                if (tokens == 0)
+                {
+                    _suppressed.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+            } while (!_tokens.compare_exchange_weak(tokens, tokens - 1, std::memory_order_relaxed));
+
+            suppressed = _suppressed.exchange(0, std::memory_order_relaxed);
+            return true;
+        }
+    };
+
+} // namespace fmtlog
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include "FileStorage/FileSystem/IFileManager.h"
+
+/**
+ * In-memory IFileManager that counts the filesystem operations a sink performs,
+ * so rotation and flush behavior can be checked without a real filesystem.
+ *
+ * deviceBytes models what a block device writes: a sector once it fills up, and on every
+ * flush the partly filled last sector again plus one sector of metadata (FAT / directory entry).
+ * partialSectorWrites counts writes that end inside a sector, which a real device reads back and
+ * rewrites when the next write completes it.
+ */
+class MemoryFileManager : public fmtlog::IFileManager
+{
+public:
+    std::map<std::string, std::string> files;
+    std::string openPath;
+    bool fileOpen = false;
+
+    size_t opens = 0;
+    size_t writes = 0;
+    size_t flushes = 0;
+    size_t existsCalls = 0;
+    size_t removes = 0;
+    size_t renames = 0;
+    size_t bytesWritten = 0;
+    size_t deviceBytes = 0;
+    size_t partialSectorWrites = 0;
+
+    uint32_t writeDelayMs = 0; // Simulated latency of each write, like a slow SD card
+
+    static const size_t SECTOR_SIZE = 512;
+
+    void resetCounters()
+    {
+        opens = writes = flushes = existsCalls = removes = renames = bytesWritten = deviceBytes = partialSectorWrites = 0;
+    }
+
+    size_t metadataOperations() const
+    {
+        return existsCalls + removes + renames;
+    }
+
+    bool open(const char *filePath) override
+    {
+        close();
+        ++opens;
+        openPath = filePath;
+        _storedSectors = files[openPath].size() / SECTOR_SIZE; // Created like "a" / O_APPEND | O_CREAT
+        _dirty = false;
+        fileOpen = true;
+        return true;
+    }
+
+    bool isOpen() const override
+    {
+        return fileOpen;
+    }
+
+    size_t write(const char *data, size_t size) override
+    {
+        if (!fileOpen || size == 0)
+            return 0;
+        if (writeDelayMs > 0)
+            delay(writeDelayMs);
+        ++writes;
+        bytesWritten += size;
+        std::string &file = files[openPath];
+        file.append(data, size);
+        if (file.size() % SECTOR_SIZE != 0)
+            ++partialSectorWrites;
+
+        // Sectors filled by this write go to the device
+        size_t filled = file.size() / SECTOR_SIZE;
+        if (filled > _storedSectors)
+        {
+            deviceBytes += (filled - _storedSectors) * SECTOR_SIZE;
+            _storedSectors = filled;
+        }
+        _dirty = true;
+        return size;
+    }
+
+    void flush() override
+    {
+        if (!fileOpen)
+            return;
+        ++flushes;
+        syncDevice();
+    }
+
+    void close() override
+    {
+        if (fileOpen)
+            syncDevice();
+        fileOpen = false;
+    }
+
+    size_t size() override
+    {
+        return fileOpen ? files[openPath].size() : 0;
+    }
+
+    const char *filePath() override
+    {
+        return openPath.c_str();
+    }
+
+    bool exists(const char *filePath) override
+    {
+        ++existsCalls;
+        return files.count(filePath) != 0;
+    }
+
+    bool remove(const char *filePath) override
+    {
+        ++removes;
+        return files.erase(filePath) != 0;
+    }
+
+    bool rename(const char *oldPath, const char *newPath) override
+    {
+        ++renames;
+        auto it = files.find(oldPath);
+        if (it == files.end())
+            return false;
+        files[newPath] = it->second;
+        files.erase(oldPath);
+        return true;
+    }
+
+    size_t readFile(const char *filePath, char *data, size_t size) override
+    {
+        auto it = files.find(filePath);
+        if (it == files.end())
+            return 0;
+        return it->second.copy(data, size);
+    }
+
+    bool replaceFile(const char *filePath, const char *data, size_t size) override
+    {
+        files[filePath].assign(data, size);
+        deviceBytes += 2 * SECTOR_SIZE;
+        return true;
+    }
+
+    size_t sectorSize() const override
+    {
+        return SECTOR_SIZE;
+    }
+
+private:
+    size_t _storedSectors = 0; // Full sectors of the open file already on the device
+    bool _dirty = false;
+
+    void syncDevice()
+    {
+        if (!_dirty)
+            return;
+        if (files[openPath].size() % SECTOR_SIZE != 0)
+            deviceBytes += SECTOR_SIZE; // Partly filled last sector
+        deviceBytes += SECTOR_SIZE;     // Metadata
+        _dirty = false;
+    }
+};
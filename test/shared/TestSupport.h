@@ -0,0 +1,116 @@
+#pragma once
+
+#include <Arduino.h>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <string>
+
+/*------------------------------------------------------------------------------
+ * Allocation counter: define TEST_COUNT_ALLOCATIONS before including this header
+ * and every operator new in the program goes through here
+ *----------------------------------------------------------------------------*/
+
+#ifdef TEST_COUNT_ALLOCATIONS
+
+static volatile size_t gAllocations = 0;
+
+void *operator new(size_t size)
+{
+    ++gAllocations;
+    void *ptr = malloc(size ? size : 1);
+    if (ptr == nullptr)
+        abort();
+    return ptr;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+#endif
+
+/*------------------------------------------------------------------------------
+ * Test Stream to capture output
+ *
+ * Safe to write from a background task. availableForWrite() reports room, which
+ * shrinks with each write like a UART transmit buffer; writeMs slows every write
+ * down like a slow UART.
+ *----------------------------------------------------------------------------*/
+
+class TestStream : public Stream
+{
+private:
+    std::string buffer;
+    std::mutex mutex;
+
+public:
+    int room = 1000;            // Bytes availableForWrite() reports
+    bool overrun = false;       // Set if more was written than reported
+    unsigned long writeMs = 0;  // Delay per write
+    size_t writes = 0;          // Calls to write() since clear()
+    size_t largestWrite = 0;    // Largest single write since clear()
+
+    size_t write(uint8_t ch) override
+    {
+        return write(&ch, 1);
+    }
+    size_t write(const uint8_t *data, size_t size) override
+    {
+        if (writeMs != 0)
+            delay(writeMs);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if ((int)size > room)
+            overrun = true;
+        room -= (int)size;
+        ++writes;
+        if (size > largestWrite)
+            largestWrite = size;
+        buffer.append(reinterpret_cast<const char *>(data), size);
+        return size;
+    }
+    int availableForWrite() override { return room; }
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    void flush() override {}
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        buffer.clear();
+        buffer.reserve(1024); // Keeps the stream's own allocations out of allocation and stack measurements
+        overrun = false;
+        writes = 0;
+        largestWrite = 0;
+    }
+    std::string str()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return buffer;
+    }
+    // Only while nothing else writes
+    const char *c_str() const { return buffer.c_str(); }
+};
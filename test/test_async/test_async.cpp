@@ -0,0 +1,169 @@
+// More information about PlatformIO Unit Testing:
+// https://docs.platformio.org/en/latest/advanced/unit-testing/index.html
+
+#include <Arduino.h>
+#include <string>
+#include <cstring>
+#include <thread>
+#include "unity.h"
+
+#include "../shared/TestSupport.h"
+
+TestStream gStream;
+
+#define LOG_STREAM gStream
+#define LOG_LEVEL LOG_LEVEL_TRACE
+#define LOG_COLOR LOG_COLOR_DISABLE
+#define LOG_TIME LOG_TIME_DISABLE
+#define LOG_FILENAME LOG_FILENAME_DISABLE
+#define LOG_STATIC_BUFFER_SIZE 64
+
+#define LOG_ASYNC_ENABLE 1
+#define LOG_ASYNC_QUEUE_SIZE 8 // Small so producers wrap around the ring
+#define LOG_ASYNC_RECORD_SIZE 128
+
+#include "FormatLog.h"
+
+static size_t countOccurrences(const std::string &haystack, const char *needle)
+{
+    size_t count = 0;
+    size_t pos = 0;
+    while ((pos = haystack.find(needle, pos)) != std::string::npos)
+    {
+        ++count;
+        ++pos;
+    }
+    return count;
+}
+
+/*------------------------------------------------------------------------------
+ * TESTS FOR Async Logging
+ *----------------------------------------------------------------------------*/
+
+void test_async_output_after_flush()
+{
+    LOG_INFO("Queued {}", 1);
+    LOG_FLUSH();
+
+    std::string out = gStream.str();
+    TEST_ASSERT_NOT_NULL(strstr(out.c_str(), "Queued 1"));
+}
+
+void test_async_preserves_order()
+{
+    for (int i = 0; i < 100; i++)
+        LOG_INFO("Msg {:03}", i);
+    LOG_FLUSH();
+
+    std::string out = gStream.str();
+    size_t last = 0;
+    for (int i = 0; i < 100; i++)
+    {
+        char expected[16];
+        snprintf(expected, sizeof(expected), "Msg %03d", i);
+        size_t pos = out.find(expected);
+        TEST_ASSERT_NOT_EQUAL_MESSAGE(std::string::npos, pos, expected);
+        TEST_ASSERT_TRUE_MESSAGE(pos >= last, "Messages written out of order");
+        last = pos;
+    }
+}
+
+void test_async_multiple_producers()
+{
+    const int producers = 4;
+    const int perProducer = 50;
+
+    std::thread threads[producers];
+    for (int t = 0; t < producers; t++)
+    {
+        threads[t] = std::thread([t]()
+                                 {
+                                     for (int i = 0; i < perProducer; i++)
+                                         LOG_INFO("P{}-{}", t, i); });
+    }
+    for (int t = 0; t < producers; t++)
+        threads[t].join();
+    LOG_FLUSH();
+
+    std::string out = gStream.str();
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(producers * perProducer, (unsigned int)countOccurrences(out, LOG_EOL),
+                                   "Every message should be written exactly once");
+    TEST_ASSERT_NOT_NULL(strstr(out.c_str(), "P0-49"));
+    TEST_ASSERT_NOT_NULL(strstr(out.c_str(), "P3-49"));
+}
+
+void test_async_disabled_writes_directly()
+{
+    LOG_SET_ASYNC(false);
+
+    LOG_INFO("Direct");
+    TEST_ASSERT_NOT_NULL(strstr(gStream.str().c_str(), "Direct"));
+
+    LOG_SET_ASYNC(true);
+}
+
+void test_async_record_holds_full_message()
+{
+    uint32_t truncatedBefore = FmtLog.getAsyncTruncatedCount();
+
+    std::string payload(LOG_ASYNC_RECORD_SIZE, 'Z');
+    LOG_INFO("{}", payload);
+    LOG_FLUSH();
+
+    TEST_ASSERT_EQUAL_STRING(("[INFO] " + payload + LOG_EOL).c_str(), gStream.str().c_str());
+    TEST_ASSERT_EQUAL_UINT32(truncatedBefore, FmtLog.getAsyncTruncatedCount());
+}
+
+void test_async_long_message_truncated()
+{
+    uint32_t truncatedBefore = FmtLog.getAsyncTruncatedCount();
+
+    std::string payload(LOG_ASYNC_RECORD_SIZE * 2, 'X');
+    LOG_INFO("{}", payload);
+    LOG_FLUSH();
+
+    // The source location and timestamp are stored beside the body, so a full record of body is kept
+    std::string out = gStream.str();
+    const size_t eolLen = strlen(LOG_EOL);
+    TEST_ASSERT_EQUAL_UINT(LOG_ASYNC_RECORD_SIZE, (unsigned int)countOccurrences(out, "X"));
+    TEST_ASSERT_EQUAL_INT(0, memcmp(out.c_str() + out.size() - eolLen, LOG_EOL, eolLen));
+    TEST_ASSERT_EQUAL_UINT32(truncatedBefore + 1, FmtLog.getAsyncTruncatedCount());
+}
+
+/*------------------------------------------------------------------------------
+ * SETUP AND TEST RUNNER
+ *----------------------------------------------------------------------------*/
+
+void setUp(void)
+{
+    LOG_FLUSH();
+    gStream.clear();
+}
+
+void tearDown(void)
+{
+}
+
+void tests()
+{
+    RUN_TEST(test_async_output_after_flush);
+    RUN_TEST(test_async_preserves_order);
+    RUN_TEST(test_async_multiple_producers);
+    RUN_TEST(test_async_disabled_writes_directly);
+    RUN_TEST(test_async_record_holds_full_message);
+    RUN_TEST(test_async_long_message_truncated);
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs if board doesn't support software reset via Serial.DTR/RTS
+    delay(4000);
+
+    UNITY_BEGIN();
+    tests();
+    UNITY_END();
+}
+
+void loop()
+{
+}
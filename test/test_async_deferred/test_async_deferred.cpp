@@ -0,0 +1,163 @@
+// More information about PlatformIO Unit Testing:
+// https://docs.platformio.org/en/latest/advanced/unit-testing/index.html
+
+#include <Arduino.h>
+#include <string>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include "unity.h"
+
+#include "../shared/TestSupport.h"
+
+TestStream gStream;
+
+#define LOG_STREAM gStream
+#define LOG_LEVEL LOG_LEVEL_TRACE
+#define LOG_COLOR LOG_COLOR_DISABLE
+#define LOG_TIME LOG_TIME_DISABLE
+#define LOG_FILENAME LOG_FILENAME_ENABLE
+#define LOG_STATIC_BUFFER_SIZE 64
+
+#define LOG_ASYNC_ENABLE 1
+#define LOG_ASYNC_DEFERRED 1
+#define LOG_ASYNC_QUEUE_SIZE 8
+#define LOG_ASYNC_RECORD_SIZE 128
+
+#include "FormatLog.h"
+
+// Trivially copyable, but only valid while the value it points at is
+struct Reading
+{
+    const int *value;
+};
+
+template <>
+struct fmt::formatter<Reading> : fmt::formatter<int>
+{
+    template <typename FormatContext>
+    auto format(const Reading &reading, FormatContext &ctx) const -> decltype(ctx.out())
+    {
+        return fmt::formatter<int>::format(*reading.value, ctx);
+    }
+};
+
+/*------------------------------------------------------------------------------
+ * TESTS FOR Deferred Formatting
+ *----------------------------------------------------------------------------*/
+
+void test_deferred_numbers_and_specs()
+{
+    LOG_INFO("int={} hex=0x{:04X} float={:.2f} bool={} char={}", -42, 0xBEEF, 3.14159, true, 'z');
+    LOG_FLUSH();
+
+    TEST_ASSERT_NOT_NULL(strstr(gStream.str().c_str(), "int=-42 hex=0xBEEF float=3.14 bool=true char=z"));
+}
+
+void test_deferred_strings_are_copied()
+{
+    char buffer[16] = "before";
+    std::string text = "owned";
+
+    LOG_INFO("{} {} {}", buffer, text, String("arduino"));
+    strcpy(buffer, "after");
+    text.assign("changed");
+    LOG_FLUSH();
+
+    std::string out = gStream.str();
+    TEST_ASSERT_NOT_NULL(strstr(out.c_str(), "before owned arduino"));
+    TEST_ASSERT_NULL(strstr(out.c_str(), "after"));
+}
+
+void test_deferred_non_copyable_args_formatted_eagerly()
+{
+    std::vector<int> values = {1, 2, 3};
+
+    LOG_INFO("values={}", values);
+    values.clear();
+    LOG_FLUSH();
+
+    TEST_ASSERT_NOT_NULL(strstr(gStream.str().c_str(), "values=[1, 2, 3]"));
+}
+
+void test_deferred_pointer_structs_formatted_eagerly()
+{
+    std::unique_ptr<int> value(new int(1234));
+
+    LOG_INFO("reading={}", Reading{value.get()});
+    value.reset();
+    LOG_FLUSH();
+
+    TEST_ASSERT_NOT_NULL(strstr(gStream.str().c_str(), "reading=1234"));
+}
+
+void test_deferred_runtime_format_formatted_eagerly()
+{
+    std::string format = "runtime {}";
+
+    LOG_INFO(fmt::runtime(format), 7);
+    format.assign("overwritten {}");
+    LOG_FLUSH();
+
+    std::string out = gStream.str();
+    TEST_ASSERT_NOT_NULL(strstr(out.c_str(), "runtime 7"));
+    TEST_ASSERT_NULL(strstr(out.c_str(), "overwritten"));
+}
+
+void test_deferred_preamble_rendered_on_drain()
+{
+    LOG_WARN("With preamble");
+    LOG_FLUSH();
+
+    std::string out = gStream.str();
+    TEST_ASSERT_TRUE_MESSAGE(out.find("[WARN][test_async_deferred] With preamble" LOG_EOL) == 0, out.c_str());
+}
+
+void test_deferred_large_args_fall_back()
+{
+    std::string payload(LOG_ASYNC_RECORD_SIZE / 2, 'Y');
+
+    LOG_INFO("{}{}", payload, payload);
+    LOG_FLUSH();
+
+    TEST_ASSERT_NOT_NULL(strstr(gStream.str().c_str(), "YYYY"));
+}
+
+/*------------------------------------------------------------------------------
+ * SETUP AND TEST RUNNER
+ *----------------------------------------------------------------------------*/
+
+void setUp(void)
+{
+    LOG_FLUSH();
+    gStream.clear();
+}
+
+void tearDown(void)
+{
+}
+
+void tests()
+{
+    RUN_TEST(test_deferred_numbers_and_specs);
+    RUN_TEST(test_deferred_strings_are_copied);
+    RUN_TEST(test_deferred_non_copyable_args_formatted_eagerly);
+    RUN_TEST(test_deferred_pointer_structs_formatted_eagerly);
+    RUN_TEST(test_deferred_runtime_format_formatted_eagerly);
+    RUN_TEST(test_deferred_preamble_rendered_on_drain);
+    RUN_TEST(test_deferred_large_args_fall_back);
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs if board doesn't support software reset via Serial.DTR/RTS
+    delay(4000);
+
+    UNITY_BEGIN();
+    tests();
+    UNITY_END();
+}
+
+void loop()
+{
+}
@@ -0,0 +1,106 @@
+// More information about PlatformIO Unit Testing:
+// https://docs.platformio.org/en/latest/advanced/unit-testing/index.html
+
+#include <Arduino.h>
+#include <string>
+#include <vector>
+#include <cstring>
+#include "unity.h"
+
+#define TEST_COUNT_ALLOCATIONS
+#include "../shared/TestSupport.h"
+
+TestStream gStream;
+
+#define LOG_STREAM gStream
+#define LOG_LEVEL LOG_LEVEL_TRACE
+#define LOG_COLOR LOG_COLOR_DISABLE
+#define LOG_TIME LOG_TIME_DISABLE
+#define LOG_FILENAME LOG_FILENAME_DISABLE
+
+#define LOG_STATIC_BUFFER_SIZE 32
+#define LOG_CHUNKED_ENABLE 1
+#define LOG_MESSAGE_MAX_SIZE 200
+
+#include "FormatLog.h"
+
+/*------------------------------------------------------------------------------
+ * TESTS FOR Chunked Messages
+ *----------------------------------------------------------------------------*/
+
+void test_chunked_short_message_one_write()
+{
+    LOG_INFO("Boot {}", 1);
+    TEST_ASSERT_EQUAL_STRING("[INFO] Boot 1" LOG_EOL, gStream.c_str());
+    TEST_ASSERT_EQUAL_UINT(1, gStream.writes);
+}
+
+void test_chunked_long_message_in_chunks()
+{
+    std::vector<int> samples;
+    for (int i = 0; i < 40; ++i)
+        samples.push_back(i);
+    std::string expected = "[DBUG] Samples " + fmt::format("{}", samples) + LOG_EOL;
+    gStream.clear();
+
+    size_t allocations = gAllocations;
+    LOG_DEBUG("Samples {}", samples);
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(0, (unsigned int)(gAllocations - allocations), "Chunked messages should not allocate");
+    TEST_ASSERT_EQUAL_STRING(expected.c_str(), gStream.c_str());
+    TEST_ASSERT_TRUE(gStream.writes > 2);
+    TEST_ASSERT_TRUE(gStream.largestWrite <= LOG_STATIC_BUFFER_SIZE);
+}
+
+void test_chunked_message_truncated_at_limit()
+{
+    std::string text(300, 'x');
+    std::string expected = "[WARN] " + std::string(LOG_MESSAGE_MAX_SIZE, 'x') + "...[truncated 100 bytes]" + LOG_EOL;
+    gStream.clear();
+
+    LOG_WARN("{}", text.c_str());
+    TEST_ASSERT_EQUAL_STRING(expected.c_str(), gStream.c_str());
+}
+
+void test_chunked_line_after_long_message()
+{
+    std::string text(100, 'y');
+    LOG_INFO("{}", text.c_str());
+    gStream.clear();
+    LOG_ERROR("Next");
+    TEST_ASSERT_EQUAL_STRING("[EROR] Next" LOG_EOL, gStream.c_str());
+}
+
+/*------------------------------------------------------------------------------
+ * SETUP AND TEST RUNNER
+ *----------------------------------------------------------------------------*/
+
+void setUp(void)
+{
+    gStream.clear();
+}
+
+void tearDown(void)
+{
+}
+
+void tests()
+{
+    RUN_TEST(test_chunked_short_message_one_write);
+    RUN_TEST(test_chunked_long_message_in_chunks);
+    RUN_TEST(test_chunked_message_truncated_at_limit);
+    RUN_TEST(test_chunked_line_after_long_message);
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs if board doesn't support software reset via Serial.DTR/RTS
+    delay(4000);
+
+    UNITY_BEGIN();
+    tests();
+    UNITY_END();
+}
+
+void loop()
+{
+}
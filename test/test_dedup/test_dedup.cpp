@@ -0,0 +1,140 @@
+// More information about PlatformIO Unit Testing:
+// https://docs.platformio.org/en/latest/advanced/unit-testing/index.html
+
+#include <Arduino.h>
+#include <string>
+#include <cstring>
+#include "unity.h"
+
+#include "../shared/TestSupport.h"
+
+TestStream gStream;
+
+#define LOG_STREAM gStream
+#define LOG_LEVEL LOG_LEVEL_TRACE
+#define LOG_COLOR LOG_COLOR_DISABLE
+#define LOG_TIME LOG_TIME_DISABLE
+#define LOG_FILENAME LOG_FILENAME_DISABLE
+
+#define LOG_DEDUP_ENABLE 1
+#define LOG_DEDUP_TIMEOUT_MS 100
+#define LOG_DEDUP_FORMAT "repeated {} times"
+
+#include "FormatLog.h"
+
+/*------------------------------------------------------------------------------
+ * TESTS FOR Duplicate Suppression
+ *----------------------------------------------------------------------------*/
+
+void test_dedup_repeats_summarized_on_next_message()
+{
+    for (int i = 0; i < 5; ++i)
+        LOG_WARN("Poll timeout {}", 3);
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(1, (unsigned int)gStream.writes, "Repeats should be held back");
+
+    LOG_INFO("Recovered");
+    TEST_ASSERT_EQUAL_STRING("[WARN] Poll timeout 3" LOG_EOL
+                             "[WARN] repeated 4 times" LOG_EOL
+                             "[INFO] Recovered" LOG_EOL,
+                             gStream.c_str());
+}
+
+void test_dedup_level_is_part_of_message()
+{
+    LOG_WARN("Same text");
+    LOG_ERROR("Same text");
+    TEST_ASSERT_EQUAL_STRING("[WARN] Same text" LOG_EOL "[EROR] Same text" LOG_EOL, gStream.c_str());
+}
+
+void test_dedup_hash_collision_not_held_back()
+{
+    // Same length and same FNV-1a hash at WARN, different text
+    LOG_WARN("Sensor 02c28c fault");
+    LOG_WARN("Sensor 0682f0 fault");
+    TEST_ASSERT_EQUAL_STRING("[WARN] Sensor 02c28c fault" LOG_EOL "[WARN] Sensor 0682f0 fault" LOG_EOL, gStream.c_str());
+}
+
+void test_dedup_summary_on_flush()
+{
+    LOG_DEBUG("Idle");
+    LOG_DEBUG("Idle");
+    LOG_DEBUG("Idle");
+    LOG_FLUSH();
+    TEST_ASSERT_EQUAL_STRING("[DBUG] Idle" LOG_EOL "[DBUG] repeated 2 times" LOG_EOL, gStream.c_str());
+
+    // Repeats after the flush are counted again from zero
+    gStream.clear();
+    LOG_DEBUG("Idle");
+    LOG_FLUSH();
+    TEST_ASSERT_EQUAL_STRING("[DBUG] repeated 1 times" LOG_EOL, gStream.c_str());
+}
+
+void test_dedup_timeout_writes_message_again()
+{
+    LOG_INFO("Waiting");
+    LOG_INFO("Waiting");
+    delay(LOG_DEDUP_TIMEOUT_MS + 20);
+    LOG_INFO("Waiting");
+    TEST_ASSERT_EQUAL_STRING("[INFO] Waiting" LOG_EOL
+                             "[INFO] repeated 1 times" LOG_EOL
+                             "[INFO] Waiting" LOG_EOL,
+                             gStream.c_str());
+}
+
+void test_dedup_per_output()
+{
+    TestStream warnings;
+    LOG_ADD_STREAM(warnings, fmtlog::LogLevel::WARN);
+
+    // The DEBUG lines break the sequence on the primary stream only
+    LOG_WARN("Link down");
+    LOG_DEBUG("Retrying");
+    LOG_WARN("Link down");
+    LOG_DEBUG("Retrying");
+    LOG_WARN("Link down");
+    TEST_ASSERT_EQUAL_UINT(5, (unsigned int)gStream.writes);
+    TEST_ASSERT_EQUAL_STRING("[WARN] Link down" LOG_EOL, warnings.c_str());
+
+    LOG_FLUSH();
+    TEST_ASSERT_EQUAL_STRING("[WARN] Link down" LOG_EOL "[WARN] repeated 2 times" LOG_EOL, warnings.c_str());
+    LOG_CLEAR_OUTPUTS();
+}
+
+/*------------------------------------------------------------------------------
+ * SETUP AND TEST RUNNER
+ *----------------------------------------------------------------------------*/
+
+void setUp(void)
+{
+    LOG_FLUSH();
+    LOG_INFO("Reset");
+    gStream.clear();
+}
+
+void tearDown(void)
+{
+}
+
+void tests()
+{
+    RUN_TEST(test_dedup_repeats_summarized_on_next_message);
+    RUN_TEST(test_dedup_level_is_part_of_message);
+    RUN_TEST(test_dedup_hash_collision_not_held_back);
+    RUN_TEST(test_dedup_summary_on_flush);
+    RUN_TEST(test_dedup_timeout_writes_message_again);
+    RUN_TEST(test_dedup_per_output);
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs if board doesn't support software reset via Serial.DTR/RTS
+    delay(4000);
+
+    UNITY_BEGIN();
+    tests();
+    UNITY_END();
+}
+
+void loop()
+{
+}
@@ -0,0 +1,142 @@
+// More information about PlatformIO Unit Testing:
+// https://docs.platformio.org/en/latest/advanced/unit-testing/index.html
+
+#include <Arduino.h>
+#include <memory>
+#include <string>
+#include "unity.h"
+
+#define LOG_FILE_ENABLE 1
+#define LOG_FILE_PATH "/log.txt"
+#define LOG_FILE_ALIGN_WRITES 1
+
+#include <FormatLog.h>
+
+#include "../shared/MemoryFileManager.h"
+
+using Sink = fmtlog::RotatingFileSink<1024>;
+
+static const size_t SECTOR_SIZE = MemoryFileManager::SECTOR_SIZE;
+static const size_t LINES = 1000;
+
+std::shared_ptr<MemoryFileManager> gFiles;
+
+// Lines of varying length, so buffer writes fall anywhere in a sector
+std::string writeLines(fmtlog::IFileSink &sink, size_t count)
+{
+    std::string expected;
+    for (size_t i = 0; i < count; ++i)
+    {
+        std::string line = "reading " + std::to_string(i * 7919) + " status ok\r\n";
+        sink.write(line.data(), line.size());
+        expected += line;
+    }
+    return expected;
+}
+
+/*------------------------------------------------------------------------------
+ * Test Cases
+ *----------------------------------------------------------------------------*/
+
+void test_unaligned_writes_end_mid_sector()
+{
+    Sink sink(gFiles, "/log.txt", 3, 1024 * 1024, false);
+    sink.setAlignWrites(false);
+    sink.setFlushPolicy(fmtlog::FlushPolicy::explicitOnly());
+    writeLines(sink, LINES);
+
+    TEST_ASSERT_GREATER_THAN(gFiles->writes / 2, gFiles->partialSectorWrites);
+}
+
+void test_aligned_writes_whole_sectors()
+{
+    Sink sink(gFiles, "/log.txt", 3, 1024 * 1024, false);
+    sink.setFlushPolicy(fmtlog::FlushPolicy::explicitOnly());
+    std::string expected = writeLines(sink, LINES);
+
+    TEST_ASSERT_GREATER_THAN(0, gFiles->writes);
+    TEST_ASSERT_EQUAL_UINT(0, gFiles->partialSectorWrites);
+    TEST_ASSERT_EQUAL_UINT(0, gFiles->files["/log.txt"].size() % SECTOR_SIZE);
+
+    // The explicit flush writes the partial tail
+    sink.flush();
+    TEST_ASSERT_EQUAL_UINT(1, gFiles->partialSectorWrites);
+    TEST_ASSERT_EQUAL_STRING(expected.c_str(), gFiles->files["/log.txt"].c_str());
+}
+
+void test_existing_file_realigned()
+{
+    gFiles->files["/log.txt"] = std::string(100, '-');
+    Sink sink(gFiles, "/log.txt", 3, 1024 * 1024, false);
+    sink.setFlushPolicy(fmtlog::FlushPolicy::explicitOnly());
+    std::string expected = writeLines(sink, LINES);
+
+    // The first write is shorter, so the ones after it start on a sector boundary
+    TEST_ASSERT_EQUAL_UINT(0, gFiles->partialSectorWrites);
+
+    sink.close();
+    TEST_ASSERT_EQUAL_STRING((std::string(100, '-') + expected).c_str(), gFiles->files["/log.txt"].c_str());
+}
+
+void test_aligned_rotation_keeps_lines_whole()
+{
+    Sink sink(gFiles, "/log.txt", 50, 4096, false, fmtlog::FileRotation::SEGMENTS);
+    sink.setFlushPolicy(fmtlog::FlushPolicy::explicitOnly());
+    std::string expected = writeLines(sink, LINES);
+    sink.close();
+
+    std::string written;
+    for (auto &file : gFiles->files)
+    {
+        if (file.first == "/log.seq")
+            continue;
+        TEST_ASSERT_LESS_OR_EQUAL(4096, file.second.size());
+        TEST_ASSERT_EQUAL_STRING("\r\n", file.second.c_str() + file.second.size() - 2);
+        written += file.second;
+    }
+    TEST_ASSERT_EQUAL_STRING(expected.c_str(), written.c_str());
+}
+
+void test_buffer_smaller_than_sector_not_aligned()
+{
+    fmtlog::RotatingFileSink<256> sink(gFiles, "/log.txt", 3, 1024 * 1024, false);
+    sink.setFlushPolicy(fmtlog::FlushPolicy::explicitOnly());
+    std::string expected = writeLines(sink, 100);
+    sink.flush();
+
+    TEST_ASSERT_GREATER_THAN(0, gFiles->partialSectorWrites);
+    TEST_ASSERT_EQUAL_STRING(expected.c_str(), gFiles->files["/log.txt"].c_str());
+}
+
+void setUp(void)
+{
+    gFiles = std::make_shared<MemoryFileManager>();
+}
+
+void tearDown(void)
+{
+    gFiles.reset();
+}
+
+void tests()
+{
+    RUN_TEST(test_unaligned_writes_end_mid_sector);
+    RUN_TEST(test_aligned_writes_whole_sectors);
+    RUN_TEST(test_existing_file_realigned);
+    RUN_TEST(test_aligned_rotation_keeps_lines_whole);
+    RUN_TEST(test_buffer_smaller_than_sector_not_aligned);
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs if board doesn't support software reset via Serial.DTR/RTS
+    delay(4000);
+
+    UNITY_BEGIN();
+    tests();
+    UNITY_END();
+}
+
+void loop()
+{
+}
@@ -0,0 +1,179 @@
+// More information about PlatformIO Unit Testing:
+// https://docs.platformio.org/en/latest/advanced/unit-testing/index.html
+
+#include <Arduino.h>
+#include <memory>
+#include <string>
+#include "unity.h"
+
+#define LOG_LEVEL LOG_LEVEL_TRACE
+#define LOG_COLOR LOG_COLOR_DISABLE
+#define LOG_TIME LOG_TIME_DISABLE
+#define LOG_FILENAME LOG_FILENAME_DISABLE
+
+#define LOG_FILE_ENABLE 1
+#define LOG_FILE_LEVEL LOG_LEVEL_TRACE
+#define LOG_FILE_PATH "/log.txt"
+#define LOG_FILE_BACKGROUND 1
+
+#include <FormatLog.h>
+
+#include "../shared/MemoryFileManager.h"
+
+using Sink = fmtlog::BackgroundFileSink<256, 2>;
+
+static const uint32_t SLOW_WRITE_MS = 50;
+static const char LINE[] = "0123456789012345678901234567890123456\r\n"; // 39 bytes with EOL
+static const size_t LINE_SIZE = sizeof(LINE) - 1;
+static const size_t LINES_PER_BUFFER = 256 / LINE_SIZE;
+
+std::shared_ptr<MemoryFileManager> gFiles;
+
+void writeLines(Sink &sink, size_t count, fmtlog::LogLevel level = fmtlog::LogLevel::INFO)
+{
+    for (size_t i = 0; i < count; ++i)
+        sink.writeLine(LINE, LINE_SIZE, level);
+}
+
+/*------------------------------------------------------------------------------
+ * Test Cases
+ *----------------------------------------------------------------------------*/
+
+void test_lines_written_in_order()
+{
+    Sink sink(gFiles, "/log.txt", 3, 1024 * 1024, false);
+    std::string expected;
+    for (int i = 0; i < 100; ++i)
+    {
+        std::string line = "line " + std::to_string(i) + "\r\n";
+        sink.writeLine(line.data(), line.size(), fmtlog::LogLevel::INFO);
+        expected += line;
+    }
+    sink.flush();
+
+    TEST_ASSERT_EQUAL_STRING(expected.c_str(), gFiles->files["/log.txt"].c_str());
+}
+
+void test_slow_write_runs_on_task()
+{
+    gFiles->writeDelayMs = SLOW_WRITE_MS;
+    Sink sink(gFiles, "/log.txt", 3, 1024 * 1024, false);
+    writeLines(sink, LINES_PER_BUFFER);
+
+    // This line fills the first buffer, which is handed over without waiting for the write
+    uint32_t start = millis();
+    writeLines(sink, 1);
+    uint32_t elapsed = millis() - start;
+
+    TEST_ASSERT_LESS_THAN(SLOW_WRITE_MS / 2, elapsed);
+    TEST_ASSERT_EQUAL_UINT(0, sink.getBlockedCount());
+
+    sink.flush();
+    TEST_ASSERT_EQUAL_UINT((LINES_PER_BUFFER + 1) * LINE_SIZE, gFiles->files["/log.txt"].size());
+}
+
+void test_blocks_when_every_buffer_in_flight()
+{
+    gFiles->writeDelayMs = SLOW_WRITE_MS;
+    Sink sink(gFiles, "/log.txt", 3, 1024 * 1024, false);
+
+    // One buffer is written while the other fills up, the third one has to wait
+    writeLines(sink, 3 * LINES_PER_BUFFER + 1);
+
+    TEST_ASSERT_GREATER_OR_EQUAL(1, sink.getBlockedCount());
+    TEST_ASSERT_GREATER_THAN(0, sink.getBlockedMicros());
+
+    sink.flush();
+    TEST_ASSERT_EQUAL_UINT((3 * LINES_PER_BUFFER + 1) * LINE_SIZE, gFiles->files["/log.txt"].size());
+}
+
+void test_rotation_on_task()
+{
+    Sink sink(gFiles, "/log.txt", 3, 1024, false, fmtlog::FileRotation::SEGMENTS);
+    writeLines(sink, 200);
+    sink.flush();
+
+    // 34 buffers of up to 6 lines, four to a file, the last 3 rotated files kept
+    TEST_ASSERT_EQUAL_STRING("/log.000008.txt", sink.getActivePath().c_str());
+    TEST_ASSERT_TRUE(gFiles->files.count("/log.000004.txt") == 0);
+    TEST_ASSERT_EQUAL_UINT(4 * LINES_PER_BUFFER * LINE_SIZE, gFiles->files["/log.000005.txt"].size());
+}
+
+void test_flush_policy_hands_buffer_over()
+{
+    Sink sink(gFiles, "/log.txt", 3, 1024 * 1024, false);
+    sink.setFlushPolicy(fmtlog::FlushPolicy::atLevel(fmtlog::LogLevel::ERROR));
+
+    writeLines(sink, 2);
+    writeLines(sink, 1, fmtlog::LogLevel::ERROR);
+
+    // The task writes and flushes the partly filled buffer without an explicit flush
+    uint32_t start = millis();
+    while (sink.getFlushCount() == 0 && millis() - start < 1000)
+        delay(1);
+
+    TEST_ASSERT_EQUAL_UINT(1, sink.getFlushCount());
+    TEST_ASSERT_EQUAL_UINT(3 * LINE_SIZE, gFiles->files["/log.txt"].size());
+}
+
+void test_long_line_written_after_buffers()
+{
+    Sink sink(gFiles, "/log.txt", 3, 1024 * 1024, false);
+    std::string longLine(600, 'x');
+    longLine += "\r\n";
+
+    writeLines(sink, 2);
+    sink.writeLine(longLine.data(), longLine.size(), fmtlog::LogLevel::INFO);
+    writeLines(sink, 1);
+    sink.flush();
+
+    std::string expected = std::string(LINE) + LINE + longLine + LINE;
+    TEST_ASSERT_EQUAL_STRING(expected.c_str(), gFiles->files["/log.txt"].c_str());
+}
+
+void test_logger_uses_background_sink()
+{
+    FmtLog.setFileStorage(std::make_shared<Sink>(gFiles, "/log.txt", 3, 1024 * 1024, false));
+
+    LOG_INFO("Queued");
+    LOG_FLUSH_FILE();
+
+    TEST_ASSERT_TRUE(gFiles->files["/log.txt"].find("Queued") != std::string::npos);
+    TEST_ASSERT_EQUAL_UINT(0, LOG_GET_FILE_BLOCKED_COUNT());
+    FmtLog.setFileStorage(nullptr);
+}
+
+void setUp(void)
+{
+    gFiles = std::make_shared<MemoryFileManager>();
+}
+
+void tearDown(void)
+{
+    gFiles.reset();
+}
+
+void tests()
+{
+    RUN_TEST(test_lines_written_in_order);
+    RUN_TEST(test_slow_write_runs_on_task);
+    RUN_TEST(test_blocks_when_every_buffer_in_flight);
+    RUN_TEST(test_rotation_on_task);
+    RUN_TEST(test_flush_policy_hands_buffer_over);
+    RUN_TEST(test_long_line_written_after_buffers);
+    RUN_TEST(test_logger_uses_background_sink);
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs if board doesn't support software reset via Serial.DTR/RTS
+    delay(4000);
+
+    UNITY_BEGIN();
+    tests();
+    UNITY_END();
+}
+
+void loop()
+{
+}
@@ -0,0 +1,203 @@
+// More information about PlatformIO Unit Testing:
+// https://docs.platformio.org/en/latest/advanced/unit-testing/index.html
+
+#include <Arduino.h>
+#include <memory>
+#include <string>
+#include "unity.h"
+
+#define LOG_LEVEL LOG_LEVEL_TRACE
+#define LOG_COLOR LOG_COLOR_DISABLE
+#define LOG_TIME LOG_TIME_DISABLE
+#define LOG_FILENAME LOG_FILENAME_DISABLE
+
+#define LOG_FILE_ENABLE 1
+#define LOG_FILE_LEVEL LOG_LEVEL_TRACE
+#define LOG_FILE_PATH "/log.txt"
+
+#include <FormatLog.h>
+
+#include "../shared/MemoryFileManager.h"
+
+/*------------------------------------------------------------------------------
+ * Test Stream to keep the serial output out of the way
+ *----------------------------------------------------------------------------*/
+
+class NullStream : public Stream
+{
+public:
+    size_t write(uint8_t) override { return 1; }
+    size_t write(const uint8_t *, size_t size) override { return size; }
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    void flush() override {}
+};
+
+NullStream gStream;
+
+using Sink = fmtlog::RotatingFileSink<512>;
+
+static const size_t LINES = 600;
+static const size_t ERROR_EVERY = 100; // One ERROR line per 100, the others INFO
+static const char LINE[] = "[INFO] sensor 3 reading 1234 status 0x2A queue 17 of 64\r\n";
+static const size_t LINE_SIZE = sizeof(LINE) - 1;
+
+std::shared_ptr<MemoryFileManager> gFiles;
+
+struct Result
+{
+    size_t flushes;
+    size_t deviceBytes;
+};
+
+// Logs the same workload through a sink with the given policy, then closes it
+Result runWorkload(const char *name, const fmtlog::FlushPolicy &policy, uint32_t delayMs = 0)
+{
+    gFiles = std::make_shared<MemoryFileManager>();
+    {
+        Sink sink(gFiles, "/log.txt", 3, 1024 * 1024, false);
+        sink.setFlushPolicy(policy);
+
+        for (size_t i = 1; i <= LINES; ++i)
+        {
+            fmtlog::LogLevel level = i % ERROR_EVERY == 0 ? fmtlog::LogLevel::ERROR : fmtlog::LogLevel::INFO;
+            sink.writeLine(LINE, LINE_SIZE, level);
+            if (delayMs > 0)
+                delay(delayMs);
+        }
+    }
+
+    Result result;
+    result.flushes = gFiles->flushes;
+    result.deviceBytes = gFiles->deviceBytes;
+
+    char message[160];
+    snprintf(message, sizeof(message), "%-14s logged %6u B, %3u writes, %3u flushes, device wrote %6u B",
+             name, static_cast<unsigned>(gFiles->bytesWritten), static_cast<unsigned>(gFiles->writes),
+             static_cast<unsigned>(result.flushes), static_cast<unsigned>(result.deviceBytes));
+    TEST_MESSAGE(message);
+    return result;
+}
+
+/*------------------------------------------------------------------------------
+ * Test Cases
+ *----------------------------------------------------------------------------*/
+
+void test_flush_every_write()
+{
+    Result result = runWorkload("every write", fmtlog::FlushPolicy::everyWrite());
+
+    // Same as before policies existed: every buffer drain is flushed
+    TEST_ASSERT_EQUAL_UINT(gFiles->writes, result.flushes);
+}
+
+void test_flush_explicit_only()
+{
+    Result everyWrite = runWorkload("every write", fmtlog::FlushPolicy::everyWrite());
+    Result result = runWorkload("explicit only", fmtlog::FlushPolicy::explicitOnly());
+
+    // Only the one on close
+    TEST_ASSERT_EQUAL_UINT(1, result.flushes);
+    TEST_ASSERT_EQUAL_UINT(LINES * LINE_SIZE, gFiles->files["/log.txt"].size());
+    TEST_ASSERT_LESS_THAN(everyWrite.deviceBytes, result.deviceBytes);
+}
+
+void test_flush_every_bytes()
+{
+    Result result = runWorkload("every 4096 B", fmtlog::FlushPolicy::everyBytes(4096));
+
+    // Plus the one on close for the rest
+    TEST_ASSERT_EQUAL_UINT(LINES * LINE_SIZE / 4096 + 1, result.flushes);
+}
+
+void test_flush_at_level()
+{
+    Result result = runWorkload("at ERROR", fmtlog::FlushPolicy::atLevel(fmtlog::LogLevel::ERROR));
+
+    // Each ERROR line is on the file right after it is logged, the last line is one of them
+    TEST_ASSERT_EQUAL_UINT(LINES / ERROR_EVERY, result.flushes);
+}
+
+void test_flush_every_ms()
+{
+    Result result = runWorkload("every 100 ms", fmtlog::FlushPolicy::everyMs(100), 1);
+
+    // At least 600 ms of logging
+    TEST_ASSERT_GREATER_OR_EQUAL(5, result.flushes);
+    TEST_ASSERT_LESS_OR_EQUAL(LINES / 100 + 2, result.flushes);
+}
+
+void test_simple_sink_policy()
+{
+    gFiles = std::make_shared<MemoryFileManager>();
+    fmtlog::SimpleFileSink sink(gFiles, "/log.txt");
+    for (size_t i = 0; i < 10; ++i)
+        sink.writeLine(LINE, LINE_SIZE, fmtlog::LogLevel::INFO);
+    TEST_ASSERT_EQUAL_UINT(10, sink.getFlushCount());
+
+    sink.setFlushPolicy(fmtlog::FlushPolicy::everyBytes(LINE_SIZE * 5));
+    for (size_t i = 0; i < 10; ++i)
+        sink.writeLine(LINE, LINE_SIZE, fmtlog::LogLevel::INFO);
+    TEST_ASSERT_EQUAL_UINT(12, sink.getFlushCount());
+    TEST_ASSERT_EQUAL_UINT(20, gFiles->writes);
+}
+
+void test_logger_passes_level_to_sink()
+{
+    gFiles = std::make_shared<MemoryFileManager>();
+    FmtLog.setFileStorage(std::make_shared<Sink>(gFiles, "/log.txt", 3, 1024 * 1024, false));
+    LOG_SET_FILE_FLUSH_POLICY(fmtlog::FlushPolicy::atLevel(fmtlog::LogLevel::WARN));
+
+    LOG_INFO("Buffered");
+    LOG_DEBUG("Buffered too");
+    TEST_ASSERT_EQUAL_UINT(0, LOG_GET_FILE_FLUSH_COUNT());
+    TEST_ASSERT_EQUAL_UINT(0, gFiles->files["/log.txt"].size());
+
+    LOG_WARN("Flushed");
+    TEST_ASSERT_EQUAL_UINT(1, LOG_GET_FILE_FLUSH_COUNT());
+    TEST_ASSERT_TRUE(gFiles->files["/log.txt"].find("Flushed") != std::string::npos);
+
+    // Raw prints have no level
+    LOG_PRINTLN_FILE("Printed");
+    TEST_ASSERT_EQUAL_UINT(1, LOG_GET_FILE_FLUSH_COUNT());
+
+    LOG_FLUSH_FILE();
+    TEST_ASSERT_EQUAL_UINT(2, LOG_GET_FILE_FLUSH_COUNT());
+    FmtLog.setFileStorage(nullptr);
+}
+
+void setUp(void)
+{
+    FmtLog.setSerial(gStream);
+}
+
+void tearDown(void)
+{
+    gFiles.reset();
+}
+
+void tests()
+{
+    RUN_TEST(test_flush_every_write);
+    RUN_TEST(test_flush_explicit_only);
+    RUN_TEST(test_flush_every_bytes);
+    RUN_TEST(test_flush_at_level);
+    RUN_TEST(test_flush_every_ms);
+    RUN_TEST(test_simple_sink_policy);
+    RUN_TEST(test_logger_passes_level_to_sink);
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs if board doesn't support software reset via Serial.DTR/RTS
+    delay(4000);
+
+    UNITY_BEGIN();
+    tests();
+    UNITY_END();
+}
+
+void loop()
+{
+}
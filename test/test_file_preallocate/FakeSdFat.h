@@ -0,0 +1,151 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Minimal stand-in for an SdFat volume (integer open flags, preAllocate() and truncate()) that
+ * counts FAT allocations: one for every cluster a write adds to a file, one for each contiguous
+ * preAllocate().
+ */
+class FakeSdFat
+{
+public:
+    static const size_t CLUSTER_SIZE = 4096;
+
+    struct Entry
+    {
+        std::string data;
+        size_t clusters = 0;
+    };
+
+    std::map<std::string, Entry> files;
+    size_t allocations = 0;
+    size_t truncates = 0;
+
+    static size_t clustersFor(size_t size)
+    {
+        return (size + CLUSTER_SIZE - 1) / CLUSTER_SIZE;
+    }
+
+    class File
+    {
+    private:
+        FakeSdFat *_fs = nullptr;
+        std::string _path;
+        size_t _position = 0;
+        bool _append = false;
+
+        Entry &entry()
+        {
+            return _fs->files[_path];
+        }
+
+    public:
+        File() = default;
+        File(FakeSdFat *fs, const char *path, bool append) : _fs(fs), _path(path), _append(append) {}
+
+        explicit operator bool() const
+        {
+            return _fs != nullptr;
+        }
+
+        size_t write(const uint8_t *data, size_t size)
+        {
+            Entry &file = entry();
+            if (_append)
+                _position = file.data.size();
+            if (_position + size > file.data.size())
+                file.data.resize(_position + size);
+            file.data.replace(_position, size, reinterpret_cast<const char *>(data), size);
+            _position += size;
+
+            size_t needed = clustersFor(file.data.size());
+            if (needed > file.clusters)
+            {
+                _fs->allocations += needed - file.clusters;
+                file.clusters = needed;
+            }
+            return size;
+        }
+
+        int read(void *data, size_t size)
+        {
+            size_t read = entry().data.copy(static_cast<char *>(data), size, _position);
+            _position += read;
+            return static_cast<int>(read);
+        }
+
+        void flush() {}
+
+        void close()
+        {
+            _fs = nullptr;
+        }
+
+        size_t size()
+        {
+            return entry().data.size();
+        }
+
+        bool preAllocate(uint64_t length)
+        {
+            Entry &file = entry();
+            if (length == 0 || file.clusters != 0)
+                return false;
+            file.data.assign(static_cast<size_t>(length), '\0');
+            file.clusters = clustersFor(file.data.size());
+            ++_fs->allocations;
+            return true;
+        }
+
+        bool truncate(uint64_t length)
+        {
+            Entry &file = entry();
+            file.data.resize(static_cast<size_t>(length));
+            file.clusters = clustersFor(file.data.size());
+            ++_fs->truncates;
+            return true;
+        }
+    };
+
+    // SdFat flags
+    static const int O_CREAT_FLAG = 0x0200;
+    static const int O_APPEND_FLAG = 0x0008;
+    static const int O_TRUNC_FLAG = 0x0400;
+
+    File open(const char *path, int flags = 0)
+    {
+        if (files.count(path) == 0)
+        {
+            if (!(flags & O_CREAT_FLAG))
+                return File();
+            files[path];
+        }
+        if (flags & O_TRUNC_FLAG)
+            files[path] = Entry();
+        return File(this, path, (flags & O_APPEND_FLAG) != 0);
+    }
+
+    bool exists(const char *path)
+    {
+        return files.count(path) != 0;
+    }
+
+    bool remove(const char *path)
+    {
+        return files.erase(path) != 0;
+    }
+
+    bool rename(const char *oldPath, const char *newPath)
+    {
+        auto it = files.find(oldPath);
+        if (it == files.end())
+            return false;
+        files[newPath] = it->second;
+        files.erase(oldPath);
+        return true;
+    }
+};
@@ -0,0 +1,149 @@
+// More information about PlatformIO Unit Testing:
+// https://docs.platformio.org/en/latest/advanced/unit-testing/index.html
+
+#include <Arduino.h>
+#include <memory>
+#include <string>
+#include "unity.h"
+
+#define LOG_FILE_ENABLE 1
+#define LOG_FILE_PATH "/log.txt"
+#define LOG_FILE_PREALLOCATE 1
+
+#include <FormatLog.h>
+
+#include "FakeSdFat.h"
+
+using Sink = fmtlog::RotatingFileSink<512>;
+
+static const size_t MAX_FILE_SIZE = 64 * 1024;
+static const char LINE[] = "01234567890123456789012345678901234567890123456789012345678901\r\n"; // 64 bytes with EOL
+static const size_t LINE_SIZE = sizeof(LINE) - 1;
+
+FakeSdFat gFs;
+
+void writeLines(Sink &sink, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+        sink.write(LINE, LINE_SIZE);
+}
+
+/*------------------------------------------------------------------------------
+ * Test Cases
+ *----------------------------------------------------------------------------*/
+
+void test_appends_allocate_clusters()
+{
+    Sink sink(fmtlog::createFileManager(gFs), "/log.txt", 3, MAX_FILE_SIZE, false);
+    sink.setPreallocate(false);
+    writeLines(sink, 1000);
+    sink.flush();
+
+    // Every 4 KB cluster is allocated by a write
+    TEST_ASSERT_EQUAL_UINT(FakeSdFat::clustersFor(1000 * LINE_SIZE), gFs.allocations);
+}
+
+void test_preallocated_file_allocates_once()
+{
+    Sink sink(fmtlog::createFileManager(gFs), "/log.txt", 3, MAX_FILE_SIZE, false);
+    writeLines(sink, 1000);
+    sink.flush();
+
+    TEST_ASSERT_EQUAL_UINT(1, gFs.allocations);
+    TEST_ASSERT_EQUAL_UINT(MAX_FILE_SIZE, gFs.files["/log.txt"].data.size());
+
+    // Cut back to the written lines on close
+    sink.close();
+    TEST_ASSERT_EQUAL_UINT(1000 * LINE_SIZE, gFs.files["/log.txt"].data.size());
+    TEST_ASSERT_EQUAL_UINT(1, gFs.truncates);
+    TEST_ASSERT_EQUAL_STRING_LEN(LINE, gFs.files["/log.txt"].data.c_str() + 999 * LINE_SIZE, LINE_SIZE);
+}
+
+void test_each_segment_preallocated()
+{
+    Sink sink(fmtlog::createFileManager(gFs), "/log.txt", 5, MAX_FILE_SIZE, false, fmtlog::FileRotation::SEGMENTS);
+    size_t linesPerFile = MAX_FILE_SIZE / LINE_SIZE;
+    writeLines(sink, 3 * linesPerFile + 1);
+    sink.close();
+
+    // One allocation per segment, whatever was written to it, plus log.seq rewritten on each rotation
+    TEST_ASSERT_EQUAL_UINT(4 + 3, gFs.allocations);
+    for (int i = 0; i < 3; ++i)
+    {
+        std::string &data = gFs.files[fmt::format("/log.{:06}.txt", i)].data;
+        TEST_ASSERT_LESS_OR_EQUAL(MAX_FILE_SIZE, data.size());
+        TEST_ASSERT_EQUAL_UINT(0, data.size() % LINE_SIZE);
+        TEST_ASSERT_TRUE(data.find('\0') == std::string::npos);
+    }
+}
+
+void test_file_manager_tracks_end_of_data()
+{
+    auto fileManager = fmtlog::createFileManager(gFs);
+    TEST_ASSERT_TRUE(fileManager->open("/a.txt"));
+    TEST_ASSERT_TRUE(fileManager->preallocate(8192));
+    fileManager->write("abc", 3);
+    fileManager->write("def", 3);
+    TEST_ASSERT_EQUAL_UINT(6, fileManager->size());
+    fileManager->close();
+    TEST_ASSERT_EQUAL_STRING("abcdef", gFs.files["/a.txt"].data.c_str());
+
+    // An existing file is appended to as before
+    TEST_ASSERT_TRUE(fileManager->open("/a.txt"));
+    TEST_ASSERT_FALSE(fileManager->preallocate(8192));
+    fileManager->write("ghi", 3);
+    fileManager->close();
+    TEST_ASSERT_EQUAL_STRING("abcdefghi", gFs.files["/a.txt"].data.c_str());
+}
+
+void test_unclosed_file_rotated_on_reopen()
+{
+    FakeSdFat::Entry powerLoss;
+    {
+        Sink sink(fmtlog::createFileManager(gFs), "/log.txt", 3, MAX_FILE_SIZE, false);
+        writeLines(sink, 10);
+        sink.flush();
+        powerLoss = gFs.files["/log.txt"];
+    }
+    gFs.files["/log.txt"] = powerLoss;
+
+    // The file was left at its preallocated size, so the next line starts a new one
+    Sink sink(fmtlog::createFileManager(gFs), "/log.txt", 3, MAX_FILE_SIZE, false);
+    writeLines(sink, 1);
+    sink.close();
+
+    TEST_ASSERT_EQUAL_UINT(MAX_FILE_SIZE, gFs.files["/log.1.txt"].data.size());
+    TEST_ASSERT_EQUAL_UINT(LINE_SIZE, gFs.files["/log.txt"].data.size());
+}
+
+void setUp(void)
+{
+    gFs = FakeSdFat();
+}
+
+void tearDown(void)
+{
+}
+
+void tests()
+{
+    RUN_TEST(test_appends_allocate_clusters);
+    RUN_TEST(test_preallocated_file_allocates_once);
+    RUN_TEST(test_each_segment_preallocated);
+    RUN_TEST(test_file_manager_tracks_end_of_data);
+    RUN_TEST(test_unclosed_file_rotated_on_reopen);
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs if board doesn't support software reset via Serial.DTR/RTS
+    delay(4000);
+
+    UNITY_BEGIN();
+    tests();
+    UNITY_END();
+}
+
+void loop()
+{
+}
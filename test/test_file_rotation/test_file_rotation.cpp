@@ -0,0 +1,180 @@
+// More information about PlatformIO Unit Testing:
+// https://docs.platformio.org/en/latest/advanced/unit-testing/index.html
+
+#include <Arduino.h>
+#include <memory>
+#include <string>
+#include "unity.h"
+
+#define LOG_FILE_ENABLE 1
+#define LOG_FILE_PATH "/log.txt"
+
+#include <FormatLog.h>
+
+#include "../shared/MemoryFileManager.h"
+
+using Sink = fmtlog::RotatingFileSink<64>;
+
+static const size_t MAX_FILE_SIZE = 256;
+static const char LINE[] = "0123456789012345678901234567890123456\r\n"; // 40 bytes with EOL
+
+std::shared_ptr<MemoryFileManager> gFiles;
+
+// Writes enough lines to rotate the given number of times
+void writeRotations(Sink &sink, size_t rotations)
+{
+    size_t lines = rotations * (MAX_FILE_SIZE / (sizeof(LINE) - 1)) + 1;
+    for (size_t i = 0; i < lines; ++i)
+    {
+        sink.write(LINE, sizeof(LINE) - 1);
+        sink.flush();
+    }
+}
+
+/*------------------------------------------------------------------------------
+ * Test Cases
+ *----------------------------------------------------------------------------*/
+
+void test_segments_are_numbered()
+{
+    Sink sink(gFiles, "/log.txt", 3, MAX_FILE_SIZE, false, fmtlog::FileRotation::SEGMENTS);
+    writeRotations(sink, 5);
+
+    // The current segment plus the 3 before it, the oldest ones removed
+    TEST_ASSERT_EQUAL_STRING("/log.000005.txt", sink.getActivePath().c_str());
+    TEST_ASSERT_TRUE(gFiles->files.count("/log.000005.txt") != 0);
+    TEST_ASSERT_TRUE(gFiles->files.count("/log.000002.txt") != 0);
+    TEST_ASSERT_TRUE(gFiles->files.count("/log.000001.txt") == 0);
+    TEST_ASSERT_TRUE(gFiles->files.count("/log.000000.txt") == 0);
+    TEST_ASSERT_TRUE(gFiles->files.count("/log.txt") == 0);
+    TEST_ASSERT_EQUAL_STRING("5 2\n", gFiles->files["/log.seq"].c_str());
+
+    // Full segments keep their content, each at most the maximum size
+    TEST_ASSERT_LESS_OR_EQUAL(MAX_FILE_SIZE, gFiles->files["/log.000003.txt"].size());
+    TEST_ASSERT_GREATER_THAN(MAX_FILE_SIZE / 2, gFiles->files["/log.000003.txt"].size());
+}
+
+void test_segment_rotation_is_constant_time()
+{
+    Sink sink(gFiles, "/log.txt", 50, MAX_FILE_SIZE, false, fmtlog::FileRotation::SEGMENTS);
+    writeRotations(sink, 60);
+
+    gFiles->resetCounters();
+    writeRotations(sink, 1);
+
+    // One segment removed and log.seq replaced, nothing probed, whatever the number of files kept
+    TEST_ASSERT_EQUAL_UINT(1, gFiles->removes);
+    TEST_ASSERT_EQUAL_UINT(1, gFiles->renames);
+    TEST_ASSERT_EQUAL_UINT(0, gFiles->existsCalls);
+}
+
+void test_rename_rotation_is_kept()
+{
+    Sink sink(gFiles, "/log.txt", 50, MAX_FILE_SIZE, false, fmtlog::FileRotation::RENAME);
+    writeRotations(sink, 60);
+
+    TEST_ASSERT_TRUE(gFiles->files.count("/log.txt") != 0);
+    TEST_ASSERT_TRUE(gFiles->files.count("/log.1.txt") != 0);
+    TEST_ASSERT_TRUE(gFiles->files.count("/log.50.txt") != 0);
+    TEST_ASSERT_TRUE(gFiles->files.count("/log.51.txt") == 0);
+
+    gFiles->resetCounters();
+    writeRotations(sink, 1);
+
+    // The cascade renames every older file
+    TEST_ASSERT_EQUAL_UINT(50, gFiles->renames);
+}
+
+void test_segments_continue_after_restart()
+{
+    {
+        Sink sink(gFiles, "/log.txt", 3, MAX_FILE_SIZE, false, fmtlog::FileRotation::SEGMENTS);
+        writeRotations(sink, 4);
+    }
+
+    Sink sink(gFiles, "/log.txt", 3, MAX_FILE_SIZE, true, fmtlog::FileRotation::SEGMENTS);
+    sink.write(LINE, sizeof(LINE) - 1);
+    sink.flush();
+
+    // New on boot: the last segment is left as it was and the next number starts
+    TEST_ASSERT_EQUAL_STRING("/log.000005.txt", sink.getActivePath().c_str());
+    TEST_ASSERT_EQUAL_UINT(sizeof(LINE) - 1, gFiles->files["/log.000005.txt"].size());
+    TEST_ASSERT_TRUE(gFiles->files.count("/log.000001.txt") == 0);
+    TEST_ASSERT_TRUE(gFiles->files.count("/log.000002.txt") != 0);
+}
+
+void test_segments_trimmed_when_max_files_lowered()
+{
+    {
+        Sink sink(gFiles, "/log.txt", 5, MAX_FILE_SIZE, false, fmtlog::FileRotation::SEGMENTS);
+        writeRotations(sink, 6);
+    }
+
+    Sink sink(gFiles, "/log.txt", 2, MAX_FILE_SIZE, false, fmtlog::FileRotation::SEGMENTS);
+    sink.write(LINE, sizeof(LINE) - 1);
+    sink.flush();
+
+    TEST_ASSERT_EQUAL_STRING("/log.000006.txt", sink.getActivePath().c_str());
+    TEST_ASSERT_TRUE(gFiles->files.count("/log.000004.txt") != 0);
+    TEST_ASSERT_TRUE(gFiles->files.count("/log.000003.txt") == 0);
+    TEST_ASSERT_TRUE(gFiles->files.count("/log.000001.txt") == 0);
+}
+
+void test_sequence_survives_interrupted_save()
+{
+    {
+        Sink sink(gFiles, "/log.txt", 3, MAX_FILE_SIZE, false, fmtlog::FileRotation::SEGMENTS);
+        writeRotations(sink, 4);
+    }
+    TEST_ASSERT_EQUAL_STRING("4 1\n", gFiles->files["/log.seq"].c_str());
+    TEST_ASSERT_TRUE(gFiles->files.count("/log.seq.tmp") == 0);
+
+    // Power lost while writing the temp file: log.seq is still whole
+    gFiles->files["/log.seq.tmp"] = "5 2";
+    {
+        Sink sink(gFiles, "/log.txt", 3, MAX_FILE_SIZE, true, fmtlog::FileRotation::SEGMENTS);
+        sink.write(LINE, sizeof(LINE) - 1);
+        TEST_ASSERT_EQUAL_STRING("/log.000005.txt", sink.getActivePath().c_str());
+    }
+
+    // Power lost after the temp file was written: it has the newer numbers
+    gFiles->files["/log.seq.tmp"] = "7 4\n";
+    gFiles->files["/log.seq"] = "5 2";
+    Sink sink(gFiles, "/log.txt", 3, MAX_FILE_SIZE, false, fmtlog::FileRotation::SEGMENTS);
+    sink.write(LINE, sizeof(LINE) - 1);
+    TEST_ASSERT_EQUAL_STRING("/log.000007.txt", sink.getActivePath().c_str());
+}
+
+void setUp(void)
+{
+    gFiles = std::make_shared<MemoryFileManager>();
+}
+
+void tearDown(void)
+{
+    gFiles.reset();
+}
+
+void tests()
+{
+    RUN_TEST(test_segments_are_numbered);
+    RUN_TEST(test_segment_rotation_is_constant_time);
+    RUN_TEST(test_rename_rotation_is_kept);
+    RUN_TEST(test_segments_continue_after_restart);
+    RUN_TEST(test_segments_trimmed_when_max_files_lowered);
+    RUN_TEST(test_sequence_survives_interrupted_save);
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs if board doesn't support software reset via Serial.DTR/RTS
+    delay(4000);
+
+    UNITY_BEGIN();
+    tests();
+    UNITY_END();
+}
+
+void loop()
+{
+}
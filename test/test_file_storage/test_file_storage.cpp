@@ -532,6 +532,30 @@ void test_storage_set_file_path_resets_state()
                              "First path should still have original content");
 }
 
+void test_storage_fan_out_to_added_file()
+{
+    fsUtils->deleteAllFiles();
+
+    const char *errorPath = "/errors.txt";
+    LOG_SET_FILE_STORAGE(TEST_FS, LOG_FILE_PATH);
+    TEST_ASSERT_TRUE_MESSAGE(LOG_ADD_FILE_STORAGE(fmtlog::LogLevel::ERROR, TEST_FS, errorPath), "Second file should be added");
+
+    LOG_WARN("Warning for main file");
+    LOG_ERROR("Error for both files");
+    LOG_FLUSH_FILE();
+
+    std::string mainContent = fsUtils->readFile(LOG_FILE_PATH);
+    std::string errorContent = fsUtils->readFile(errorPath);
+    TEST_ASSERT_TRUE(mainContent.find("Warning for main file") != std::string::npos);
+    TEST_ASSERT_TRUE(mainContent.find("Error for both files") != std::string::npos);
+    TEST_ASSERT_TRUE_MESSAGE(errorContent.find("Warning for main file") == std::string::npos,
+                             "WARN should be filtered from the ERROR file");
+    TEST_ASSERT_TRUE(errorContent.find("Error for both files") != std::string::npos);
+
+    LOG_CLOSE_FILE();
+    LOG_CLEAR_OUTPUTS();
+}
+
 void test_storage_flush_empty_buffer_no_op()
 {
     fsUtils->deleteAllFiles();
@@ -809,6 +833,7 @@ void tests()
 
     // Configuration changes
     RUN_TEST(test_storage_set_file_path_resets_state);
+    RUN_TEST(test_storage_fan_out_to_added_file);
 }
 
 // SdFs sd;
@@ -0,0 +1,207 @@
+// More information about PlatformIO Unit Testing:
+// https://docs.platformio.org/en/latest/advanced/unit-testing/index.html
+
+#include <Arduino.h>
+#include <string>
+#include <cstring>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include "unity.h"
+
+#define TEST_COUNT_ALLOCATIONS
+#include "../shared/TestSupport.h"
+
+TestStream gStream;
+volatile uint32_t gContext = 0;
+
+#define LOG_STREAM gStream
+#define LOG_LEVEL LOG_LEVEL_TRACE
+#define LOG_COLOR LOG_COLOR_DISABLE
+#define LOG_TIME LOG_TIME_DISABLE
+#define LOG_FILENAME LOG_FILENAME_DISABLE
+
+#define LOG_ISR_ENABLE 1
+#define LOG_ISR_QUEUE_SIZE 8
+#define LOG_ISR_CONTEXT() gContext
+
+#include "FormatLog.h"
+
+enum class PinEdge : uint8_t
+{
+    RISING_EDGE = 1,
+    FALLING_EDGE = 2
+};
+
+// Stands in for an interrupt handler
+void onPinChange(int pin, bool level)
+{
+    LOG_ISR_INFO("Pin {} changed to {}", pin, level);
+}
+
+/*------------------------------------------------------------------------------
+ * TESTS FOR Interrupt Logging
+ *----------------------------------------------------------------------------*/
+
+void test_isr_formatted_on_drain()
+{
+    onPinChange(5, true);
+    LOG_ISR_WARN("Temperature {:.1f}", 21.5f);
+    TEST_ASSERT_EQUAL_STRING_MESSAGE("", gStream.c_str(), "Interrupt handlers should not write");
+
+    LOG_ISR_DRAIN();
+    TEST_ASSERT_EQUAL_STRING("[INFO] Pin 5 changed to true" LOG_EOL "[WARN] Temperature 21.5" LOG_EOL, gStream.c_str());
+}
+
+void test_isr_argument_types()
+{
+    LOG_ISR_DEBUG("{} {} {} {}", static_cast<int8_t>(-3), 4000000000u, 'x', static_cast<uint8_t>(PinEdge::FALLING_EDGE));
+    LOG_ISR_ERROR("No arguments");
+    LOG_ISR_DRAIN();
+    TEST_ASSERT_EQUAL_STRING("[DBUG] -3 4000000000 x 2" LOG_EOL "[EROR] No arguments" LOG_EOL, gStream.c_str());
+}
+
+void test_isr_volatile_argument()
+{
+    // Counters shared with a handler are volatile
+    static volatile uint32_t pulses = 12;
+    LOG_ISR_INFO("Pulses {}", pulses);
+    LOG_ISR_DRAIN();
+    TEST_ASSERT_EQUAL_STRING("[INFO] Pulses 12" LOG_EOL, gStream.c_str());
+}
+
+void test_isr_never_allocates()
+{
+    size_t before = gAllocations;
+    for (int i = 0; i < LOG_ISR_QUEUE_SIZE + 4; ++i) // Fills the ring, then drops
+        onPinChange(i, false);
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(0, (unsigned int)(gAllocations - before), "LOG_ISR_* should not allocate");
+    LOG_ISR_DRAIN();
+}
+
+void test_isr_full_ring_drops()
+{
+    uint32_t dropped = LOG_ISR_DROPPED_COUNT();
+    for (int i = 0; i < LOG_ISR_QUEUE_SIZE + 3; ++i)
+        onPinChange(i, true);
+    TEST_ASSERT_EQUAL_UINT32(dropped + 3, LOG_ISR_DROPPED_COUNT());
+
+    LOG_ISR_DRAIN();
+    TEST_ASSERT_NOT_NULL(strstr(gStream.c_str(), "[INFO] Pin 7 changed to true" LOG_EOL));
+    TEST_ASSERT_NULL(strstr(gStream.c_str(), "Pin 8"));
+
+    // Drained slots are free again
+    gStream.clear();
+    onPinChange(9, false);
+    LOG_ISR_DRAIN();
+    TEST_ASSERT_EQUAL_STRING("[INFO] Pin 9 changed to false" LOG_EOL, gStream.c_str());
+}
+
+void test_isr_drained_before_next_log()
+{
+    LOG_ISR_ERROR("Overrun {}", 7);
+    LOG_INFO("Task");
+    TEST_ASSERT_EQUAL_STRING("[EROR] Overrun 7" LOG_EOL "[INFO] Task" LOG_EOL, gStream.c_str());
+}
+
+void test_isr_level_filtered_at_call()
+{
+    LOG_SET_LOG_LEVEL(fmtlog::LogLevel::WARN);
+    onPinChange(1, true);
+    LOG_ISR_WARN("Kept");
+    LOG_SET_LOG_LEVEL(fmtlog::LogLevel::TRACE);
+
+    LOG_ISR_DRAIN();
+    TEST_ASSERT_EQUAL_STRING("[WARN] Kept" LOG_EOL, gStream.c_str());
+}
+
+void test_isr_invalid_context_reported()
+{
+    gContext = LOG_ISR_CONTEXTS;
+    uint32_t dropped = LOG_ISR_DROPPED_COUNT();
+    LOG_ISR_INFO("Lost");
+    gContext = 0;
+    TEST_ASSERT_EQUAL_UINT32(dropped + 1, LOG_ISR_DROPPED_COUNT());
+
+    LOG_ISR_DRAIN();
+    TEST_ASSERT_EQUAL_STRING("[EROR] LOG_ISR_CONTEXT() must be below LOG_ISR_CONTEXTS (1), message dropped" LOG_EOL, gStream.c_str());
+}
+
+void test_isr_concurrent_producers_share_ring()
+{
+    // Stand in for handlers preempting each other, or both cores, all writing ring 0
+    const int producers = 4;
+    const int calls = 2000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < producers; ++t)
+    {
+        threads.emplace_back([t]()
+                             {
+                                 for (int i = 0; i < calls; ++i)
+                                     LOG_ISR_INFO("Producer {} call {}", t, i);
+                             });
+    }
+    for (int i = 0; i < 200; ++i)
+        LOG_ISR_DRAIN();
+    for (std::thread &thread : threads)
+        thread.join();
+    LOG_ISR_DRAIN();
+
+    // Every drained record was fully written, and each producer's records stay in order
+    int last[producers] = {-1, -1, -1, -1};
+    size_t lines = 0;
+    const char *line = gStream.c_str();
+    while (*line)
+    {
+        int producer = -1;
+        int call = -1;
+        TEST_ASSERT_EQUAL_INT(2, sscanf(line, "[INFO] Producer %d call %d", &producer, &call));
+        TEST_ASSERT_TRUE(producer >= 0 && producer < producers);
+        TEST_ASSERT_GREATER_THAN(last[producer], call);
+        last[producer] = call;
+        ++lines;
+        line = strstr(line, LOG_EOL) + strlen(LOG_EOL);
+    }
+    TEST_ASSERT_GREATER_THAN(0, lines);
+}
+
+/*------------------------------------------------------------------------------
+ * SETUP AND TEST RUNNER
+ *----------------------------------------------------------------------------*/
+
+void setUp(void)
+{
+    LOG_ISR_DRAIN();
+    gStream.clear();
+}
+
+void tearDown(void)
+{
+}
+
+void tests()
+{
+    RUN_TEST(test_isr_formatted_on_drain);
+    RUN_TEST(test_isr_argument_types);
+    RUN_TEST(test_isr_volatile_argument);
+    RUN_TEST(test_isr_never_allocates);
+    RUN_TEST(test_isr_full_ring_drops);
+    RUN_TEST(test_isr_drained_before_next_log);
+    RUN_TEST(test_isr_level_filtered_at_call);
+    RUN_TEST(test_isr_invalid_context_reported);
+    RUN_TEST(test_isr_concurrent_producers_share_ring);
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs if board doesn't support software reset via Serial.DTR/RTS
+    delay(4000);
+
+    UNITY_BEGIN();
+    tests();
+    UNITY_END();
+}
+
+void loop()
+{
+}
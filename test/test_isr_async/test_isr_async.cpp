@@ -0,0 +1,80 @@
+// More information about PlatformIO Unit Testing:
+// https://docs.platformio.org/en/latest/advanced/unit-testing/index.html
+
+#include <Arduino.h>
+#include <string>
+#include <cstring>
+#include "unity.h"
+
+#include "../shared/TestSupport.h"
+
+TestStream gStream;
+
+#define LOG_STREAM gStream
+#define LOG_LEVEL LOG_LEVEL_TRACE
+#define LOG_COLOR LOG_COLOR_DISABLE
+#define LOG_TIME LOG_TIME_DISABLE
+#define LOG_FILENAME LOG_FILENAME_DISABLE
+
+// Both rings in one program
+#define LOG_ISR_ENABLE 1
+#define LOG_ISR_QUEUE_SIZE 8
+#define LOG_ASYNC_ENABLE 1
+#define LOG_ASYNC_QUEUE_SIZE 8
+
+#include "FormatLog.h"
+
+/*------------------------------------------------------------------------------
+ * TESTS FOR Interrupt Logging with Async Logging
+ *----------------------------------------------------------------------------*/
+
+void test_isr_records_queued_for_drain_task()
+{
+    LOG_ISR_WARN("Pulse {} width {} us", 3, 120);
+    LOG_ISR_DRAIN();
+    LOG_FLUSH();
+    TEST_ASSERT_EQUAL_STRING("[WARN] Pulse 3 width 120 us" LOG_EOL, gStream.str().c_str());
+}
+
+void test_isr_records_before_next_log()
+{
+    LOG_ISR_ERROR("Overrun {}", 7);
+    LOG_INFO("Task");
+    LOG_FLUSH();
+    TEST_ASSERT_EQUAL_STRING("[EROR] Overrun 7" LOG_EOL "[INFO] Task" LOG_EOL, gStream.str().c_str());
+}
+
+/*------------------------------------------------------------------------------
+ * SETUP AND TEST RUNNER
+ *----------------------------------------------------------------------------*/
+
+void setUp(void)
+{
+    LOG_ISR_DRAIN();
+    LOG_FLUSH();
+    gStream.clear();
+}
+
+void tearDown(void)
+{
+}
+
+void tests()
+{
+    RUN_TEST(test_isr_records_queued_for_drain_task);
+    RUN_TEST(test_isr_records_before_next_log);
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs if board doesn't support software reset via Serial.DTR/RTS
+    delay(4000);
+
+    UNITY_BEGIN();
+    tests();
+    UNITY_END();
+}
+
+void loop()
+{
+}
@@ -48,6 +48,8 @@ TestStream gStream;
 #define LOG_COLOR LOG_COLOR_DISABLE
 #define LOG_TIME LOG_TIME_DISABLE
 #define LOG_FILENAME LOG_FILENAME_DISABLE
+#define LOG_TAG_LIST(TAG) TAG(wifi) TAG(sensor)
+#define LOG_TAG_LEVEL_LIST(TAG_LEVEL) TAG_LEVEL(sensor, LOG_LEVEL_INFO)
 
 #include "FormatLog.h"
 
@@ -175,13 +177,62 @@ void test_direct_value_logging()
 void test_preamble_helpers()
 {
     TEST_ASSERT_EQUAL_STRING("TRAC", fmtlog::logLevelText(fmtlog::LogLevel::TRACE, fmtlog::LogLevelTextFormat::SHORT));
-    TEST_ASSERT_EQUAL_STRING("test_FormatLog", fmtlog::formatFilename("/path/to/test_FormatLog.cpp", 123,
-                                                                        "irrelevant", fmtlog::LogFilename::ENABLE));
+    fmtlog::FilenameText filename = fmtlog::formatFilename("/path/to/test_FormatLog.cpp", 123, "irrelevant", fmtlog::LogFilename::ENABLE);
+    TEST_ASSERT_EQUAL_STRING("test_FormatLog", filename.c_str());
 
-    const char *withLineFunc = fmtlog::formatFilename("test_FormatLog.cpp", 77, "fn", fmtlog::LogFilename::LINENUMBER_FUNCTION_ENABLE);
-    TEST_ASSERT_NOT_NULL(strstr(withLineFunc, "test_FormatLog.cpp"));
-    TEST_ASSERT_NOT_NULL(strstr(withLineFunc, "77"));
-    TEST_ASSERT_NOT_NULL(strstr(withLineFunc, "fn"));
+    fmtlog::FilenameText withLineFunc = fmtlog::formatFilename("test_FormatLog.cpp", 77, "fn", fmtlog::LogFilename::LINENUMBER_FUNCTION_ENABLE);
+    TEST_ASSERT_NOT_NULL(strstr(withLineFunc.c_str(), "test_FormatLog.cpp"));
+    TEST_ASSERT_NOT_NULL(strstr(withLineFunc.c_str(), "77"));
+    TEST_ASSERT_NOT_NULL(strstr(withLineFunc.c_str(), "fn"));
+}
+
+void test_format_time_cached_prefix()
+{
+    fmtlog::LogTimestamp timestamp;
+
+    timestamp.millis = 3723004; // 1h 2m 3s 4ms
+    fmtlog::TimeText first = fmtlog::formatTime(fmtlog::LogTime::HHMMSSMS, timestamp);
+    timestamp.millis = 3723999; // Same second, only the milliseconds change
+    fmtlog::TimeText second = fmtlog::formatTime(fmtlog::LogTime::HHMMSSMS, timestamp);
+    timestamp.millis = 3724000;
+    fmtlog::TimeText next = fmtlog::formatTime(fmtlog::LogTime::HHMMSSMS, timestamp);
+
+    // Each result owns its text, earlier results are not overwritten
+    TEST_ASSERT_EQUAL_STRING("01:02:03:004", first.c_str());
+    TEST_ASSERT_EQUAL_STRING("01:02:03:999", second.c_str());
+    TEST_ASSERT_EQUAL_STRING("01:02:04:000", next.c_str());
+    TEST_ASSERT_EQUAL_STRING("0001:02:04:000", fmtlog::formatTime(fmtlog::LogTime::HHHHMMSSMS, timestamp).c_str());
+    TEST_ASSERT_EQUAL_STRING("   3724000", fmt::format("{:>10}", fmtlog::formatTime(fmtlog::LogTime::MILLIS, timestamp)).c_str());
+
+    timestamp.wall.tv_sec = 0; // Local time not set
+    TEST_ASSERT_EQUAL_STRING("", fmtlog::formatTime(fmtlog::LogTime::LOCALTIME, timestamp).c_str());
+    timestamp.wall.tv_sec = 1700000000;
+    timestamp.wall.tv_usec = 42000;
+    fmtlog::TimeText local = fmtlog::formatTime(fmtlog::LogTime::LOCALTIME, timestamp);
+    TEST_ASSERT_EQUAL_UINT(23, local.length);
+    TEST_ASSERT_EQUAL_STRING(".042", local.c_str() + 19);
+}
+
+void test_source_location_fragment()
+{
+    static_assert(fmtlog::sourceStemLength(fmtlog::sourceBasename("/path/to\\test_FormatLog.cpp")) == 14, "Basename stem evaluated at compile time");
+    static_assert(fmtlog::sourceFragmentSize("dir/file.cpp", 123, sizeof("fn"), fmtlog::LogFilename::LINENUMBER_FUNCTION_ENABLE) == sizeof("file:123 fn()"),
+                  "Fragment buffer sized at compile time");
+
+    const char *fragments[2];
+    int line = 0;
+    for (int i = 0; i < 2; ++i)
+    {
+        line = __LINE__ + 1;
+        fragments[i] = LOG_SOURCE_LOCATION(LOG_FILENAME_LINENUMBER_FUNCTION_ENABLE).fragment;
+    }
+
+    char expected[64];
+    snprintf(expected, sizeof(expected), "test_log:%d test_source_location_fragment()", line);
+    TEST_ASSERT_EQUAL_STRING(expected, fragments[0]);
+    TEST_ASSERT_EQUAL_PTR_MESSAGE(fragments[0], fragments[1], "Fragment should be rendered once per call site");
+
+    TEST_ASSERT_EQUAL_STRING("test_log", fmtlog::formatFilename(LOG_SOURCE_LOCATION(LOG_FILENAME_ENABLE)).c_str());
 }
 
 void test_assertion_pass_does_not_halt()
@@ -216,6 +267,230 @@ void test_long_message_logging()
     TEST_ASSERT_EQUAL_INT_MESSAGE(0, memcmp(out.c_str() + out.size() - eolLen, LOG_EOL, eolLen), out.c_str());
 }
 
+static int gEvaluations = 0;
+
+static int expensiveValue()
+{
+    ++gEvaluations;
+    return 42;
+}
+
+void test_log_filtered_args_not_evaluated()
+{
+    gEvaluations = 0;
+    LOG_SET_LOG_LEVEL(fmtlog::LogLevel::WARN);
+
+    LOG_DEBUG("Value {}", expensiveValue());
+    LOG_TRACE(expensiveValue());
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, gEvaluations, "Arguments of a filtered call should not be evaluated");
+    TEST_ASSERT_EQUAL_UINT(0, (unsigned int)gStream.str().size());
+
+    LOG_WARN("Value {}", expensiveValue());
+    TEST_ASSERT_EQUAL_INT(1, gEvaluations);
+    TEST_ASSERT_NOT_NULL(strstr(gStream.c_str(), "Value 42"));
+
+    // An added output with a more verbose level re-enables the call site
+    TestStream verbose;
+    LOG_ADD_STREAM(verbose, fmtlog::LogLevel::DEBUG);
+    LOG_DEBUG("Value {}", expensiveValue());
+    TEST_ASSERT_EQUAL_INT(2, gEvaluations);
+    TEST_ASSERT_NOT_NULL(strstr(verbose.c_str(), "Value 42"));
+    LOG_CLEAR_OUTPUTS();
+
+    TEST_ASSERT_FALSE(FmtLog.isLevelEnabled(fmtlog::LogLevel::DEBUG));
+    TEST_ASSERT_TRUE(FmtLog.isLevelEnabled(fmtlog::LogLevel::ERROR));
+}
+
+void test_log_fan_out_to_added_stream()
+{
+    TestStream second;
+    TEST_ASSERT_TRUE(LOG_ADD_STREAM(second, fmtlog::LogLevel::WARN));
+
+    LOG_INFO("Primary only");
+    TEST_ASSERT_NOT_NULL(strstr(gStream.c_str(), "Primary only"));
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(0, (unsigned int)second.str().size(), "INFO should be filtered from the WARN output");
+
+    gStream.clear();
+    LOG_ERROR("Both {}", 7);
+    TEST_ASSERT_NOT_NULL(strstr(second.c_str(), "Both 7"));
+    TEST_ASSERT_EQUAL_STRING(gStream.c_str(), second.c_str());
+
+    // An added output still receives messages when the primary stream filters them
+    gStream.clear();
+    second.clear();
+    LOG_SET_LOG_LEVEL(fmtlog::LogLevel::DISABLE);
+    LOG_WARN("Second only");
+    TEST_ASSERT_EQUAL_UINT(0, (unsigned int)gStream.str().size());
+    TEST_ASSERT_NOT_NULL(strstr(second.c_str(), "Second only"));
+
+    LOG_CLEAR_OUTPUTS();
+}
+
+void test_log_add_stream_limit()
+{
+    TestStream streams[LOG_MAX_OUTPUTS + 1];
+    for (size_t i = 0; i < LOG_MAX_OUTPUTS; ++i)
+        TEST_ASSERT_TRUE(LOG_ADD_STREAM(streams[i], fmtlog::LogLevel::TRACE));
+    TEST_ASSERT_FALSE_MESSAGE(LOG_ADD_STREAM(streams[LOG_MAX_OUTPUTS], fmtlog::LogLevel::TRACE), "Output list should be full");
+
+    // Adding a stream again only changes its level
+    TEST_ASSERT_TRUE(LOG_ADD_STREAM(streams[0], fmtlog::LogLevel::ERROR));
+    LOG_INFO("Level update");
+    TEST_ASSERT_EQUAL_UINT(0, (unsigned int)streams[0].str().size());
+    TEST_ASSERT_NOT_NULL(strstr(streams[1].c_str(), "Level update"));
+
+    LOG_CLEAR_OUTPUTS();
+    LOG_INFO("After clear");
+    TEST_ASSERT_NULL(strstr(streams[1].c_str(), "After clear"));
+}
+
+// Logs from the wifi tag, LOG_TAG is read where the macros expand
+#undef LOG_TAG
+#define LOG_TAG wifi
+static void logFromWifi(const char *message)
+{
+    LOG_DEBUG("{} {}", message, expensiveValue());
+}
+
+// Logs from the sensor tag, compiled down to INFO
+#undef LOG_TAG
+#define LOG_TAG sensor
+static void logFromSensor(const char *message)
+{
+    LOG_DEBUG("{} {}", message, expensiveValue());
+    LOG_INFO("{} {}", message, expensiveValue());
+}
+#undef LOG_TAG
+#define LOG_TAG UNTAGGED
+
+void test_log_tag_level_overrides_output_level()
+{
+    gEvaluations = 0;
+    LOG_SET_LOG_LEVEL(fmtlog::LogLevel::WARN);
+
+    logFromWifi("Quiet");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, gEvaluations, "Tag without a level should follow the output level");
+
+    LOG_SET_TAG_LEVEL(wifi, fmtlog::LogLevel::DEBUG);
+    TEST_ASSERT_EQUAL(fmtlog::LogLevel::DEBUG, LOG_GET_TAG_LEVEL(wifi));
+    TEST_ASSERT_EQUAL(fmtlog::LogLevel::WARN, LOG_GET_TAG_LEVEL(sensor));
+
+    logFromWifi("Verbose");
+    LOG_DEBUG("Untagged");
+    TEST_ASSERT_EQUAL_INT(1, gEvaluations);
+    TEST_ASSERT_NOT_NULL(strstr(gStream.c_str(), "Verbose 42"));
+    TEST_ASSERT_NULL_MESSAGE(strstr(gStream.c_str(), "Untagged"), "Other tags should keep the output level");
+
+    // A tag level can also silence a module below the output level
+    gStream.clear();
+    LOG_SET_LOG_LEVEL(fmtlog::LogLevel::TRACE);
+    LOG_SET_TAG_LEVEL(wifi, fmtlog::LogLevel::ERROR);
+    logFromWifi("Silenced");
+    TEST_ASSERT_EQUAL_UINT(0, (unsigned int)gStream.str().size());
+    TEST_ASSERT_FALSE(FmtLog.isLevelEnabled(fmtlog::LogTag::wifi, fmtlog::LogLevel::DEBUG));
+    TEST_ASSERT_TRUE(FmtLog.isLevelEnabled(fmtlog::LogTag::sensor, fmtlog::LogLevel::DEBUG));
+
+    LOG_RESET_TAG_LEVELS();
+    logFromWifi("Inherited");
+    TEST_ASSERT_NOT_NULL(strstr(gStream.c_str(), "Inherited 42"));
+}
+
+void test_log_tag_levels_from_text()
+{
+    TEST_ASSERT_EQUAL_STRING("wifi", fmtlog::logTagName(fmtlog::LogTag::wifi));
+    TEST_ASSERT_EQUAL_INT(3, LOG_TAG_COUNT);
+
+    TEST_ASSERT_TRUE(LOG_SET_TAG_LEVELS("*=error, wifi=DEBUG,sensor:w"));
+    TEST_ASSERT_EQUAL(fmtlog::LogLevel::DEBUG, LOG_GET_TAG_LEVEL(wifi));
+    TEST_ASSERT_EQUAL(fmtlog::LogLevel::WARN, LOG_GET_TAG_LEVEL(sensor));
+    TEST_ASSERT_EQUAL(fmtlog::LogLevel::ERROR, FmtLog.getTagLevel(fmtlog::LogTag::UNTAGGED));
+
+    // Unknown entries are reported, valid ones still applied
+    TEST_ASSERT_FALSE(LOG_SET_TAG_LEVELS("bluetooth=debug,sensor=3,wifi=loud"));
+    TEST_ASSERT_EQUAL(fmtlog::LogLevel::INFO, LOG_GET_TAG_LEVEL(sensor));
+    TEST_ASSERT_EQUAL(fmtlog::LogLevel::DEBUG, LOG_GET_TAG_LEVEL(wifi));
+
+    TEST_ASSERT_TRUE(FmtLog.setTagLevel("sensor", fmtlog::LogLevel::TRACE));
+    TEST_ASSERT_FALSE(FmtLog.setTagLevel("bluetooth", fmtlog::LogLevel::TRACE));
+    TEST_ASSERT_TRUE(LOG_SET_TAG_LEVELS("*=inherit"));
+    TEST_ASSERT_EQUAL(FmtLog.getLogLevel(), LOG_GET_TAG_LEVEL(sensor));
+}
+
+void test_log_tag_compile_time_level()
+{
+    TEST_ASSERT_EQUAL_INT(LOG_LEVEL_INFO, fmtlog::LogTagLimit<fmtlog::LogTag::sensor>::value);
+    TEST_ASSERT_EQUAL_INT(LOG_LEVEL_TRACE, fmtlog::LogTagLimit<fmtlog::LogTag::wifi>::value);
+
+    // The runtime level cannot bring back a call compiled out for the tag
+    gEvaluations = 0;
+    LOG_SET_TAG_LEVEL(sensor, fmtlog::LogLevel::TRACE);
+    logFromSensor("Sensor");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(1, gEvaluations, "Only the INFO call should be compiled in");
+    TEST_ASSERT_NOT_NULL(strstr(gStream.c_str(), "Sensor 42"));
+    LOG_RESET_TAG_LEVELS();
+}
+
+static size_t countOccurrences(const std::string &text, const char *needle)
+{
+    size_t count = 0;
+    for (size_t pos = text.find(needle); pos != std::string::npos; pos = text.find(needle, pos + 1))
+        ++count;
+    return count;
+}
+
+void test_log_every_n()
+{
+    gEvaluations = 0;
+    for (int i = 0; i < 10; ++i)
+        LOG_EVERY_N(WARN, 3, "Fault {}", expensiveValue());
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(4, gEvaluations, "Suppressed calls should not evaluate their arguments");
+    TEST_ASSERT_EQUAL_UINT(4, (unsigned int)countOccurrences(gStream.str(), "Fault 42"));
+    TEST_ASSERT_EQUAL_UINT(3, (unsigned int)countOccurrences(gStream.str(), "Fault 42 (2 suppressed)"));
+}
+
+void test_log_once()
+{
+    for (int i = 0; i < 3; ++i)
+        LOG_ONCE(INFO, "Booted");
+    TEST_ASSERT_EQUAL_UINT(1, (unsigned int)countOccurrences(gStream.str(), "Booted"));
+}
+
+// Throttle state belongs to the call site, so repeated calls go through one function
+static void sensorLost()
+{
+    LOG_EVERY_MS(ERROR, 50, "Sensor lost");
+}
+
+void test_log_every_ms()
+{
+    for (int i = 0; i < 3; ++i)
+        sensorLost();
+    TEST_ASSERT_EQUAL_UINT(1, (unsigned int)countOccurrences(gStream.str(), "Sensor lost"));
+
+    delay(60);
+    sensorLost();
+    TEST_ASSERT_EQUAL_UINT(1, (unsigned int)countOccurrences(gStream.str(), "Sensor lost (2 suppressed)"));
+}
+
+static void rateLimited()
+{
+    LOG_RATE_LIMIT(WARN, 2, 50, "Retry {}", 1);
+}
+
+void test_log_rate_limit()
+{
+    for (int i = 0; i < 5; ++i)
+        rateLimited();
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(2, (unsigned int)countOccurrences(gStream.str(), "Retry 1"), "Burst should be capped at capacity");
+
+    delay(60);
+    gStream.clear();
+    rateLimited();
+    rateLimited();
+    TEST_ASSERT_EQUAL_STRING_MESSAGE("[WARN] Retry 1 (3 suppressed)" LOG_EOL, gStream.c_str(), "One token should be earned back");
+}
+
 /*------------------------------------------------------------------------------
  * SETUP AND TEST RUNNER
  *----------------------------------------------------------------------------*/
@@ -242,8 +517,20 @@ void tests()
     RUN_TEST(test_log_level_stepdown);
     RUN_TEST(test_direct_value_logging);
     RUN_TEST(test_preamble_helpers);
+    RUN_TEST(test_format_time_cached_prefix);
+    RUN_TEST(test_source_location_fragment);
     RUN_TEST(test_assertion_pass_does_not_halt);
     RUN_TEST(test_long_message_logging);
+    RUN_TEST(test_log_filtered_args_not_evaluated);
+    RUN_TEST(test_log_fan_out_to_added_stream);
+    RUN_TEST(test_log_add_stream_limit);
+    RUN_TEST(test_log_tag_level_overrides_output_level);
+    RUN_TEST(test_log_tag_levels_from_text);
+    RUN_TEST(test_log_tag_compile_time_level);
+    RUN_TEST(test_log_every_n);
+    RUN_TEST(test_log_once);
+    RUN_TEST(test_log_every_ms);
+    RUN_TEST(test_log_rate_limit);
 }
 
 void setup()
@@ -0,0 +1,200 @@
+// More information about PlatformIO Unit Testing:
+// https://docs.platformio.org/en/latest/advanced/unit-testing/index.html
+
+#include <Arduino.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstring>
+#include "unity.h"
+
+#include "../shared/TestSupport.h"
+
+TestStream gStream;
+
+#define LOG_STREAM gStream
+#define LOG_LEVEL LOG_LEVEL_TRACE
+#define LOG_COLOR LOG_COLOR_DISABLE
+#define LOG_TIME LOG_TIME_DISABLE
+#define LOG_FILENAME LOG_FILENAME_DISABLE
+
+#define LOG_FILE_ENABLE 1
+#define LOG_FILE_LEVEL LOG_LEVEL_INFO
+
+#define LOG_POLL_ENABLE 1
+#define LOG_POLL_BUFFER_SIZE 256
+#define LOG_POLL_FILE_BUDGET_MS 10
+
+#include "FormatLog.h"
+
+// File sink that takes a while per write, like a flash page program
+class SlowSink : public fmtlog::IFileSink
+{
+public:
+    std::string buffer;
+    std::vector<std::string> lines;
+    unsigned long writeMs = 0;
+
+    bool write(const char *data, size_t size) override
+    {
+        delay(writeMs);
+        buffer.append(data, size);
+        return true;
+    }
+    bool writeLine(const char *data, size_t size, fmtlog::LogLevel) override
+    {
+        lines.emplace_back(data, size);
+        return write(data, size);
+    }
+    void flush() override {}
+    void close() override {}
+    void setFilePath(const char *) override {}
+    std::string getFilePath() const override { return ""; }
+};
+
+std::shared_ptr<SlowSink> gSink = std::make_shared<SlowSink>();
+
+/*------------------------------------------------------------------------------
+ * TESTS FOR Cooperative Logging
+ *----------------------------------------------------------------------------*/
+
+void test_poll_log_only_queues()
+{
+    LOG_DEBUG("Motor step {}", 42);
+    TEST_ASSERT_EQUAL_STRING("", gStream.c_str());
+    TEST_ASSERT_TRUE(LOG_POLL_PENDING() > 0);
+
+    LOG_POLL();
+    TEST_ASSERT_EQUAL_STRING("[DBUG] Motor step 42" LOG_EOL, gStream.c_str());
+    TEST_ASSERT_EQUAL_UINT(0, (unsigned int)LOG_POLL_PENDING());
+}
+
+void test_poll_respects_available_for_write()
+{
+    LOG_DEBUG("First");
+    LOG_DEBUG("Second");
+
+    gStream.room = 10;
+    LOG_POLL();
+    TEST_ASSERT_EQUAL_STRING("[DBUG] Fir", gStream.c_str());
+
+    gStream.room = 0;
+    LOG_POLL();
+    TEST_ASSERT_EQUAL_STRING("[DBUG] Fir", gStream.c_str());
+
+    gStream.room = 13;
+    LOG_POLL();
+    TEST_ASSERT_EQUAL_STRING("[DBUG] First" LOG_EOL "[DBUG] Se", gStream.c_str());
+
+    gStream.room = 1000;
+    LOG_POLL();
+    TEST_ASSERT_EQUAL_STRING("[DBUG] First" LOG_EOL "[DBUG] Second" LOG_EOL, gStream.c_str());
+    TEST_ASSERT_FALSE_MESSAGE(gStream.overrun, "Wrote more than availableForWrite()");
+}
+
+void test_poll_full_buffer_drops_whole_lines()
+{
+    gStream.room = 0;
+    uint32_t dropped = LOG_POLL_DROPPED_COUNT();
+    for (int i = 0; i < 20; ++i)
+        LOG_TRACE("Sample {:02}", i);
+    TEST_ASSERT_TRUE(LOG_POLL_DROPPED_COUNT() > dropped);
+    TEST_ASSERT_TRUE(LOG_POLL_PENDING() <= LOG_POLL_BUFFER_SIZE);
+
+    gStream.room = 1000;
+    LOG_POLL();
+    TEST_ASSERT_EQUAL_STRING("[TRAC] Sample 00" LOG_EOL, gStream.str().substr(0, 18).c_str());
+    TEST_ASSERT_EQUAL_STRING(LOG_EOL, gStream.str().substr(gStream.str().size() - 2).c_str());
+}
+
+void test_poll_flush_writes_everything()
+{
+    gStream.room = 0;
+    LOG_INFO("Saved");
+    TEST_ASSERT_EQUAL_STRING("", gStream.c_str());
+
+    gStream.room = 1000000;
+    LOG_FLUSH();
+    TEST_ASSERT_EQUAL_STRING("[INFO] Saved" LOG_EOL, gStream.c_str());
+    TEST_ASSERT_EQUAL_STRING("[INFO] Saved" LOG_EOL, gSink->buffer.c_str());
+}
+
+void test_poll_file_time_budget()
+{
+    gSink->writeMs = 4;
+    for (int i = 0; i < 4; ++i)
+        LOG_WARN("Fault {}", i);
+
+    // 4 ms per line with a 10 ms budget: a poll stops after two or three lines
+    LOG_POLL();
+    TEST_ASSERT_EQUAL_STRING("[WARN] Fault 0" LOG_EOL "[WARN] Fault 1" LOG_EOL, gSink->buffer.substr(0, 32).c_str());
+    TEST_ASSERT_TRUE_MESSAGE(gSink->buffer.size() <= 3 * 16, "File writes exceeded the time budget");
+
+    LOG_POLL();
+    LOG_POLL();
+    TEST_ASSERT_EQUAL_UINT(0, (unsigned int)LOG_POLL_PENDING());
+    TEST_ASSERT_EQUAL_STRING("[WARN] Fault 3" LOG_EOL, gSink->buffer.substr(gSink->buffer.size() - 16).c_str());
+    gSink->writeMs = 0;
+}
+
+void test_poll_file_lines_never_split()
+{
+    // Lines of varying length, so chunks end anywhere in the ring over several laps
+    gStream.room = 1000000;
+    for (int i = 0; i < 40; ++i)
+    {
+        LOG_INFO("Pressure {} kPa", i * 7919);
+        LOG_POLL();
+    }
+
+    TEST_ASSERT_EQUAL_UINT(40, gSink->lines.size());
+    for (const std::string &line : gSink->lines)
+    {
+        TEST_ASSERT_EQUAL_STRING("[INFO] Pressure ", line.substr(0, 16).c_str());
+        TEST_ASSERT_EQUAL_STRING(" kPa" LOG_EOL, line.substr(line.size() - 6).c_str());
+    }
+}
+
+/*------------------------------------------------------------------------------
+ * SETUP AND TEST RUNNER
+ *----------------------------------------------------------------------------*/
+
+void setUp(void)
+{
+    gStream.room = 1000000;
+    LOG_FLUSH();
+    gStream.room = 1000;
+    gStream.clear();
+    gSink->buffer.clear();
+    gSink->lines.clear();
+}
+
+void tearDown(void)
+{
+}
+
+void tests()
+{
+    FmtLog.setFileStorage(gSink);
+
+    RUN_TEST(test_poll_log_only_queues);
+    RUN_TEST(test_poll_respects_available_for_write);
+    RUN_TEST(test_poll_full_buffer_drops_whole_lines);
+    RUN_TEST(test_poll_flush_writes_everything);
+    RUN_TEST(test_poll_file_time_budget);
+    RUN_TEST(test_poll_file_lines_never_split);
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs if board doesn't support software reset via Serial.DTR/RTS
+    delay(4000);
+
+    UNITY_BEGIN();
+    tests();
+    UNITY_END();
+}
+
+void loop()
+{
+}
@@ -0,0 +1,122 @@
+// More information about PlatformIO Unit Testing:
+// https://docs.platformio.org/en/latest/advanced/unit-testing/index.html
+
+#include <Arduino.h>
+#include <string>
+#include <cstring>
+#include "unity.h"
+
+#define TEST_COUNT_ALLOCATIONS
+#include "../shared/TestSupport.h"
+
+TestStream gStream;
+
+static int gExhausted = 0;
+
+// Returns, so the line still goes out through the heap and the test can check it
+void onPoolExhausted()
+{
+    ++gExhausted;
+}
+
+#define LOG_STREAM gStream
+#define LOG_LEVEL LOG_LEVEL_TRACE
+#define LOG_COLOR LOG_COLOR_DISABLE
+#define LOG_TIME LOG_TIME_DISABLE
+#define LOG_FILENAME LOG_FILENAME_DISABLE
+
+#define LOG_STATIC_BUFFER_SIZE 32
+#define LOG_POOL_ENABLE 1
+#define LOG_POOL_BLOCK_SIZE 128
+#define LOG_POOL_BLOCK_COUNT 3
+#define LOG_POOL_EXHAUSTED_POLICY LOG_POOL_EXHAUSTED_FAIL
+#define LOG_POOL_EXHAUSTED_HANDLER onPoolExhausted
+
+#include "FormatLog.h"
+
+/*------------------------------------------------------------------------------
+ * TESTS FOR Line Buffer Pool
+ *----------------------------------------------------------------------------*/
+
+void test_pool_serves_long_lines()
+{
+    std::string text(90, 'a');
+    LOG_INFO("Ready"); // Constructs the logger outside the measurement
+    gStream.clear();
+    fmtlog::PoolStats before = LOG_GET_POOL_STATS();
+    size_t allocations = gAllocations;
+    LOG_INFO("{}", text.c_str());
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(0, (unsigned int)(gAllocations - allocations), "Lines that fit a block should not use the heap");
+    TEST_ASSERT_EQUAL_STRING(("[INFO] " + text + LOG_EOL).c_str(), gStream.c_str());
+
+    fmtlog::PoolStats after = LOG_GET_POOL_STATS();
+    TEST_ASSERT_TRUE(after.allocations > before.allocations);
+    TEST_ASSERT_EQUAL_UINT(0, after.inUse);
+    TEST_ASSERT_EQUAL_UINT32(before.fallbacks, after.fallbacks);
+}
+
+void test_pool_short_lines_stay_on_stack()
+{
+    fmtlog::PoolStats before = LOG_GET_POOL_STATS();
+    LOG_DEBUG("Short");
+    TEST_ASSERT_EQUAL_STRING("[DBUG] Short" LOG_EOL, gStream.c_str());
+    TEST_ASSERT_EQUAL_UINT32(before.allocations, LOG_GET_POOL_STATS().allocations);
+}
+
+void test_pool_high_water()
+{
+    std::string text(100, 'b');
+    LOG_WARN("{}", text.c_str());
+    TEST_ASSERT_TRUE(LOG_GET_POOL_HIGH_WATER() >= 1);
+    TEST_ASSERT_TRUE(LOG_GET_POOL_HIGH_WATER() <= LOG_POOL_BLOCK_COUNT);
+}
+
+void test_pool_exhausted_calls_handler()
+{
+    std::string text(200, 'c'); // Longer than a block
+    int exhausted = gExhausted;
+    uint32_t failures = LOG_GET_POOL_FAILURES();
+    uint32_t fallbacks = LOG_GET_POOL_FALLBACKS();
+    LOG_ERROR("{}", text.c_str());
+    TEST_ASSERT_TRUE(gExhausted > exhausted);
+    TEST_ASSERT_EQUAL_UINT32(failures + (gExhausted - exhausted), LOG_GET_POOL_FAILURES());
+    TEST_ASSERT_EQUAL_UINT32(fallbacks + (gExhausted - exhausted), LOG_GET_POOL_FALLBACKS());
+    TEST_ASSERT_EQUAL_STRING(("[EROR] " + text + LOG_EOL).c_str(), gStream.c_str());
+    TEST_ASSERT_EQUAL_UINT(0, LOG_GET_POOL_STATS().inUse);
+    TEST_ASSERT_TRUE(LOG_GET_POOL_STATS().largestRequest > LOG_POOL_BLOCK_SIZE);
+}
+
+/*------------------------------------------------------------------------------
+ * SETUP AND TEST RUNNER
+ *----------------------------------------------------------------------------*/
+
+void setUp(void)
+{
+    gStream.clear();
+}
+
+void tearDown(void)
+{
+}
+
+void tests()
+{
+    RUN_TEST(test_pool_serves_long_lines);
+    RUN_TEST(test_pool_short_lines_stay_on_stack);
+    RUN_TEST(test_pool_high_water);
+    RUN_TEST(test_pool_exhausted_calls_handler);
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs if board doesn't support software reset via Serial.DTR/RTS
+    delay(4000);
+
+    UNITY_BEGIN();
+    tests();
+    UNITY_END();
+}
+
+void loop()
+{
+}
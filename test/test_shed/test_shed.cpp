@@ -0,0 +1,128 @@
+// More information about PlatformIO Unit Testing:
+// https://docs.platformio.org/en/latest/advanced/unit-testing/index.html
+
+#include <Arduino.h>
+#include <string>
+#include <cstring>
+#include "unity.h"
+
+#include "../shared/TestSupport.h"
+
+TestStream gStream;
+
+#define LOG_STREAM gStream
+#define LOG_LEVEL LOG_LEVEL_TRACE
+#define LOG_COLOR LOG_COLOR_DISABLE
+#define LOG_TIME LOG_TIME_DISABLE
+#define LOG_FILENAME LOG_FILENAME_DISABLE
+
+#define LOG_SHED_ENABLE 1
+#define LOG_SHED_WINDOW_MS 100
+#define LOG_SHED_BUDGET_US 20000
+#define LOG_SHED_RESTORE_US 5000
+#define LOG_SHED_LEVEL LOG_LEVEL_WARN
+#define LOG_SHED_START_FORMAT "Shedding below {}"
+#define LOG_SHED_STOP_FORMAT "Caught up"
+
+#include "FormatLog.h"
+
+static size_t countOccurrences(const std::string &text, const char *needle)
+{
+    size_t count = 0;
+    for (size_t pos = text.find(needle); pos != std::string::npos; pos = text.find(needle, pos + 1))
+        ++count;
+    return count;
+}
+
+/*------------------------------------------------------------------------------
+ * TESTS FOR Load Shedding
+ *----------------------------------------------------------------------------*/
+
+void test_shed_fast_output_keeps_all_levels()
+{
+    for (int i = 0; i < 20; ++i)
+        LOG_DEBUG("Sample {}", i);
+    TEST_ASSERT_EQUAL_UINT(20, (unsigned int)countOccurrences(gStream.str(), "[DBUG] Sample"));
+    TEST_ASSERT_NULL(strstr(gStream.c_str(), "Shedding"));
+}
+
+void test_shed_slow_output_drops_verbose_levels()
+{
+    // 5 ms per line: the 20 ms budget is used up after about four lines
+    gStream.writeMs = 5;
+    for (int i = 0; i < 10; ++i)
+        LOG_DEBUG("Sample {}", i);
+    LOG_WARN("Still written");
+
+    const std::string &out = gStream.str();
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(1, (unsigned int)countOccurrences(out, "[WARN] Shedding below WARN" LOG_EOL), "One start marker expected");
+    TEST_ASSERT_TRUE(countOccurrences(out, "[DBUG] Sample") < 10);
+    TEST_ASSERT_TRUE(FmtLog.isLevelEnabled(fmtlog::LogLevel::WARN));
+    TEST_ASSERT_FALSE(FmtLog.isLevelEnabled(fmtlog::LogLevel::INFO));
+    TEST_ASSERT_NOT_NULL(strstr(out.c_str(), "[WARN] Still written" LOG_EOL));
+}
+
+void test_shed_restores_levels_with_hysteresis()
+{
+    // Still shedding from the previous test; once the window is quiet the next write restores the levels
+    gStream.writeMs = 0;
+    delay(2 * LOG_SHED_WINDOW_MS + 20);
+    LOG_ERROR("Recovered");
+    LOG_DEBUG("Sample after");
+
+    TEST_ASSERT_EQUAL_STRING("[EROR] Recovered" LOG_EOL "[WARN] Caught up" LOG_EOL "[DBUG] Sample after" LOG_EOL, gStream.c_str());
+    TEST_ASSERT_TRUE(FmtLog.isLevelEnabled(fmtlog::LogLevel::TRACE));
+}
+
+void test_shed_restores_levels_with_verbose_traffic_only()
+{
+    gStream.writeMs = 5;
+    for (int i = 0; i < 10; ++i)
+        LOG_DEBUG("Sample {}", i);
+    TEST_ASSERT_FALSE(FmtLog.isLevelEnabled(fmtlog::LogLevel::INFO));
+
+    // Only shed levels are logged from here, fast
+    gStream.writeMs = 0;
+    gStream.clear();
+    uint32_t start = millis();
+    while (millis() - start < 4 * LOG_SHED_WINDOW_MS && !FmtLog.isLevelEnabled(fmtlog::LogLevel::DEBUG))
+        LOG_DEBUG("Sample {}", 0);
+    TEST_ASSERT_TRUE(FmtLog.isLevelEnabled(fmtlog::LogLevel::DEBUG));
+    // The call that finds the outputs caught up is written after the marker
+    TEST_ASSERT_EQUAL_STRING("[WARN] Caught up" LOG_EOL "[DBUG] Sample 0" LOG_EOL, gStream.c_str());
+}
+
+/*------------------------------------------------------------------------------
+ * SETUP AND TEST RUNNER
+ *----------------------------------------------------------------------------*/
+
+void setUp(void)
+{
+    gStream.clear();
+}
+
+void tearDown(void)
+{
+}
+
+void tests()
+{
+    RUN_TEST(test_shed_fast_output_keeps_all_levels);
+    RUN_TEST(test_shed_slow_output_drops_verbose_levels);
+    RUN_TEST(test_shed_restores_levels_with_hysteresis);
+    RUN_TEST(test_shed_restores_levels_with_verbose_traffic_only);
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs if board doesn't support software reset via Serial.DTR/RTS
+    delay(4000);
+
+    UNITY_BEGIN();
+    tests();
+    UNITY_END();
+}
+
+void loop()
+{
+}
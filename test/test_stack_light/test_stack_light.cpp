@@ -0,0 +1,184 @@
+// More information about PlatformIO Unit Testing:
+// https://docs.platformio.org/en/latest/advanced/unit-testing/index.html
+
+#include <Arduino.h>
+#include <string>
+#include <cstring>
+#include "unity.h"
+
+#include "../shared/TestSupport.h"
+
+TestStream gStream;
+
+#define LOG_STREAM gStream
+#define LOG_LEVEL LOG_LEVEL_TRACE
+#define LOG_COLOR LOG_COLOR_DISABLE
+#define LOG_TIME LOG_TIME_DISABLE
+#define LOG_FILENAME LOG_FILENAME_DISABLE
+
+#define LOG_STACK_LIGHT_ENABLE 1
+#define LOG_SHARED_BUFFER_COUNT 1
+
+#include "FormatLog.h"
+
+/*------------------------------------------------------------------------------
+ * Stack measurement: paint the stack below the caller, run a call, find the
+ * deepest byte it changed. Assumes a stack growing down, as on all supported boards.
+ *----------------------------------------------------------------------------*/
+
+static const size_t STACK_PAINT_SIZE = 8192;
+static const uint8_t STACK_PAINT = 0xA5;
+
+// Addresses only, the painted area is gone once paintStack() returns
+struct PaintedRange
+{
+    uintptr_t bottom;
+    uintptr_t top;
+};
+
+__attribute__((noinline)) static PaintedRange paintStack()
+{
+    volatile uint8_t area[STACK_PAINT_SIZE];
+    for (size_t i = 0; i < STACK_PAINT_SIZE; ++i)
+        area[i] = STACK_PAINT;
+    uintptr_t bottom = reinterpret_cast<uintptr_t>(&area[0]);
+    return PaintedRange{bottom, bottom + STACK_PAINT_SIZE};
+}
+
+__attribute__((noinline)) static size_t measureStack(void (*call)())
+{
+    PaintedRange painted = paintStack();
+    call(); // Runs on the frame paintStack() just left
+    uintptr_t deepest = painted.bottom;
+    while (deepest < painted.top && *reinterpret_cast<const volatile uint8_t *>(deepest) == STACK_PAINT)
+        ++deepest;
+    return painted.top - deepest;
+}
+
+// Each call paired with fmt formatting the same message into a buffer that is already allocated,
+// the least stack any logger can take for it
+static fmt::basic_memory_buffer<char, 512> gFmtBuffer;
+
+static void logInts() { LOG_INFO("Sensor {} read {} status {}", 3, 1234, -5); }
+static void fmtInts() { fmt::format_to(fmt::appender(gFmtBuffer), "Sensor {} read {} status {}", 3, 1234, -5); }
+static void logFloat() { LOG_INFO("Sensor {} read {} at {:.2f} V", 3, 1234, 3.3f); }
+static void fmtFloat() { fmt::format_to(fmt::appender(gFmtBuffer), "Sensor {} read {} at {:.2f} V", 3, 1234, 3.3f); }
+static void logStrings() { LOG_ERROR("Task {} failed: {}", "wifi", String("timeout")); }
+static void fmtStrings() { fmt::format_to(fmt::appender(gFmtBuffer), "Task {} failed: {}", "wifi", String("timeout")); }
+static void logLong() { LOG_DEBUG("{:>300}", "right aligned"); }
+static void fmtLong() { fmt::format_to(fmt::appender(gFmtBuffer), "{:>300}", "right aligned"); }
+static void printLine() { LOG_PRINTLN("Uptime {} s", 3600); }
+static void fmtPrintLine() { fmt::format_to(fmt::appender(gFmtBuffer), "Uptime {} s", 3600); }
+
+// Stack the logger may add to fmt's own for a call: its frames, and for short messages the preamble
+// formatted below them, deeper than the message. Measured 150-290 bytes on x86-64 with GCC -Os,
+// up to 580 with the two line buffers of the default mode on the stack.
+static const size_t LOGGER_STACK_LIMIT = 512;
+
+static size_t gWorstStack = 0;
+static size_t gWorstFmt = 0;
+
+static void measure(const char *name, void (*log)(), void (*format)())
+{
+    // First calls take one-time paths (static init, buffer growth) that aren't per call costs
+    log();
+    format();
+    gFmtBuffer.clear();
+
+    size_t used = measureStack(log);
+    size_t fmtUsed = measureStack(format);
+    gFmtBuffer.clear();
+    if (used > gWorstStack)
+    {
+        gWorstStack = used;
+        gWorstFmt = fmtUsed;
+    }
+
+    char message[96];
+    snprintf(message, sizeof(message), "%s: %u bytes of stack, %u in fmt", name, (unsigned)used, (unsigned)fmtUsed);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_TRUE_MESSAGE(fmtUsed > 0 && used >= fmtUsed, "Stack measurement failed");
+    TEST_ASSERT_LESS_THAN_MESSAGE(LOGGER_STACK_LIMIT, used - fmtUsed, "The logger should add less than LOGGER_STACK_LIMIT bytes to fmt's stack");
+}
+
+/*------------------------------------------------------------------------------
+ * TESTS FOR Stack-Light Mode
+ *----------------------------------------------------------------------------*/
+
+void test_stack_light_output()
+{
+    logFloat();
+    TEST_ASSERT_EQUAL_STRING("[INFO] Sensor 3 read 1234 at 3.30 V" LOG_EOL, gStream.c_str());
+}
+
+void test_stack_light_worst_case()
+{
+    gFmtBuffer.reserve(512);
+    measure("LOG_INFO ints", logInts, fmtInts);
+    measure("LOG_INFO float", logFloat, fmtFloat);
+    measure("LOG_ERROR strings", logStrings, fmtStrings);
+    measure("LOG_DEBUG 300 chars", logLong, fmtLong);
+    measure("LOG_PRINTLN", printLine, fmtPrintLine);
+
+    char message[96];
+    snprintf(message, sizeof(message), "Worst case %u bytes, %u of them in fmt", (unsigned)gWorstStack, (unsigned)gWorstFmt);
+    TEST_MESSAGE(message);
+}
+
+struct Nested
+{
+    int value;
+};
+
+template <>
+struct fmt::formatter<Nested> : fmt::formatter<int>
+{
+    template <typename Ctx>
+    auto format(const Nested &nested, Ctx &ctx) const -> decltype(ctx.out())
+    {
+        LOG_TRACE("Formatting {}", nested.value); // Finds the only shared buffer taken
+        return fmt::formatter<int>::format(nested.value, ctx);
+    }
+};
+
+void test_stack_light_fallback_when_buffers_taken()
+{
+    uint32_t fallbacks = LOG_GET_STACK_FALLBACKS();
+    LOG_INFO("Value {}", Nested{7});
+    TEST_ASSERT_EQUAL_STRING("[TRAC] Formatting 7" LOG_EOL "[INFO] Value 7" LOG_EOL, gStream.c_str());
+    TEST_ASSERT_EQUAL_UINT32(fallbacks + 1, LOG_GET_STACK_FALLBACKS());
+}
+
+/*------------------------------------------------------------------------------
+ * SETUP AND TEST RUNNER
+ *----------------------------------------------------------------------------*/
+
+void setUp(void)
+{
+    gStream.clear();
+}
+
+void tearDown(void)
+{
+}
+
+void tests()
+{
+    RUN_TEST(test_stack_light_output);
+    RUN_TEST(test_stack_light_worst_case);
+    RUN_TEST(test_stack_light_fallback_when_buffers_taken);
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs if board doesn't support software reset via Serial.DTR/RTS
+    delay(4000);
+
+    UNITY_BEGIN();
+    tests();
+    UNITY_END();
+}
+
+void loop()
+{
+}
@@ -0,0 +1,92 @@
+// More information about PlatformIO Unit Testing:
+// https://docs.platformio.org/en/latest/advanced/unit-testing/index.html
+
+#include <Arduino.h>
+#include <string>
+#include <cstring>
+#include "unity.h"
+
+#include "../shared/TestSupport.h"
+
+TestStream gStream;
+
+#define LOG_STREAM gStream
+#define LOG_LEVEL LOG_LEVEL_TRACE
+#define LOG_COLOR LOG_COLOR_DISABLE
+#define LOG_TIME LOG_TIME_DISABLE
+#define LOG_FILENAME LOG_FILENAME_DISABLE
+
+#define LOG_STREAM_FULL_POLICY LOG_STREAM_FULL_DROP_LOW
+#define LOG_STREAM_KEEP_LEVEL LOG_LEVEL_WARN
+
+#include "FormatLog.h"
+
+/*------------------------------------------------------------------------------
+ * TESTS FOR Stream Backpressure (LOG_STREAM_FULL_DROP_LOW)
+ *----------------------------------------------------------------------------*/
+
+void test_stream_written_when_room()
+{
+    gStream.room = 18;
+    LOG_DEBUG("Fits here"); // 18 bytes with preamble and EOL
+    TEST_ASSERT_EQUAL_STRING("[DBUG] Fits here" LOG_EOL, gStream.c_str());
+    TEST_ASSERT_EQUAL_UINT32(0, LOG_GET_STREAM_DROPPED());
+}
+
+void test_stream_drops_low_levels_when_full()
+{
+    gStream.room = 4;
+    uint32_t dropped = LOG_GET_STREAM_DROPPED();
+    LOG_TRACE("Sample");
+    LOG_DEBUG("Sample");
+    LOG_INFO("Sample");
+    LOG_PRINTLN("Status {}", 1);
+    TEST_ASSERT_EQUAL_STRING("", gStream.c_str());
+    TEST_ASSERT_EQUAL_UINT32(dropped + 4, LOG_GET_STREAM_DROPPED());
+}
+
+void test_stream_keeps_severe_levels_when_full()
+{
+    gStream.room = 4;
+    uint32_t blocked = LOG_GET_STREAM_BLOCKED();
+    LOG_WARN("Low voltage");
+    LOG_ERROR("Brownout");
+    TEST_ASSERT_EQUAL_STRING("[WARN] Low voltage" LOG_EOL "[EROR] Brownout" LOG_EOL, gStream.c_str());
+    TEST_ASSERT_EQUAL_UINT32(blocked + 2, LOG_GET_STREAM_BLOCKED());
+    TEST_ASSERT_EQUAL_UINT32(0, LOG_GET_STREAM_TRUNCATED());
+}
+
+/*------------------------------------------------------------------------------
+ * SETUP AND TEST RUNNER
+ *----------------------------------------------------------------------------*/
+
+void setUp(void)
+{
+    gStream.room = 1000;
+    gStream.clear();
+}
+
+void tearDown(void)
+{
+}
+
+void tests()
+{
+    RUN_TEST(test_stream_written_when_room);
+    RUN_TEST(test_stream_drops_low_levels_when_full);
+    RUN_TEST(test_stream_keeps_severe_levels_when_full);
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs if board doesn't support software reset via Serial.DTR/RTS
+    delay(4000);
+
+    UNITY_BEGIN();
+    tests();
+    UNITY_END();
+}
+
+void loop()
+{
+}
@@ -0,0 +1,86 @@
+// More information about PlatformIO Unit Testing:
+// https://docs.platformio.org/en/latest/advanced/unit-testing/index.html
+
+#include <Arduino.h>
+#include <string>
+#include <cstring>
+#include "unity.h"
+
+#include "../shared/TestSupport.h"
+
+TestStream gStream;
+
+#define LOG_STREAM gStream
+#define LOG_LEVEL LOG_LEVEL_TRACE
+#define LOG_COLOR LOG_COLOR_DISABLE
+#define LOG_TIME LOG_TIME_DISABLE
+#define LOG_FILENAME LOG_FILENAME_DISABLE
+
+#define LOG_STREAM_FULL_POLICY LOG_STREAM_FULL_TRUNCATE
+#define LOG_STREAM_TRUNCATED_MARKER "~" LOG_EOL
+
+#include "FormatLog.h"
+
+/*------------------------------------------------------------------------------
+ * TESTS FOR Stream Backpressure (LOG_STREAM_FULL_TRUNCATE)
+ *----------------------------------------------------------------------------*/
+
+void test_stream_written_when_room()
+{
+    gStream.room = 18;
+    LOG_DEBUG("Fits here"); // 18 bytes with preamble and EOL
+    TEST_ASSERT_EQUAL_STRING("[DBUG] Fits here" LOG_EOL, gStream.c_str());
+    TEST_ASSERT_EQUAL_UINT32(0, LOG_GET_STREAM_DROPPED());
+}
+
+void test_stream_truncated_when_full()
+{
+    gStream.room = 12;
+    LOG_INFO("Battery at {}%", 12);
+    TEST_ASSERT_EQUAL_STRING("[INFO] Ba~" LOG_EOL, gStream.c_str());
+    TEST_ASSERT_EQUAL_UINT32(1, LOG_GET_STREAM_TRUNCATED());
+}
+
+void test_stream_dropped_without_room_for_marker()
+{
+    gStream.room = 3;
+    uint32_t dropped = LOG_GET_STREAM_DROPPED();
+    LOG_ERROR("Brownout");
+    TEST_ASSERT_EQUAL_STRING("", gStream.c_str());
+    TEST_ASSERT_EQUAL_UINT32(dropped + 1, LOG_GET_STREAM_DROPPED());
+}
+
+/*------------------------------------------------------------------------------
+ * SETUP AND TEST RUNNER
+ *----------------------------------------------------------------------------*/
+
+void setUp(void)
+{
+    gStream.room = 1000;
+    gStream.clear();
+}
+
+void tearDown(void)
+{
+}
+
+void tests()
+{
+    RUN_TEST(test_stream_written_when_room);
+    RUN_TEST(test_stream_truncated_when_full);
+    RUN_TEST(test_stream_dropped_without_room_for_marker);
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs if board doesn't support software reset via Serial.DTR/RTS
+    delay(4000);
+
+    UNITY_BEGIN();
+    tests();
+    UNITY_END();
+}
+
+void loop()
+{
+}
@@ -0,0 +1,246 @@
+// More information about PlatformIO Unit Testing:
+// https://docs.platformio.org/en/latest/advanced/unit-testing/index.html
+
+#include <Arduino.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <cstring>
+#include <thread>
+#include "unity.h"
+
+/*------------------------------------------------------------------------------
+ * Unsynchronized outputs that detect overlapping writes, like a UART or a file
+ * buffer shared by several tasks
+ *----------------------------------------------------------------------------*/
+
+class OverlapDetector
+{
+private:
+    std::atomic<int> inside{0};
+    std::atomic<bool> overlapped{false};
+    std::string buffer;
+
+public:
+    void append(const char *data, size_t size)
+    {
+        if (inside.fetch_add(1) != 0)
+            overlapped = true;
+        // Append in small pieces so an unserialized writer would interleave
+        for (size_t i = 0; i < size; i += 8)
+        {
+            buffer.append(data + i, size - i < 8 ? size - i : 8);
+            std::this_thread::yield();
+        }
+        inside.fetch_sub(1);
+    }
+
+    void clear()
+    {
+        buffer.clear();
+        overlapped = false;
+    }
+    bool hasOverlapped() const { return overlapped; }
+    const std::string &str() const { return buffer; }
+};
+
+class TestStream : public Stream
+{
+public:
+    OverlapDetector output;
+
+    size_t write(uint8_t ch) override
+    {
+        output.append(reinterpret_cast<const char *>(&ch), 1);
+        return 1;
+    }
+    size_t write(const uint8_t *data, size_t size) override
+    {
+        output.append(reinterpret_cast<const char *>(data), size);
+        return size;
+    }
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    void flush() override {}
+};
+
+TestStream gStream;
+
+#define LOG_STREAM gStream
+#define LOG_LEVEL LOG_LEVEL_TRACE
+#define LOG_COLOR LOG_COLOR_DISABLE
+#define LOG_TIME LOG_TIME_HHMMSSMS
+#define LOG_FILENAME LOG_FILENAME_LINENUMBER_ENABLE
+
+#define LOG_THREAD_SAFE 1
+#define LOG_FILE_ENABLE 1
+#define LOG_FILE_LEVEL LOG_LEVEL_INFO
+
+#include "FormatLog.h"
+
+class TestSink : public fmtlog::IFileSink
+{
+public:
+    OverlapDetector output;
+
+    bool write(const char *data, size_t size) override
+    {
+        output.append(data, size);
+        return true;
+    }
+    void flush() override {}
+    void close() override {}
+    void setFilePath(const char *) override {}
+    std::string getFilePath() const override { return ""; }
+};
+
+std::shared_ptr<TestSink> gSink = std::make_shared<TestSink>();
+
+static size_t countOccurrences(const std::string &text, const char *needle)
+{
+    size_t count = 0;
+    for (size_t pos = text.find(needle); pos != std::string::npos; pos = text.find(needle, pos + 1))
+        ++count;
+    return count;
+}
+
+// Every message must appear exactly once, as one whole line
+static void checkLines(const std::string &out, int producers, int perProducer)
+{
+    TEST_ASSERT_EQUAL_UINT_MESSAGE((unsigned int)(producers * perProducer), (unsigned int)countOccurrences(out, LOG_EOL),
+                                   "Every message should be written exactly once");
+    for (int t = 0; t < producers; t++)
+    {
+        for (int i = 0; i < perProducer; i += 37)
+        {
+            char expected[64]; // Fits two full-width ints
+            snprintf(expected, sizeof(expected), "Producer %d message %d payload" LOG_EOL, t, i);
+            TEST_ASSERT_EQUAL_UINT_MESSAGE(1, (unsigned int)countOccurrences(out, expected), expected);
+        }
+    }
+}
+
+/*------------------------------------------------------------------------------
+ * TESTS FOR Thread-Safe Logging
+ *----------------------------------------------------------------------------*/
+
+void test_concurrent_log_lines_not_interleaved()
+{
+    const int producers = 8;
+    const int perProducer = 200;
+
+    std::thread threads[producers];
+    for (int t = 0; t < producers; t++)
+    {
+        threads[t] = std::thread([t]()
+                                 {
+                                     for (int i = 0; i < perProducer; i++)
+                                         LOG_INFO("Producer {} message {} payload", t, i); });
+    }
+    for (int t = 0; t < producers; t++)
+        threads[t].join();
+
+    TEST_ASSERT_FALSE_MESSAGE(gStream.output.hasOverlapped(), "Stream writes overlapped");
+    TEST_ASSERT_FALSE_MESSAGE(gSink->output.hasOverlapped(), "File sink writes overlapped");
+    checkLines(gStream.output.str(), producers, perProducer);
+    checkLines(gSink->output.str(), producers, perProducer);
+}
+
+void test_concurrent_print_and_log()
+{
+    const int perProducer = 200;
+
+    std::thread logger([]()
+                       {
+                           for (int i = 0; i < perProducer; i++)
+                               LOG_WARN("Producer 0 message {} payload", i); });
+    std::thread printer([]()
+                        {
+                            for (int i = 0; i < perProducer; i++)
+                                LOG_PRINTLN("Producer 1 message {} payload", i); });
+    logger.join();
+    printer.join();
+
+    TEST_ASSERT_FALSE(gStream.output.hasOverlapped());
+    checkLines(gStream.output.str(), 2, perProducer);
+}
+
+void test_concurrent_level_changes()
+{
+    const int perProducer = 200;
+
+    // Every level set here still accepts WARN, so no line may go missing
+    std::thread logger([]()
+                       {
+                           for (int i = 0; i < perProducer; i++)
+                               LOG_WARN("Producer 0 message {} payload", i); });
+    std::thread changer([]()
+                        {
+                            for (int i = 0; i < perProducer; i++)
+                            {
+                                LOG_SET_LOG_LEVEL(i % 2 ? fmtlog::LogLevel::DEBUG : fmtlog::LogLevel::TRACE);
+                                LOG_SET_FILE_LOG_LEVEL(i % 2 ? fmtlog::LogLevel::WARN : fmtlog::LogLevel::INFO);
+                                LOG_SET_TAG_LEVELS(i % 2 ? "*=warn" : "*=inherit");
+                            } });
+    logger.join();
+    changer.join();
+
+    LOG_SET_LOG_LEVEL(fmtlog::LogLevel::TRACE);
+    LOG_SET_FILE_LOG_LEVEL(fmtlog::LogLevel::INFO);
+    LOG_SET_TAG_LEVELS("*=inherit");
+
+    checkLines(gStream.output.str(), 1, perProducer);
+    checkLines(gSink->output.str(), 1, perProducer);
+}
+
+void test_concurrent_stopwatch_text()
+{
+    fmtlog::Stopwatch first;
+    fmtlog::MicroStopwatch second;
+    fmtlog::TimeText a = first.elapsedTime();
+    fmtlog::TimeText b = second.elapsedTime();
+
+    // Each call renders into its own result instead of a shared static buffer
+    TEST_ASSERT_EQUAL_UINT(12, a.length);
+    TEST_ASSERT_EQUAL_UINT(16, b.length);
+    TEST_ASSERT_TRUE(a.c_str() != b.c_str());
+}
+
+/*------------------------------------------------------------------------------
+ * SETUP AND TEST RUNNER
+ *----------------------------------------------------------------------------*/
+
+void setUp(void)
+{
+    gStream.output.clear();
+    gSink->output.clear();
+}
+
+void tearDown(void)
+{
+}
+
+void tests()
+{
+    FmtLog.setFileStorage(gSink);
+
+    RUN_TEST(test_concurrent_log_lines_not_interleaved);
+    RUN_TEST(test_concurrent_print_and_log);
+    RUN_TEST(test_concurrent_level_changes);
+    RUN_TEST(test_concurrent_stopwatch_text);
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs if board doesn't support software reset via Serial.DTR/RTS
+    delay(4000);
+
+    UNITY_BEGIN();
+    tests();
+    UNITY_END();
+}
+
+void loop()
+{
+}